@@ -132,6 +132,19 @@ namespace octomap {
           || occupancyNode.getLogOdds() <= this->clamping_thres_min);
     }
 
+    /// Fusion of overlapping nodes in OccupancyOcTreeBase::merge()
+    enum MergePolicy {
+      MERGE_ADD,       ///< add the log-odds of both trees (independent measurements)
+      MERGE_MAX,       ///< keep the larger log-odds (conservative for obstacles)
+      MERGE_OVERWRITE  ///< replace with the data of the merged tree
+    };
+
+    /// Combination of the updates of all rays of a scan per cell in OccupancyOcTreeBase::insertPointCloudWithModel()
+    enum UpdateAccumulation {
+      ACCUMULATE_MAX,  ///< keep the larger update (each cell is updated once per scan, as in insertPointCloud())
+      ACCUMULATE_SUM   ///< add the updates of all rays (each ray is an independent measurement)
+    };
+
     // - update functions
 
     /**
@@ -126,52 +126,146 @@ namespace octomap {
     virtual bool pruneNode(ColorOcTreeNode* node);
     
     virtual bool isNodeCollapsible(const ColorOcTreeNode* node) const;
+
+    using OccupancyOcTreeBase<ColorOcTreeNode>::updateNode;
+    using OccupancyOcTreeBase<ColorOcTreeNode>::setNodeValue;
+
+    /// updates the occupancy like OccupancyOcTreeBase::updateNode(), with lazy_eval the key is marked dirty
+    virtual ColorOcTreeNode* updateNode(const OcTreeKey& key, float log_odds_update, bool lazy_eval = false);
+
+    /// sets the occupancy like OccupancyOcTreeBase::setNodeValue(), with lazy_eval the key is marked dirty
+    virtual ColorOcTreeNode* setNodeValue(const OcTreeKey& key, float log_odds_value, bool lazy_eval = false);
        
     // set node color at given key or coordinate. Replaces previous color.
+    // With lazy_eval the key is marked dirty (see updateDirtyInnerOccupancy()).
     ColorOcTreeNode* setNodeColor(const OcTreeKey& key, uint8_t r, 
-                                 uint8_t g, uint8_t b);
+                                 uint8_t g, uint8_t b, bool lazy_eval = false);
 
     ColorOcTreeNode* setNodeColor(float x, float y, 
                                  float z, uint8_t r, 
-                                 uint8_t g, uint8_t b) {
+                                 uint8_t g, uint8_t b, bool lazy_eval = false) {
       OcTreeKey key;
       if (!this->coordToKeyChecked(point3d(x,y,z), key)) return NULL;
-      return setNodeColor(key,r,g,b);
+      return setNodeColor(key,r,g,b,lazy_eval);
     }
 
     // integrate color measurement at given key or coordinate. Average with previous color
     ColorOcTreeNode* averageNodeColor(const OcTreeKey& key, uint8_t r, 
-                                  uint8_t g, uint8_t b);
+                                  uint8_t g, uint8_t b, bool lazy_eval = false);
     
     ColorOcTreeNode* averageNodeColor(float x, float y, 
                                       float z, uint8_t r, 
-                                      uint8_t g, uint8_t b) {
+                                      uint8_t g, uint8_t b, bool lazy_eval = false) {
       OcTreeKey key;
       if (!this->coordToKeyChecked(point3d(x,y,z), key)) return NULL;
-      return averageNodeColor(key,r,g,b);
+      return averageNodeColor(key,r,g,b,lazy_eval);
     }
 
     // integrate color measurement at given key or coordinate. Average with previous color
     ColorOcTreeNode* integrateNodeColor(const OcTreeKey& key, uint8_t r, 
-                                  uint8_t g, uint8_t b);
+                                  uint8_t g, uint8_t b, bool lazy_eval = false);
     
     ColorOcTreeNode* integrateNodeColor(float x, float y, 
                                       float z, uint8_t r, 
-                                      uint8_t g, uint8_t b) {
+                                      uint8_t g, uint8_t b, bool lazy_eval = false) {
       OcTreeKey key;
       if (!this->coordToKeyChecked(point3d(x,y,z), key)) return NULL;
-      return integrateNodeColor(key,r,g,b);
+      return integrateNodeColor(key,r,g,b,lazy_eval);
     }
 
+    using OccupancyOcTreeBase<ColorOcTreeNode>::insertPointCloud;
+
+    /**
+     * Integrates a colored point cloud (in global reference frame) like
+     * insertPointCloud(), together with the colors of the endpoints. Colors of
+     * points falling into the same voxel are averaged first, and each occupied
+     * voxel is then updated with its color like integrateNodeColor(), in the
+     * same key pass as its occupancy. Unless lazy_eval is set, occupancy and
+     * colors of inner nodes are updated only along the paths of the updated voxels.
+     *
+     * @param scan Pointcloud (measurement endpoints), in global reference frame
+     * @param colors color of each point in scan
+     * @param sensor_origin measurement origin in global reference frame
+     * @param maxrange maximum range for how long individual beams are inserted (default -1: complete beam)
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     *   This speeds up the insertion, but you need to call updateInnerOccupancy() when done.
+     * @param discretize whether the scan is discretized first into octree key cells (default: false).
+     */
+    void insertPointCloud(const Pointcloud& scan, const std::vector<ColorOcTreeNode::Color>& colors,
+                          const point3d& sensor_origin, double maxrange=-1., bool lazy_eval = false,
+                          bool discretize = false);
+
+    /**
+     * Integrates a colored point cloud relative to frame_origin, see insertPointCloud() above.
+     *
+     * @param scan Pointcloud (measurement endpoints) relative to frame origin
+     * @param colors color of each point in scan
+     * @param sensor_origin origin of sensor relative to frame origin
+     * @param frame_origin origin of reference frame, determines transform to be applied to cloud and sensor origin
+     */
+    void insertPointCloud(const Pointcloud& scan, const std::vector<ColorOcTreeNode::Color>& colors,
+                          const point3d& sensor_origin, const pose6d& frame_origin,
+                          double maxrange=-1., bool lazy_eval = false, bool discretize = false);
+
     // update inner nodes, sets color to average child color
     void updateInnerOccupancy();
 
+    /**
+     * Updates occupancy and color of the inner nodes like updateInnerOccupancy(), but
+     * only on the paths to dirty keys: keys whose occupancy or color was changed with
+     * lazy_eval. Nodes are pruned where possible. With OpenMP and many dirty keys,
+     * subtrees are updated in parallel. Changes made directly to nodes have to be
+     * marked with markDirty().
+     */
+    void updateDirtyInnerOccupancy();
+
+    /// marks the leaf at key for the next updateDirtyInnerOccupancy()
+    void markDirty(const OcTreeKey& key) { dirty_keys.insert(key); }
+
+    /// @return number of distinct dirty keys since the last update of the inner nodes
+    size_t numDirtyKeys() const { return dirty_keys.size(); }
+
+    /// deletes the complete tree structure and all dirty keys
+    void clear();
+
     // uses gnuplot to plot a RGB histogram in EPS format
     void writeColorHistogram(std::string filename);
     
   protected:
     void updateInnerOccupancyRecurs(ColorOcTreeNode* node, unsigned int depth);
 
+    /// updates the occupancy and the average color of node after cropping
+    virtual void updateCroppedInnerNode(ColorOcTreeNode* node);
+
+    /// blends color into n, weighted by the occupancy of n (see integrateNodeColor())
+    void integrateColor(ColorOcTreeNode* n, uint8_t r, uint8_t g, uint8_t b) const;
+
+    /// prunes node like pruneNode(), but counts the deleted nodes in num_deleted instead of updating tree_size
+    bool pruneNode(ColorOcTreeNode* node, size_t& num_deleted);
+
+    /// subtree of updateDirtyInnerOccupancy() that is deferred and then processed in parallel
+    struct InnerNodesTask {
+      ColorOcTreeNode* node;
+      unsigned int depth;
+      std::vector<OcTreeKey>::iterator begin;
+      std::vector<OcTreeKey>::iterator end;
+    };
+
+    /**
+     * Prunes or updates occupancy and color of the inner nodes below node on the
+     * paths to the keys in [begin, end), which are reordered. Nodes at stop_depth are
+     * not visited, but appended to tasks (if not NULL). Nodes above stop_depth are only
+     * updated if tasks is NULL.
+     */
+    void updateInnerNodesRecurs(ColorOcTreeNode* node, unsigned int depth,
+                                std::vector<OcTreeKey>::iterator begin,
+                                std::vector<OcTreeKey>::iterator end,
+                                unsigned int stop_depth, std::vector<InnerNodesTask>* tasks,
+                                size_t& num_deleted);
+
+    /// leafs changed since the last update of the inner nodes
+    KeySet dirty_keys;
+
     /**
      * Static member object which ensures that this OcTree's prototype
      * ends up in the classIDMapping only once. You need this as a 
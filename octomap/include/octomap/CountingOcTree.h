@@ -38,6 +38,7 @@
 #include <stdio.h>
 #include "OcTreeBase.h"
 #include "OcTreeDataNode.h"
+#include "Pointcloud.h"
 
 namespace octomap {
 
@@ -59,6 +60,7 @@ namespace octomap {
     
     inline unsigned int getCount() const { return getValue(); }
     inline void increaseCount() { value++; }
+    inline void increaseCount(unsigned int c) { value += c; }
     inline void setCount(unsigned c) {this->setValue(c); }
 
   };
@@ -80,10 +82,44 @@ namespace octomap {
     CountingOcTree(double resolution);
     virtual CountingOcTreeNode* updateNode(const point3d& value);
     CountingOcTreeNode* updateNode(const OcTreeKey& k);
+
+    /**
+     * Counts a batch of points, with the same result as calling updateNode()
+     * for each of them. Keys are computed and accumulated per thread (with
+     * OpenMP), the merged counts are then inserted in a single depth-first
+     * pass over the tree in Morton order.
+     *
+     * @param points points to count (in global reference frame)
+     * @return number of points counted (points outside of the tree are skipped)
+     */
+    size_t updateNodes(const point3d_collection& points);
+
+    /// Counts all points of a Pointcloud, see updateNodes(const point3d_collection&)
+    size_t updateNodes(const Pointcloud& scan);
+
+    /**
+     * Returns the centers of all leafs with at least min_hits counts.
+     * Subtrees with a total count below min_hits are skipped.
+     */
     void getCentersMinHits(point3d_list& node_centers, unsigned int min_hits) const;
 
   protected:
 
+    /// (Morton code, count) pair of an accumulated key, see computeMortonCode()
+    typedef std::pair<uint64_t, unsigned int> MortonCount;
+
+    /// shared implementation of updateNodes() for contiguous point arrays
+    size_t countPoints(const point3d* points, size_t num_points);
+
+    /**
+     * Adds the counts in [begin, end) to node and creates / descends its
+     * children. The range has to be sorted by Morton code and all codes
+     * have to lie within node. Returns the total count of the range.
+     */
+    unsigned int insertCountsRecurs(CountingOcTreeNode* node, unsigned int depth,
+                                    std::vector<MortonCount>::const_iterator begin,
+                                    std::vector<MortonCount>::const_iterator end);
+
     void getCentersMinHitsRecurs( point3d_list& node_centers,
                                   unsigned int& min_hits,
                                   unsigned int max_depth,
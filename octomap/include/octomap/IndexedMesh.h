@@ -0,0 +1,89 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_INDEXED_MESH_H
+#define OCTOMAP_INDEXED_MESH_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <octomap/octomap_types.h>
+
+namespace octomap {
+
+  /**
+   * Triangle mesh with shared vertices, e.g. a surface extracted from an
+   * occupancy tree with SurfaceMesher. Triangles are stored as triples of
+   * vertex indices, counter-clockwise when seen from the outside (free space),
+   * so that they can be uploaded directly as vertex and index buffers.
+   */
+  class IndexedMesh {
+  public:
+    IndexedMesh() {}
+
+    /// @return number of vertices
+    size_t getNumVertices() const { return vertices.size(); }
+    /// @return number of triangles
+    size_t getNumTriangles() const { return indices.size() / 3; }
+
+    /// removes all vertices and triangles
+    void clear();
+
+    /// appends another mesh, its vertices are not merged with the existing ones
+    void append(const IndexedMesh& other);
+
+    /**
+     * Computes a normal per vertex by averaging the (area weighted) normals
+     * of the adjacent triangles.
+     */
+    void computeVertexNormals(std::vector<point3d>& normals) const;
+
+    /// writes the mesh in Wavefront OBJ format
+    bool writeObj(const std::string& filename) const;
+    std::ostream& writeObj(std::ostream& s) const;
+
+    /// writes the mesh in binary PLY format (s has to be opened in binary mode)
+    bool writePly(const std::string& filename) const;
+    std::ostream& writePly(std::ostream& s) const;
+
+    /// writes the mesh as VRML 2.0 IndexedFaceSet
+    bool writeVrml(const std::string& filename) const;
+    std::ostream& writeVrml(std::ostream& s) const;
+
+    std::vector<point3d> vertices;     ///< vertex positions
+    std::vector<unsigned int> indices; ///< three vertex indices per triangle
+  };
+
+} // namespace
+
+#endif
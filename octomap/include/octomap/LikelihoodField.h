@@ -0,0 +1,145 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_LIKELIHOOD_FIELD_H
+#define OCTOMAP_LIKELIHOOD_FIELD_H
+
+#include <vector>
+#include <octomap/octomap_types.h>
+#include <octomap/Pointcloud.h>
+
+namespace octomap {
+
+  /**
+   * Dense 3D grid of the distance to the nearest occupied voxel, e.g. for
+   * scoring pose hypotheses of a localizer without tree lookups (the
+   * likelihood field model of range sensors). Obtained from an octree with
+   * OccupancyOcTreeBase::computeLikelihoodField(). Cells are aligned with the
+   * octree voxels at the finest resolution and stored with x varying fastest
+   * (index = (z * size_y + y) * size_x + x).
+   *
+   * An endpoint at distance d to the nearest obstacle has the likelihood
+   * (1 - random_prob) * exp(-d^2 / (2 sigma^2)) + random_prob, endpoints
+   * outside of the grid have the likelihood random_prob.
+   */
+  class LikelihoodField {
+  public:
+    LikelihoodField() : resolution(0.0), size_x(0), size_y(0), size_z(0),
+      sigma(0.0), random_prob(0.0), outside_log_likelihood(0.0f) {}
+
+    unsigned int getSizeX() const { return size_x; }
+    unsigned int getSizeY() const { return size_y; }
+    unsigned int getSizeZ() const { return size_z; }
+    /// @return edge length of a cell (meters)
+    double getResolution() const { return resolution; }
+    /// @return lower corner of the grid
+    const point3d& getOrigin() const { return origin; }
+    double getSigma() const { return sigma; }
+    double getRandomProb() const { return random_prob; }
+
+    /// @return index of the cell (x, y, z) in the data arrays
+    size_t index(unsigned int x, unsigned int y, unsigned int z) const {
+      return (size_t(z) * size_y + y) * size_x + x;
+    }
+
+    /// @return true if p lies within the grid, its cell index is returned in idx
+    bool coordToIndex(const point3d& p, size_t& idx) const {
+      float fx = (p.x() - origin.x()) / (float) resolution;
+      float fy = (p.y() - origin.y()) / (float) resolution;
+      float fz = (p.z() - origin.z()) / (float) resolution;
+      if (!(fx >= 0.0f && fy >= 0.0f && fz >= 0.0f))
+        return false;
+      unsigned int x = (unsigned int) fx;
+      unsigned int y = (unsigned int) fy;
+      unsigned int z = (unsigned int) fz;
+      if (x >= size_x || y >= size_y || z >= size_z)
+        return false;
+      idx = index(x, y, z);
+      return true;
+    }
+
+    /// @return log-likelihood of an endpoint at p
+    float getLogLikelihood(const point3d& p) const {
+      size_t idx;
+      return coordToIndex(p, idx) ? log_likelihood[idx] : outside_log_likelihood;
+    }
+
+    /// resets all cells to free space for a grid of the given geometry
+    void reset(double resolution, const point3d& origin,
+               unsigned int size_x, unsigned int size_y, unsigned int size_z);
+
+    /**
+     * Computes the Euclidean distance of all cells to the nearest cell marked
+     * occupied in distance (value 0), with an exact separable distance
+     * transform. Distances are limited to max_distance. With OpenMP, the
+     * rows of each pass are processed in parallel.
+     */
+    void computeDistances(double max_distance);
+
+    /// (re)computes the log-likelihoods of all cells from their distances
+    void setSensorModel(double sigma, double random_prob);
+
+    /**
+     * Scores candidate poses of a scan, e.g. the particles of a localizer. For
+     * each pose, the points of scan (in the sensor frame) are transformed into
+     * the grid and the log-likelihoods of their cells are summed up. The points
+     * are transformed with a rotation matrix over separate coordinate arrays,
+     * a loop the compiler can vectorize. With OpenMP, poses are scored in parallel.
+     *
+     * @param scan points in the sensor frame, e.g. a downsampled scan
+     * @param poses candidate sensor poses in the frame of the grid
+     * @param[out] log_likelihoods log-likelihood of the scan for each pose
+     */
+    void scorePoses(const Pointcloud& scan, const std::vector<pose6d>& poses,
+                    std::vector<double>& log_likelihoods) const;
+
+    std::vector<float> distance;       ///< distance to the nearest occupied cell per cell (meters)
+    std::vector<float> log_likelihood; ///< log-likelihood of an endpoint per cell
+
+  protected:
+    /// one dimensional squared distance transform of f (n values) into d, using v and z as buffers
+    static void distanceTransform1D(const float* f, unsigned int n, float* d, int* v, float* z);
+
+    double resolution;
+    point3d origin;
+    unsigned int size_x;
+    unsigned int size_y;
+    unsigned int size_z;
+    double sigma;
+    double random_prob;
+    float outside_log_likelihood;
+  };
+
+} // namespace
+
+#endif
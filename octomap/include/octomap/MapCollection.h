@@ -36,6 +36,7 @@
 
 
 #include <vector>
+#include <set>
 #include <octomap/MapNode.h>
 
 namespace octomap {
@@ -45,7 +46,14 @@ namespace octomap {
   class MapCollection {
   public:
     MapCollection();
-    MapCollection(std::string filename);
+    /**
+     * Reads a collection from its index file. Node maps are read in parallel
+     * (with OpenMP enabled).
+     * @param lazy if true, node maps are only read on their first query. Nodes
+     *   written with bounds (see write()) are then skipped by queries outside of them.
+     *   Node maps that cannot be read are skipped by all queries.
+     */
+    MapCollection(std::string filename, bool lazy = false);
     ~MapCollection();
 
     void addNode( MAPNODE* node);
@@ -58,10 +66,78 @@ namespace octomap {
 
     double getOccupancy(const point3d& p);
 
+    /**
+     * Batch version of isOccupied(). Points are first grouped by the node maps
+     * whose bounds contain them, then each node map is queried once for its group.
+     *
+     * @param points query points in world coordinates
+     * @param occupied set to true for each point that is occupied in any node map
+     */
+    void isOccupied(const point3d_collection& points, std::vector<bool>& occupied) const;
+
+    /**
+     * Batch version of getOccupancy(), grouping points per node map like
+     * isOccupied(const point3d_collection&, std::vector<bool>&).
+     *
+     * @param points query points in world coordinates
+     * @param occupancies maximum occupancy over all node maps per point, 0.5 if unknown in all
+     */
+    void getOccupancy(const point3d_collection& points, std::vector<double>& occupancies) const;
+
+    /**
+     * Recomputes the bounds of all nodes and rebuilds the spatial index over them.
+     * Queries only see node bounds as of the last index update, so call this after
+     * changing the origin or map of a node that is already part of the collection.
+     * Methods adding or moving nodes (read(), addNode(), addSubmaps(),
+     * updateSubmapOrigins()) update the index themselves.
+     */
+    void updateIndex();
+
+    /**
+     * Integrates the scans of graph into submaps of scans_per_submap consecutive scans.
+     * Each submap is anchored at the pose of its first scan (the keyframe) and named by
+     * its id. Submaps are built in parallel (with OpenMP).
+     *
+     * @param resolution resolution of the submap trees
+     * @param maxrange maximum range of the scans (< 0: no limit)
+     * @return number of added submaps
+     */
+    size_t addSubmaps(const ScanGraph& graph, unsigned int scans_per_submap, double resolution,
+                      double maxrange = -1.0);
+
+    /**
+     * Moves the submaps created by addSubmaps() to the current pose of their keyframe
+     * in graph (matched by id), e.g. after loop closure. Only the origins change, the
+     * scans of a submap keep their relative poses. Nodes read from file or added with
+     * addNode() are never moved, even if their id equals a scan node id.
+     *
+     * @return number of updated submaps
+     */
+    size_t updateSubmapOrigins(const ScanGraph& graph);
+
+    /**
+     * Fuses all node maps into tree in the world frame. Each node map is resampled at its
+     * origin (see OccupancyOcTreeBase::transformed()) and merged into tree (see
+     * OccupancyOcTreeBase::merge()).
+     *
+     * @param policy how to fuse cells known in several node maps
+     * @return false if a node map could not be read, resampled or merged
+     */
+    bool fuse(typename MAPNODE::TreeType& tree,
+              AbstractOccupancyOcTree::MergePolicy policy = AbstractOccupancyOcTree::MERGE_ADD);
+
     bool castRay(const point3d& origin, const point3d& direction, point3d& end,
                  bool ignoreUnknownCells=false, double maxRange=-1.0) const;
 
     bool writePointcloud(std::string filename);
+
+    /**
+     * Writes the index file and one .bt file per node map ("nodemap_<id>.bt", next to
+     * the index). Each node is written as MAPNODEID, MAPNODEFILENAME and MAPNODEPOSE
+     * lines, followed by the bounds of its map in its own frame as a
+     * "#MAPNODEBBX minx miny minz maxx maxy maxz" line. Older readers skip that line
+     * as a comment, read() uses it for lazy reading.
+     */
     bool write(std::string filename);
 
     // TODO
@@ -80,7 +156,7 @@ namespace octomap {
         
   protected:
     void clear();
-    bool read(std::string filename);
+    bool read(std::string filename, bool lazy = false);
 
     // TODO
     std::vector<Pointcloud*> segment(const Pointcloud& scan) const;
@@ -89,11 +165,48 @@ namespace octomap {
 
     static void splitPathAndFilename(std::string &filenamefullpath, std::string* path, std::string *filename);
     static std::string combinePathAndFilename(std::string path, std::string filename);
-    static bool readTagValue(std::string tag, std::ifstream &infile, std::string* value);
-    
+    /// reads the next non-comment line as "TAG value", "#MAPNODEBBX" comments are returned as tag MAPNODEBBX
+    static bool readTagValue(std::ifstream &infile, std::string* tag, std::string* value);
+
+    /// node of the bounding volume hierarchy over the world-space bounds of all MapNodes
+    struct IndexNode {
+      point3d bbx_min;
+      point3d bbx_max;
+      unsigned int first;  ///< first entry in index_order (leaves only)
+      unsigned int count;  ///< number of entries in index_order, 0 for inner nodes
+      unsigned int right;  ///< right child, the left child directly follows its parent
+    };
+
+    /// orders node indices by the center of their bounds along one axis
+    struct IndexCenterLess {
+      IndexCenterLess(const std::vector<point3d>& min, const std::vector<point3d>& max, unsigned int a)
+        : bbx_min(min), bbx_max(max), axis(a) {}
+      bool operator()(unsigned int a, unsigned int b) const {
+        return bbx_min[a](axis) + bbx_max[a](axis) < bbx_min[b](axis) + bbx_max[b](axis);
+      }
+      const std::vector<point3d>& bbx_min;
+      const std::vector<point3d>& bbx_max;
+      unsigned int axis;
+    };
+
+    /// rebuilds the bounding volume hierarchy from the current node bounds
+    void buildIndex();
+    unsigned int buildIndexRecurs(unsigned int first, unsigned int last);
+    /// collects the indices (ascending) of all nodes whose bounds contain p
+    void queryIndex(const point3d& p, std::vector<unsigned int>& candidates) const;
+    /// groups the indices of points by the nodes whose bounds contain them
+    void groupByNode(const point3d_collection& points,
+                     std::vector<std::vector<unsigned int> >& groups) const;
+
   protected:
 
     std::vector<MAPNODE*> nodes;
+    std::set<const MAPNODE*> submaps; ///< nodes created by addSubmaps()
+
+    std::vector<IndexNode> index_nodes;
+    std::vector<unsigned int> index_order; ///< indices into nodes, ordered by index leaves
+    std::vector<point3d> index_bbx_min;    ///< node bounds at the last index update
+    std::vector<point3d> index_bbx_max;
   };
 
 } // end namespace
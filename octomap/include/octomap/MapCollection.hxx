@@ -34,6 +34,8 @@
 #include <stdio.h>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
+#include <map>
 
 namespace octomap {
   
@@ -42,8 +44,8 @@ namespace octomap {
   }
 
   template <class MAPNODE>
-  MapCollection<MAPNODE>::MapCollection(std::string filename) {
-    this->read(filename);
+  MapCollection<MAPNODE>::MapCollection(std::string filename, bool lazy) {
+    this->read(filename, lazy);
   }
 
   template <class MAPNODE>
@@ -58,10 +60,12 @@ namespace octomap {
     // for(typename std::vector<MAPNODE*>::iterator it= nodes.begin(); it != nodes.end(); ++it)
     //   delete *it;
     nodes.clear();
+    submaps.clear();
+    buildIndex();
   }
 
   template <class MAPNODE>
-  bool MapCollection<MAPNODE>::read(std::string filenamefullpath) {
+  bool MapCollection<MAPNODE>::read(std::string filenamefullpath, bool lazy) {
 
     std::string path;
     std::string filename;
@@ -74,56 +78,192 @@ namespace octomap {
       return false;
     }
 
+    // parse the whole index first, the node maps are read afterwards
+    std::vector<std::string> ids;
+    std::vector<std::string> mapNodeFilenames;
+    std::vector<pose6d> origins;
+    std::vector<std::pair<point3d, point3d> > bounds;
+    std::vector<bool> hasBounds;
+
     bool ok = true;
-    while(ok){
-      std::string nodeID;
-      ok = readTagValue("MAPNODEID", infile, &nodeID);
-      if(!ok){
-        //do not throw error, you could be at the end of the file
-        break;
+    std::string tag;
+    std::string value;
+    while(ok && readTagValue(infile, &tag, &value)){
+      if (tag == "MAPNODEID") {
+        ok = (ids.size() == origins.size());
+        if(!ok){
+          OCTOMAP_ERROR_STR("Could not read MAPNODEFILENAME / MAPNODEPOSE of " << ids.back() << ".");
+          break;
+        }
+        ids.push_back(value);
+        hasBounds.push_back(false);
+        bounds.push_back(std::make_pair(point3d(), point3d()));
       }
-
-      std::string mapNodeFilename;
-      ok = readTagValue("MAPNODEFILENAME", infile, &mapNodeFilename);
-      if(!ok){
-        OCTOMAP_ERROR_STR("Could not read MAPNODEFILENAME.");
-        break;
+      else if (ids.empty()) {
+        OCTOMAP_ERROR_STR("Tag " << tag << " before MAPNODEID.");
+        ok = false;
       }
-
-      std::string poseStr;
-      ok = readTagValue("MAPNODEPOSE", infile, &poseStr);
-      std::istringstream poseStream(poseStr);
-      float x,y,z;
-      poseStream >> x >> y >> z;
-      double roll,pitch,yaw;
-      poseStream >> roll >> pitch >> yaw;
-      ok = ok && !poseStream.fail();
-      if(!ok){
-        OCTOMAP_ERROR_STR("Could not read MAPNODEPOSE.");
-        break;
+      else if (tag == "MAPNODEFILENAME") {
+        ok = (mapNodeFilenames.size() + 1 == ids.size());
+        if(!ok){
+          OCTOMAP_ERROR_STR("Could not read MAPNODEFILENAME.");
+          break;
+        }
+        mapNodeFilenames.push_back(value);
       }
-      octomap::pose6d origin(x, y, z, roll, pitch, yaw);
-
-      MAPNODE* node = new MAPNODE(combinePathAndFilename(path,mapNodeFilename), origin);
-      node->setId(nodeID);
-
-      if(!ok){
-        for(unsigned int i=0; i<nodes.size(); i++){
-          delete nodes[i];
+      else if (tag == "MAPNODEPOSE") {
+        std::istringstream poseStream(value);
+        float x,y,z;
+        poseStream >> x >> y >> z;
+        double roll,pitch,yaw;
+        poseStream >> roll >> pitch >> yaw;
+        ok = !poseStream.fail() && (mapNodeFilenames.size() == ids.size())
+          && (origins.size() + 1 == ids.size());
+        if(!ok){
+          OCTOMAP_ERROR_STR("Could not read MAPNODEPOSE.");
+          break;
+        }
+        origins.push_back(octomap::pose6d(x, y, z, roll, pitch, yaw));
+      }
+      else if (tag == "MAPNODEBBX") {
+        // optional: bounds of the node map in its own frame
+        std::istringstream bbxStream(value);
+        point3d bbxMin, bbxMax;
+        bbxStream >> bbxMin.x() >> bbxMin.y() >> bbxMin.z() >> bbxMax.x() >> bbxMax.y() >> bbxMax.z();
+        if (bbxStream.fail()) {
+          OCTOMAP_WARNING_STR("Could not read MAPNODEBBX of " << ids.back() << ", ignoring it.");
+        } else {
+          bounds.back() = std::make_pair(bbxMin, bbxMax);
+          hasBounds.back() = true;
         }
-        infile.close();
-        return false;
-      } else {
-        nodes.push_back(node);
+      }
+      else {
+        OCTOMAP_WARNING_STR("Ignoring unknown tag " << tag << " in " << filenamefullpath << ".");
       }
     }
     infile.close();
-    return true;
+
+    // keep all completely specified nodes
+    size_t numNodes = std::min(ids.size(), origins.size());
+    size_t firstNew = nodes.size();
+    for (size_t i = 0; i < numNodes; ++i) {
+      MAPNODE* node = new MAPNODE(combinePathAndFilename(path, mapNodeFilenames[i]), origins[i], true);
+      node->setId(ids[i]);
+      if (hasBounds[i])
+        node->setLocalBounds(bounds[i].first, bounds[i].second);
+      nodes.push_back(node);
+    }
+
+    if (!lazy) {
+      int numNew = (int) (nodes.size() - firstNew);
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(dynamic)
+#endif
+      for (int i = 0; i < numNew; ++i) {
+        nodes[firstNew + i]->loadMap();
+      }
+    }
+
+    buildIndex();
+    return ok;
   }
 
   template <class MAPNODE>
   void MapCollection<MAPNODE>::addNode( MAPNODE* node){
     nodes.push_back(node);
+    buildIndex();
+  }
+
+  template <class MAPNODE>
+  size_t MapCollection<MAPNODE>::addSubmaps(const ScanGraph& graph, unsigned int scans_per_submap,
+                                            double resolution, double maxrange) {
+    typedef typename MAPNODE::TreeType TreeType;
+    if (scans_per_submap == 0)
+      scans_per_submap = 1;
+
+    // group consecutive scans, the first one of each group is its keyframe
+    std::vector<std::vector<const ScanNode*> > groups;
+    for (ScanGraph::const_iterator it = graph.begin(); it != graph.end(); ++it) {
+      if (!(*it)->scan)
+        continue;
+      if (groups.empty() || groups.back().size() >= scans_per_submap)
+        groups.push_back(std::vector<const ScanNode*>());
+      groups.back().push_back(*it);
+    }
+
+    // trees are created up front, their ray buffers are sized for all threads
+    std::vector<TreeType*> maps(groups.size());
+    for (size_t i = 0; i < groups.size(); ++i)
+      maps[i] = new TreeType(resolution);
+
+    int num_groups = (int) groups.size();
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) if (num_groups > 1)
+#endif
+    for (int i = 0; i < num_groups; ++i) {
+      const pose6d keyframe_inv = groups[i].front()->pose.inv();
+      for (size_t j = 0; j < groups[i].size(); ++j) {
+        const ScanNode* scan_node = groups[i][j];
+        maps[i]->insertPointCloud(*scan_node->scan, point3d(0, 0, 0), keyframe_inv * scan_node->pose, maxrange);
+      }
+    }
+
+    for (size_t i = 0; i < groups.size(); ++i) {
+      MAPNODE* node = new MAPNODE(maps[i], groups[i].front()->pose);
+      std::ostringstream id;
+      id << groups[i].front()->id;
+      node->setId(id.str());
+      nodes.push_back(node);
+      submaps.insert(node);
+    }
+    buildIndex();
+    return groups.size();
+  }
+
+  template <class MAPNODE>
+  size_t MapCollection<MAPNODE>::updateSubmapOrigins(const ScanGraph& graph) {
+    std::map<std::string, pose6d> keyframes;
+    for (ScanGraph::const_iterator it = graph.begin(); it != graph.end(); ++it) {
+      std::ostringstream id;
+      id << (*it)->id;
+      keyframes[id.str()] = (*it)->pose;
+    }
+
+    size_t num_updated = 0;
+    for (iterator it = this->begin(); it != this->end(); ++it) {
+      if (submaps.find(*it) == submaps.end())
+        continue;
+      std::map<std::string, pose6d>::const_iterator keyframe = keyframes.find((*it)->getId());
+      if (keyframe == keyframes.end())
+        continue;
+      (*it)->setOrigin(keyframe->second);
+      ++num_updated;
+    }
+    if (num_updated > 0)
+      buildIndex();
+    return num_updated;
+  }
+
+  template <class MAPNODE>
+  bool MapCollection<MAPNODE>::fuse(typename MAPNODE::TreeType& tree, AbstractOccupancyOcTree::MergePolicy policy) {
+    typedef typename MAPNODE::TreeType TreeType;
+    bool ok = true;
+    for (iterator it = this->begin(); it != this->end(); ++it) {
+      TreeType* node_map = (*it)->getMap();
+      if (!node_map) {
+        OCTOMAP_ERROR_STR("Could not read the map of node " << (*it)->getId() << ", not fused.");
+        ok = false;
+        continue;
+      }
+      TreeType world_map(tree.getResolution());
+      if (!node_map->transformed((*it)->getOrigin(), world_map)) {
+        OCTOMAP_ERROR_STR("Could not resample the map of node " << (*it)->getId() << ", not fused.");
+        ok = false;
+        continue;
+      }
+      ok = tree.merge(world_map, policy) && ok;
+    }
+    return ok;
   }
 
   template <class MAPNODE>
@@ -140,22 +280,32 @@ namespace octomap {
 
   template <class MAPNODE>
   MAPNODE* MapCollection<MAPNODE>::queryNode(const point3d& p) {
-    for (const_iterator it = this->begin(); it != this->end(); ++it) {
-      point3d ptrans = (*it)->getOrigin().inv().transform(p);
-      typename MAPNODE::TreeType::NodeType* n = (*it)->getMap()->search(ptrans);
+    std::vector<unsigned int> candidates;
+    queryIndex(p, candidates);
+    for (std::vector<unsigned int>::const_iterator it = candidates.begin(); it != candidates.end(); ++it) {
+      MAPNODE* mapnode = nodes[*it];
+      typename MAPNODE::TreeType* node_map = mapnode->getMap();
+      if (!node_map) continue;
+      point3d ptrans = mapnode->getOriginInverse().transform(p);
+      typename MAPNODE::TreeType::NodeType* n = node_map->search(ptrans);
       if (!n) continue;
-      if ((*it)->getMap()->isNodeOccupied(n)) return (*it);
+      if (node_map->isNodeOccupied(n)) return mapnode;
     }
     return 0;
   }
 
   template <class MAPNODE>
   bool MapCollection<MAPNODE>::isOccupied(const point3d& p) const {
-    for (const_iterator it = this->begin(); it != this->end(); ++it) {
-      point3d ptrans = (*it)->getOrigin().inv().transform(p);
-      typename MAPNODE::TreeType::NodeType* n = (*it)->getMap()->search(ptrans);
+    std::vector<unsigned int> candidates;
+    queryIndex(p, candidates);
+    for (std::vector<unsigned int>::const_iterator it = candidates.begin(); it != candidates.end(); ++it) {
+      MAPNODE* mapnode = nodes[*it];
+      typename MAPNODE::TreeType* node_map = mapnode->getMap();
+      if (!node_map) continue;
+      point3d ptrans = mapnode->getOriginInverse().transform(p);
+      typename MAPNODE::TreeType::NodeType* n = node_map->search(ptrans);
       if (!n) continue;
-      if ((*it)->getMap()->isNodeOccupied(n)) return true;
+      if (node_map->isNodeOccupied(n)) return true;
     }
     return false;
   }
@@ -171,9 +321,14 @@ namespace octomap {
   double MapCollection<MAPNODE>::getOccupancy(const point3d& p) {
     double max_occ_val = 0;
     bool is_unknown = true;
-    for (const_iterator it = this->begin(); it != this->end(); ++it) {
-      point3d ptrans = (*it)->getOrigin().inv().transform(p);
-      typename MAPNODE::TreeType::NodeType* n = (*it)->getMap()->search(ptrans);
+    std::vector<unsigned int> candidates;
+    queryIndex(p, candidates);
+    for (std::vector<unsigned int>::const_iterator it = candidates.begin(); it != candidates.end(); ++it) {
+      MAPNODE* mapnode = nodes[*it];
+      typename MAPNODE::TreeType* node_map = mapnode->getMap();
+      if (!node_map) continue;
+      point3d ptrans = mapnode->getOriginInverse().transform(p);
+      typename MAPNODE::TreeType::NodeType* n = node_map->search(ptrans);
       if (n) {
         double occ = n->getOccupancy();
         if (occ > max_occ_val) max_occ_val = occ;
@@ -184,6 +339,55 @@ namespace octomap {
     return max_occ_val;
   }
 
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::isOccupied(const point3d_collection& points, std::vector<bool>& occupied) const {
+    occupied.assign(points.size(), false);
+    std::vector<std::vector<unsigned int> > groups;
+    groupByNode(points, groups);
+
+    for (unsigned int i = 0; i < groups.size(); ++i) {
+      if (groups[i].empty()) continue;
+      MAPNODE* mapnode = nodes[i];
+      typename MAPNODE::TreeType* node_map = mapnode->getMap();
+      if (!node_map) continue;
+      const pose6d& origin_inv = mapnode->getOriginInverse();
+      for (std::vector<unsigned int>::const_iterator it = groups[i].begin(); it != groups[i].end(); ++it) {
+        if (occupied[*it]) continue;
+        typename MAPNODE::TreeType::NodeType* n = node_map->search(origin_inv.transform(points[*it]));
+        if (n && node_map->isNodeOccupied(n))
+          occupied[*it] = true;
+      }
+    }
+  }
+
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::getOccupancy(const point3d_collection& points, std::vector<double>& occupancies) const {
+    occupancies.assign(points.size(), 0.0);
+    std::vector<bool> known(points.size(), false);
+    std::vector<std::vector<unsigned int> > groups;
+    groupByNode(points, groups);
+
+    for (unsigned int i = 0; i < groups.size(); ++i) {
+      if (groups[i].empty()) continue;
+      MAPNODE* mapnode = nodes[i];
+      typename MAPNODE::TreeType* node_map = mapnode->getMap();
+      if (!node_map) continue;
+      const pose6d& origin_inv = mapnode->getOriginInverse();
+      for (std::vector<unsigned int>::const_iterator it = groups[i].begin(); it != groups[i].end(); ++it) {
+        typename MAPNODE::TreeType::NodeType* n = node_map->search(origin_inv.transform(points[*it]));
+        if (n) {
+          double occ = n->getOccupancy();
+          if (occ > occupancies[*it]) occupancies[*it] = occ;
+          known[*it] = true;
+        }
+      }
+    }
+
+    for (unsigned int j = 0; j < points.size(); ++j) {
+      if (!known[j]) occupancies[j] = 0.5;
+    }
+  }
+
 
   template <class MAPNODE>
   bool MapCollection<MAPNODE>::castRay(const point3d& origin, const point3d& direction, point3d& end,
@@ -193,14 +397,16 @@ namespace octomap {
     // SPEEDUP: use openMP to do raycasting in parallel
     // SPEEDUP: use bounding boxes to determine submaps 
     for (const_iterator it = this->begin(); it != this->end(); ++it) {
-      point3d origin_trans = (*it)->getOrigin().inv().transform(origin);
-      point3d direction_trans = (*it)->getOrigin().inv().rot().rotate(direction);
+      typename MAPNODE::TreeType* node_map = (*it)->getMap();
+      if (!node_map) continue;
+      point3d origin_trans = (*it)->getOriginInverse().transform(origin);
+      point3d direction_trans = (*it)->getOriginInverse().rot().rotate(direction);
       printf("ray from %.2f,%.2f,%.2f in dir %.2f,%.2f,%.2f in node %s\n",
              origin_trans.x(), origin_trans.y(), origin_trans.z(),
              direction_trans.x(), direction_trans.y(), direction_trans.z(),
              (*it)->getId().c_str());
       point3d temp_endpoint;
-      if ((*it)->getMap()->castRay(origin_trans, direction_trans, temp_endpoint, ignoreUnknownCells, maxRange)) {
+      if (node_map->castRay(origin_trans, direction_trans, temp_endpoint, ignoreUnknownCells, maxRange)) {
         printf("hit obstacle in node %s\n", (*it)->getId().c_str());
         double current_dist =  origin_trans.distance(temp_endpoint);
         if (current_dist < min_dist) {
@@ -236,6 +442,12 @@ namespace octomap {
     for(typename std::vector<MAPNODE* >::iterator it = nodes.begin(); it != nodes.end(); ++it){
       std::string id = (*it)->getId();
       pose6d origin = (*it)->getOrigin();
+      typename MAPNODE::TreeType* node_map = (*it)->getMap();
+      if (!node_map) {
+        OCTOMAP_ERROR_STR("Node " << id << " has no map, not written.");
+        ok = false;
+        continue;
+      }
       std::string nodemapFilename = "nodemap_";
       nodemapFilename.append(id);
       nodemapFilename.append(".bt");
@@ -244,6 +456,17 @@ namespace octomap {
       outfile << "MAPNODEFILENAME "<< nodemapFilename << "\n";
       outfile << "MAPNODEPOSE " << origin.x() << " " << origin.y() << " " << origin.z() << " "
               << origin.roll() << " " << origin.pitch() << " " << origin.yaw() << std::endl;
+      if (node_map->size() > 0) {
+        // bounds allow lazy reading to skip this node for queries outside of it
+        double minX, minY, minZ, maxX, maxY, maxZ;
+        node_map->getMetricMin(minX, minY, minZ);
+        node_map->getMetricMax(maxX, maxY, maxZ);
+        std::ostringstream bbxStream;
+        bbxStream.precision(9);
+        bbxStream << minX << " " << minY << " " << minZ << " " << maxX << " " << maxY << " " << maxZ;
+        // as a comment, older readers expect exactly three lines per node
+        outfile << "#MAPNODEBBX " << bbxStream.str() << "\n";
+      }
       ok = ok && (*it)->writeMap(nodemapFilename);
     }
     outfile.close();
@@ -280,6 +503,126 @@ namespace octomap {
     return 0;
   }
 
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::updateIndex() {
+    for (iterator it = this->begin(); it != this->end(); ++it)
+      (*it)->updateBounds();
+    buildIndex();
+  }
+
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::buildIndex() {
+    index_nodes.clear();
+    index_order.clear();
+    // queries only read these copies, the node bounds change when lazy nodes are loaded
+    index_bbx_min.resize(nodes.size());
+    index_bbx_max.resize(nodes.size());
+    for (unsigned int i = 0; i < nodes.size(); ++i) {
+      const point3d& bbx_min = index_bbx_min[i] = nodes[i]->getBBXMin();
+      const point3d& bbx_max = index_bbx_max[i] = nodes[i]->getBBXMax();
+      // nodes with empty bounds can never contain a query point
+      if (bbx_min.x() <= bbx_max.x() && bbx_min.y() <= bbx_max.y() && bbx_min.z() <= bbx_max.z())
+        index_order.push_back(i);
+    }
+    if (!index_order.empty()) {
+      index_nodes.reserve(2 * index_order.size());
+      buildIndexRecurs(0, (unsigned int) index_order.size());
+    }
+  }
+
+  template <class MAPNODE>
+  unsigned int MapCollection<MAPNODE>::buildIndexRecurs(unsigned int first, unsigned int last) {
+    const unsigned int max_leaf_size = 4;
+
+    unsigned int idx = (unsigned int) index_nodes.size();
+    index_nodes.push_back(IndexNode());
+    IndexNode node;
+    node.bbx_min = index_bbx_min[index_order[first]];
+    node.bbx_max = index_bbx_max[index_order[first]];
+    point3d center_min = (node.bbx_min + node.bbx_max) * 0.5;
+    point3d center_max = center_min;
+    for (unsigned int i = first + 1; i < last; ++i) {
+      const point3d& bbx_min = index_bbx_min[index_order[i]];
+      const point3d& bbx_max = index_bbx_max[index_order[i]];
+      point3d center = (bbx_min + bbx_max) * 0.5;
+      for (unsigned int j = 0; j < 3; ++j) {
+        if (bbx_min(j) < node.bbx_min(j)) node.bbx_min(j) = bbx_min(j);
+        if (bbx_max(j) > node.bbx_max(j)) node.bbx_max(j) = bbx_max(j);
+        if (center(j) < center_min(j)) center_min(j) = center(j);
+        if (center(j) > center_max(j)) center_max(j) = center(j);
+      }
+    }
+
+    if (last - first <= max_leaf_size) {
+      node.first = first;
+      node.count = last - first;
+      node.right = 0;
+    }
+    else {
+      // median split along the axis with the largest spread of node centers
+      unsigned int axis = 0;
+      point3d spread = center_max - center_min;
+      if (spread.y() > spread(axis)) axis = 1;
+      if (spread.z() > spread(axis)) axis = 2;
+      unsigned int mid = first + (last - first) / 2;
+      std::nth_element(index_order.begin() + first, index_order.begin() + mid,
+                       index_order.begin() + last, IndexCenterLess(index_bbx_min, index_bbx_max, axis));
+
+      node.first = first;
+      node.count = 0;
+      buildIndexRecurs(first, mid);
+      node.right = buildIndexRecurs(mid, last);
+    }
+    index_nodes[idx] = node;
+    return idx;
+  }
+
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::queryIndex(const point3d& p, std::vector<unsigned int>& candidates) const {
+    candidates.clear();
+    if (index_nodes.empty())
+      return;
+
+    std::vector<unsigned int> stack;
+    stack.push_back(0);
+    while (!stack.empty()) {
+      unsigned int idx = stack.back();
+      stack.pop_back();
+      const IndexNode& node = index_nodes[idx];
+      if (p.x() < node.bbx_min.x() || p.y() < node.bbx_min.y() || p.z() < node.bbx_min.z() ||
+          p.x() > node.bbx_max.x() || p.y() > node.bbx_max.y() || p.z() > node.bbx_max.z())
+        continue;
+
+      if (node.count > 0) {
+        for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+          const point3d& bbx_min = index_bbx_min[index_order[i]];
+          const point3d& bbx_max = index_bbx_max[index_order[i]];
+          if (p.x() >= bbx_min.x() && p.y() >= bbx_min.y() && p.z() >= bbx_min.z() &&
+              p.x() <= bbx_max.x() && p.y() <= bbx_max.y() && p.z() <= bbx_max.z())
+            candidates.push_back(index_order[i]);
+        }
+      }
+      else {
+        stack.push_back(node.right);
+        stack.push_back(idx + 1);
+      }
+    }
+    // keep the order of the collection, e.g. for queryNode()
+    std::sort(candidates.begin(), candidates.end());
+  }
+
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::groupByNode(const point3d_collection& points,
+                                           std::vector<std::vector<unsigned int> >& groups) const {
+    groups.assign(nodes.size(), std::vector<unsigned int>());
+    std::vector<unsigned int> candidates;
+    for (unsigned int j = 0; j < points.size(); ++j) {
+      queryIndex(points[j], candidates);
+      for (std::vector<unsigned int>::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+        groups[*it].push_back(j);
+    }
+  }
+
   template <class MAPNODE>
   void MapCollection<MAPNODE>::splitPathAndFilename(std::string &filenamefullpath, 
                                                     std::string* path, std::string *filename) {
@@ -312,15 +655,28 @@ namespace octomap {
   }
 
   template <class MAPNODE>
-  bool MapCollection<MAPNODE>::readTagValue(std::string tag, std::ifstream& infile, std::string* value) {
+  bool MapCollection<MAPNODE>::readTagValue(std::ifstream& infile, std::string* tag, std::string* value) {
     std::string line;
+    bool found = false;
     while( getline(infile, line) ){
-      if(line.length() != 0 && line[0] != '#')
+      if(line.length() != 0 && line[0] != '#'){
+        found = true;
+        break;
+      }
+      // optional bounds, written as a comment for older readers
+      if (line.compare(0, 12, "#MAPNODEBBX ") == 0) {
+        line.erase(0, 1);
+        found = true;
         break;
+      }
     }
+    *tag = "";
     *value = "";
+    if (!found)
+      return false;
     std::string::size_type firstSpace = line.find(' ');
     if(firstSpace != std::string::npos && firstSpace != line.size()-1){
+      *tag = line.substr(0, firstSpace);
       *value = line.substr(firstSpace + 1);
       return true;
     } 
@@ -36,8 +36,14 @@
 
 
 #include <string>
+#include <limits>
+#include <algorithm>
 #include <octomap/OcTree.h>
 
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
 namespace octomap {
 
   template <class TREETYPE>
@@ -46,13 +52,39 @@ namespace octomap {
   public:
     MapNode();
     MapNode(TREETYPE* node_map, pose6d origin);
-    MapNode(std::string filename, pose6d origin);
+    /**
+     * Creates a node from the map stored in a .bt file.
+     * @param lazy if true, only the filename is recorded and the map is read on
+     *   the first call to getMap() (or loadMap()). Until then the world bounds are
+     *   unbounded unless set with setLocalBounds().
+     *   Reading is guarded by a lock of the node, so concurrent queries may trigger it.
+     */
+    MapNode(std::string filename, pose6d origin, bool lazy = false);
     MapNode(const Pointcloud& cloud, pose6d origin);
     ~MapNode();
 
     typedef TREETYPE TreeType;
 
-    TREETYPE* getMap() { return  node_map; }
+    /**
+     * @return the node map, reading it from file first for lazily created nodes.
+     *   NULL if there is no map or it could not be read.
+     */
+    TREETYPE* getMap() {
+      if (map_filename.empty())
+        return node_map;
+      loadMap();
+      return node_map;
+    }
+    /// @return true if the node map is instantiated (false for lazy nodes not yet queried)
+    inline bool isLoaded() const { return node_map != 0; }
+    /// @return true if reading the node map from file failed (it is not retried)
+    inline bool loadFailed() const { return load_failed; }
+    /**
+     * Reads the node map from the filename it was created with (if not loaded yet).
+     * Thread-safe. A failure is reported once and remembered, the node then has no map.
+     * @return true if the node map is available
+     */
+    bool loadMap();
     
     void updateMap(const Pointcloud& cloud, point3d sensor_origin);
 
@@ -60,6 +92,24 @@ namespace octomap {
     inline void setId(std::string newid) { id = newid; }
 
     inline pose6d getOrigin() { return origin; }
+    /// cached inverse of the origin, maps world coordinates into the node map frame
+    inline const pose6d& getOriginInverse() const { return origin_inv; }
+    /// sets a new origin and updates the cached inverse and world bounds
+    void setOrigin(const pose6d& new_origin);
+
+    /// recomputes the world-space bounding box, call after changing the node map
+    void updateBounds();
+    /// sets the bounds of the node map in its own frame without loading it (for lazy nodes)
+    void setLocalBounds(const point3d& local_min, const point3d& local_max);
+    /// minimum corner of the axis-aligned world-space bounding box of the node map
+    inline const point3d& getBBXMin() const { return bbx_min; }
+    /// maximum corner of the axis-aligned world-space bounding box of the node map
+    inline const point3d& getBBXMax() const { return bbx_max; }
+    /// @return true if p (in world coordinates) lies within the world-space bounding box
+    inline bool inBBX(const point3d& p) const {
+      return (p.x() >= bbx_min.x() && p.y() >= bbx_min.y() && p.z() >= bbx_min.z() &&
+              p.x() <= bbx_max.x() && p.y() <= bbx_max.y() && p.z() <= bbx_max.z());
+    }
 
     // returns cloud of voxel centers in global reference frame
     Pointcloud generatePointcloud();
@@ -68,10 +118,22 @@ namespace octomap {
   protected:
     TREETYPE*    node_map;  // occupancy grid map
     pose6d       origin;    // origin and orientation relative to parent
+    pose6d       origin_inv; // cached origin.inv()
+    point3d      local_bbx_min; // bounds of node_map in its own frame (empty if min > max)
+    point3d      local_bbx_max;
+    bool         local_bbx_known;
+    point3d      bbx_min;   // world-space bounds of node_map (empty if min > max)
+    point3d      bbx_max;
     std::string  id;
+    std::string  map_filename; // file node_map is read from (lazy nodes)
+    bool         load_failed;  // reading map_filename failed, not retried
+#ifdef _OPENMP
+    omp_lock_t   load_lock;    // guards lazy reading of node_map
+#endif
 
     void clear();
     bool readMap(std::string filename);
+    void updateWorldBounds();
 
   };
 
@@ -34,40 +34,164 @@
 namespace octomap {
 
   template <class TREETYPE>
-  MapNode<TREETYPE>::MapNode(): node_map(0) {
+  MapNode<TREETYPE>::MapNode(): node_map(0), local_bbx_known(false), load_failed(false) {
+#ifdef _OPENMP
+    omp_init_lock(&load_lock);
+#endif
+    updateBounds();
   }
 
   template <class TREETYPE>
-  MapNode<TREETYPE>::MapNode(TREETYPE* in_node_map, pose6d in_origin) {
+  MapNode<TREETYPE>::MapNode(TREETYPE* in_node_map, pose6d in_origin): local_bbx_known(false), load_failed(false) {
+#ifdef _OPENMP
+    omp_init_lock(&load_lock);
+#endif
   	this->node_map = in_node_map;
-  	this->origin = in_origin;
+  	setOrigin(in_origin);
   }
 
   template <class TREETYPE>
-  MapNode<TREETYPE>::MapNode(const Pointcloud& in_cloud, pose6d in_origin): node_map(0) {
+  MapNode<TREETYPE>::MapNode(const Pointcloud& in_cloud, pose6d in_origin): node_map(0), local_bbx_known(false), load_failed(false) {
+#ifdef _OPENMP
+    omp_init_lock(&load_lock);
+#endif
+    setOrigin(in_origin);
   }
 
   template <class TREETYPE>
-  MapNode<TREETYPE>::MapNode(std::string filename, pose6d in_origin): node_map(0){
-  	readMap(filename);
-  	this->origin = in_origin;
+  MapNode<TREETYPE>::MapNode(std::string filename, pose6d in_origin, bool lazy)
+    : node_map(0), local_bbx_known(false), map_filename(filename), load_failed(false) {
+#ifdef _OPENMP
+    omp_init_lock(&load_lock);
+#endif
+  	origin = in_origin;
+  	origin_inv = origin.inv();
+    if (!lazy)
+      loadMap();
+    else
+      updateBounds();
   	id = filename;
   }
 
   template <class TREETYPE>
   MapNode<TREETYPE>::~MapNode() {
   	clear();
+#ifdef _OPENMP
+    omp_destroy_lock(&load_lock);
+#endif
   }
 
   template <class TREETYPE>
   void MapNode<TREETYPE>::updateMap(const Pointcloud& cloud, point3d sensor_origin) {
   }
 
+  template <class TREETYPE>
+  void MapNode<TREETYPE>::setOrigin(const pose6d& new_origin) {
+    origin = new_origin;
+    origin_inv = origin.inv();
+    updateBounds();
+  }
+
+  template <class TREETYPE>
+  void MapNode<TREETYPE>::updateBounds() {
+    if (node_map != 0) {
+      float max_val = std::numeric_limits<float>::max();
+      local_bbx_min = point3d(max_val, max_val, max_val);
+      local_bbx_max = point3d(-max_val, -max_val, -max_val);
+      if (node_map->size() > 0) {
+        double min_x, min_y, min_z, max_x, max_y, max_z;
+        node_map->getMetricMin(min_x, min_y, min_z);
+        node_map->getMetricMax(max_x, max_y, max_z);
+        local_bbx_min = point3d((float) min_x, (float) min_y, (float) min_z);
+        local_bbx_max = point3d((float) max_x, (float) max_y, (float) max_z);
+      }
+      local_bbx_known = true;
+    }
+    else if (map_filename.empty() || load_failed) {
+      // no map and nothing to load: empty bounds
+      float max_val = std::numeric_limits<float>::max();
+      local_bbx_min = point3d(max_val, max_val, max_val);
+      local_bbx_max = point3d(-max_val, -max_val, -max_val);
+      local_bbx_known = true;
+    }
+    updateWorldBounds();
+  }
+
+  template <class TREETYPE>
+  void MapNode<TREETYPE>::setLocalBounds(const point3d& local_min, const point3d& local_max) {
+    local_bbx_min = local_min;
+    local_bbx_max = local_max;
+    local_bbx_known = true;
+    updateWorldBounds();
+  }
+
+  template <class TREETYPE>
+  void MapNode<TREETYPE>::updateWorldBounds() {
+    float max_val = std::numeric_limits<float>::max();
+    if (!local_bbx_known) {
+      // not loaded yet and no bounds given: may contain anything
+      bbx_min = point3d(-max_val, -max_val, -max_val);
+      bbx_max = point3d(max_val, max_val, max_val);
+      return;
+    }
+    bbx_min = point3d(max_val, max_val, max_val);
+    bbx_max = point3d(-max_val, -max_val, -max_val);
+    if (local_bbx_min.x() > local_bbx_max.x() || local_bbx_min.y() > local_bbx_max.y()
+        || local_bbx_min.z() > local_bbx_max.z())
+      return;
+
+    // small margin against rounding when transforming query points
+    point3d margin = local_bbx_max - local_bbx_min;
+    float margin_val = 1e-4f * std::max(margin.x(), std::max(margin.y(), margin.z())) + 1e-5f;
+    margin = point3d(margin_val, margin_val, margin_val);
+    point3d min_corner = local_bbx_min - margin;
+    point3d max_corner = local_bbx_max + margin;
+
+    // transform all 8 corners of the local bounding box into the world frame
+    for (unsigned int i = 0; i < 8; ++i) {
+      point3d corner((i & 1) ? max_corner.x() : min_corner.x(),
+                     (i & 2) ? max_corner.y() : min_corner.y(),
+                     (i & 4) ? max_corner.z() : min_corner.z());
+      corner = origin.transform(corner);
+      for (unsigned int j = 0; j < 3; ++j) {
+        if (corner(j) < bbx_min(j)) bbx_min(j) = corner(j);
+        if (corner(j) > bbx_max(j)) bbx_max(j) = corner(j);
+      }
+    }
+  }
+
+  template <class TREETYPE>
+  bool MapNode<TREETYPE>::loadMap() {
+    if (map_filename.empty())
+      return node_map != 0;
+
+#ifdef _OPENMP
+    omp_set_lock(&load_lock);
+#endif
+    if (node_map == 0 && !load_failed) {
+      if (!readMap(map_filename)) {
+        OCTOMAP_WARNING_STR("Could not read node map " << map_filename << ", skipping it in queries.");
+        delete node_map;
+        node_map = 0;
+        load_failed = true;
+      }
+      updateBounds();
+    }
+    bool ok = (node_map != 0);
+#ifdef _OPENMP
+    omp_unset_lock(&load_lock);
+#endif
+    return ok;
+  }
+
   template <class TREETYPE>
   Pointcloud MapNode<TREETYPE>::generatePointcloud() {
     Pointcloud pc;
     point3d_list occs;
-    node_map->getOccupied(occs);
+    TREETYPE* map = getMap();
+    if (!map)
+      return pc;
+    map->getOccupied(occs);
     for(point3d_list::iterator it = occs.begin(); it != occs.end(); ++it){
     	pc.push_back(*it);
     }
@@ -80,7 +204,9 @@ namespace octomap {
   		delete node_map;
   		node_map = 0;
   		id = "";
-  		origin = pose6d(0.0,0.0,0.0,0.0,0.0,0.0);
+  		map_filename = "";
+  		load_failed = false;
+  		setOrigin(pose6d(0.0,0.0,0.0,0.0,0.0,0.0));
   	}
   }
 
@@ -95,7 +221,8 @@ namespace octomap {
 
   template <class TREETYPE>
   bool MapNode<TREETYPE>::writeMap(std::string filename){
-  	return node_map->writeBinary(filename);
+    TREETYPE* map = getMap();
+  	return map && map->writeBinary(filename);
   }
 
 } // namespace
@@ -199,6 +199,36 @@ namespace octomap {
      */
     NODE* search(const OcTreeKey& key, unsigned int depth = 0) const;
 
+    /**
+     *  Search a node given an addressing key like search(), but additionally report the depth
+     *  at which the search terminated. This is the depth of the returned node (which may be a
+     *  pruned leaf above max_depth), or, if NULL is returned, the depth of the unknown cube that
+     *  contains the key. The size of the returned node or unknown cube is getNodeSize(node_depth).
+     *
+     *  @param key addressing key of the query
+     *  @param[out] node_depth depth of the returned node or of the enclosing unknown cube
+     *  @param max_depth maximum depth to descend to (0: full tree depth)
+     *  @return pointer to node if found, NULL otherwise
+     */
+    NODE* searchWithDepth(const OcTreeKey& key, unsigned int& node_depth, unsigned int max_depth = 0) const;
+
+    /**
+     *  Searches the nodes of many keys at full depth, like search() for each key. The keys
+     *  are sorted by their Morton code (see computeMortonCode()) and looked up in depth-first
+     *  traversals, so that nodes shared by their paths are visited once instead of once per
+     *  key. With OpenMP, chunks of the sorted keys are searched in parallel.
+     *
+     *  @param keys addressing keys of the queries
+     *  @param[out] nodes node of each key, NULL if it is in unknown space
+     */
+    void search(const std::vector<OcTreeKey>& keys, std::vector<NODE*>& nodes) const;
+
+    /**
+     *  Like search(const std::vector<OcTreeKey>&, std::vector<NODE*>&), for keys given as
+     *  Morton codes which are already sorted in ascending order.
+     */
+    void searchSorted(const std::vector<uint64_t>& codes, std::vector<NODE*>& nodes) const;
+
     /**
      *  Delete a node (if exists) given a 3d point. Will always
      *  delete at the lowest level unless depth !=0, and expand pruned inner nodes as needed.
@@ -531,6 +561,10 @@ namespace octomap {
     
     size_t getNumLeafNodesRecurs(const NODE* parent) const;
 
+    /// recursive call of searchSorted() for the codes [begin, end) within node, writes their nodes to nodes
+    void searchSortedRecurs(NODE* node, unsigned int depth, const uint64_t* begin, const uint64_t* end,
+                            NODE** nodes) const;
+
   private:
     /// Assignment operator is private: don't (re-)assign octrees
     /// (const-parameters can't be changed) -  use the copy constructor instead.
@@ -539,6 +573,32 @@ namespace octomap {
   protected:  
     void allocNodeChildren(NODE* node);
 
+    /**
+     * Creates a new child like createNodeChild(), but without updating tree_size.
+     * Structural operations use this to build disjoint subtrees in parallel: the created
+     * nodes are counted in num_created and added to the tree size afterwards.
+     */
+    NODE* allocNodeChild(NODE* node, unsigned int childIdx, size_t& num_created);
+
+    /**
+     * Deletes all descendants of node, which becomes a leaf. Like allocNodeChild(),
+     * tree_size is not updated but the number of deleted nodes is added to num_deleted.
+     */
+    void deleteNodeDescendants(NODE* node, size_t& num_deleted);
+
+    /// Deletes the i-th child of node and its descendants, counted like deleteNodeDescendants()
+    void freeNodeChild(NODE* node, unsigned int childIdx, size_t& num_deleted);
+
+    /**
+     * Removes the i-th child (with its descendants) from node without deleting it, e.g. to
+     * move a subtree into another tree. node becomes a leaf if it was the last child.
+     * tree_size is not updated.
+     */
+    NODE* detachNodeChild(NODE* node, unsigned int childIdx);
+
+    /// Inserts a detached subtree as the i-th child of node (which must not exist), tree_size is not updated
+    void attachNodeChild(NODE* node, unsigned int childIdx, NODE* child);
+
     NODE* root; ///< Pointer to the root NODE, NULL for empty tree
 
     // constants of the tree
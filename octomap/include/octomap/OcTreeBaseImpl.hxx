@@ -34,6 +34,7 @@
 #undef max
 #undef min
 #include <limits>
+#include <algorithm>
 
 #ifdef _OPENMP
   #include <omp.h>
@@ -94,16 +95,10 @@ namespace octomap {
     size_changed = true;
 
     // create as many KeyRays as there are OMP_THREADS defined,
-    // one buffer for each thread
+    // one buffer for each thread (omp_get_max_threads() also holds
+    // when the tree is constructed inside a parallel region)
 #ifdef _OPENMP
-    #pragma omp parallel
-    #pragma omp critical
-    {
-      if (omp_get_thread_num() == 0){
-        this->keyrays.resize(omp_get_num_threads());
-      }
-
-    }
+    this->keyrays.resize(omp_get_max_threads());
 #else
     this->keyrays.resize(1);
 #endif
@@ -291,6 +286,70 @@ namespace octomap {
     }
   }
 
+  template <class NODE,class I>
+  NODE* OcTreeBaseImpl<NODE,I>::allocNodeChild(NODE* node, unsigned int childIdx, size_t& num_created){
+    assert(childIdx < 8);
+    if (node->children == NULL) {
+      allocNodeChildren(node);
+    }
+    assert (node->children[childIdx] == NULL);
+    NODE* newNode = new NODE();
+    node->children[childIdx] = static_cast<AbstractOcTreeNode*>(newNode);
+    num_created++;
+    return newNode;
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::deleteNodeDescendants(NODE* node, size_t& num_deleted){
+    if (node->children == NULL)
+      return;
+
+    for (unsigned int i=0; i<8; i++) {
+      if (node->children[i] != NULL){
+        NODE* child = static_cast<NODE*>(node->children[i]);
+        deleteNodeDescendants(child, num_deleted);
+        delete child;
+        num_deleted++;
+      }
+    }
+    delete[] node->children;
+    node->children = NULL;
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::freeNodeChild(NODE* node, unsigned int childIdx, size_t& num_deleted){
+    assert((childIdx < 8) && (node->children != NULL));
+    assert(node->children[childIdx] != NULL);
+    NODE* child = static_cast<NODE*>(node->children[childIdx]);
+    deleteNodeDescendants(child, num_deleted);
+    delete child;
+    num_deleted++;
+    node->children[childIdx] = NULL;
+  }
+
+  template <class NODE,class I>
+  NODE* OcTreeBaseImpl<NODE,I>::detachNodeChild(NODE* node, unsigned int childIdx){
+    assert((childIdx < 8) && (node->children != NULL));
+    assert(node->children[childIdx] != NULL);
+    NODE* child = static_cast<NODE*>(node->children[childIdx]);
+    node->children[childIdx] = NULL;
+    if (!nodeHasChildren(node)) {
+      delete[] node->children;
+      node->children = NULL;
+    }
+    return child;
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::attachNodeChild(NODE* node, unsigned int childIdx, NODE* child){
+    assert(childIdx < 8);
+    if (node->children == NULL) {
+      allocNodeChildren(node);
+    }
+    assert (node->children[childIdx] == NULL);
+    node->children[childIdx] = static_cast<AbstractOcTreeNode*>(child);
+  }
+
 
 
   template <class NODE,class I>
@@ -470,6 +529,92 @@ namespace octomap {
     return curNode;
   }
 
+  template <class NODE,class I>
+  NODE* OcTreeBaseImpl<NODE,I>::searchWithDepth(const OcTreeKey& key, unsigned int& node_depth,
+                                                unsigned int max_depth) const {
+    assert(max_depth <= tree_depth);
+    node_depth = 0;
+    if (root == NULL)
+      return NULL;
+
+    if (max_depth == 0)
+      max_depth = tree_depth;
+
+    NODE* curNode (root);
+    for (unsigned int d = 0; d < max_depth; ++d) {
+      if (!nodeHasChildren(curNode))
+        return curNode; // pruned leaf above max_depth
+
+      unsigned int pos = computeChildIdx(key, tree_depth-1-d);
+      if (!nodeChildExists(curNode, pos)) {
+        node_depth = d+1; // unknown cube of child size
+        return NULL;
+      }
+      curNode = getNodeChild(curNode, pos);
+      node_depth = d+1;
+    }
+    return curNode;
+  }
+
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::search(const std::vector<OcTreeKey>& keys, std::vector<NODE*>& nodes) const {
+    std::vector<std::pair<uint64_t, size_t> > sorted_keys(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+      sorted_keys[i] = std::make_pair(computeMortonCode(keys[i]), i);
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+
+    std::vector<uint64_t> codes(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+      codes[i] = sorted_keys[i].first;
+    std::vector<NODE*> sorted_nodes;
+    searchSorted(codes, sorted_nodes);
+
+    nodes.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+      nodes[sorted_keys[i].second] = sorted_nodes[i];
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::searchSorted(const std::vector<uint64_t>& codes, std::vector<NODE*>& nodes) const {
+    nodes.assign(codes.size(), NULL);
+    if (root == NULL || codes.empty())
+      return;
+
+    // contiguous chunks of sorted codes lie in neighboring subtrees
+    const size_t chunk_size = 4096;
+    const int num_chunks = (int) ((codes.size() + chunk_size - 1) / chunk_size);
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int c = 0; c < num_chunks; ++c) {
+      size_t begin = c * chunk_size;
+      size_t end = std::min(codes.size(), begin + chunk_size);
+      searchSortedRecurs(root, 0, &codes[0] + begin, &codes[0] + end, &nodes[begin]);
+    }
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::searchSortedRecurs(NODE* node, unsigned int depth, const uint64_t* begin,
+                                                  const uint64_t* end, NODE** nodes) const {
+    if (depth == tree_depth || !nodeHasChildren(node)) {
+      std::fill(nodes, nodes + (end - begin), node);
+      return;
+    }
+
+    // the child index at this depth is stored in the three bits above the child's subtree
+    const unsigned int shift = 3 * (tree_depth - 1 - depth);
+    while (begin != end) {
+      const uint64_t prefix = *begin >> shift;
+      const uint64_t* child_end = std::lower_bound(begin, end, (prefix + 1) << shift);
+      unsigned int pos = (unsigned int) (prefix & 7);
+      if (nodeChildExists(node, pos))
+        searchSortedRecurs(getNodeChild(node, pos), depth + 1, begin, child_end, nodes);
+      // otherwise unknown: nodes stay NULL
+      nodes += child_end - begin;
+      begin = child_end;
+    }
+  }
 
   template <class NODE,class I>
   bool OcTreeBaseImpl<NODE,I>::deleteNode(const point3d& value, unsigned int depth) {
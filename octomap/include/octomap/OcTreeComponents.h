@@ -0,0 +1,119 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_OCTREE_COMPONENTS_H
+#define OCTOMAP_OCTREE_COMPONENTS_H
+
+#include <vector>
+#include <octomap/octomap_types.h>
+#include <octomap/OcTreeKey.h>
+
+namespace octomap {
+
+  /**
+   * Connected components of the occupied space of an occupancy octree (two
+   * leafs are connected if they share a face, edge or corner), computed by
+   * OccupancyOcTreeBase::getConnectedComponents(). Pruned leafs are kept as
+   * single units, i.e. a component lists the leafs covering its voxels.
+   */
+  class OcTreeComponents {
+  public:
+    /// occupied leaf of a component, given as octree node
+    struct Leaf {
+      OcTreeKey key;      ///< key of the node, as returned by tree iterators
+      unsigned int depth; ///< depth of the node, its size is getNodeSize(depth)
+    };
+
+    struct Component {
+      Component() : min_key(0, 0, 0), max_key(0, 0, 0), volume(0.0), num_voxels(0) {}
+
+      std::vector<Leaf> leafs;
+      OcTreeKey min_key;             ///< lowest voxel key covered by the component
+      OcTreeKey max_key;             ///< highest voxel key covered by the component
+      point3d bbx_min;               ///< lower corner of the bounding box (m)
+      point3d bbx_max;               ///< upper corner of the bounding box (m)
+      double volume;                 ///< volume of all leafs (m^3)
+      unsigned long long num_voxels; ///< number of voxels at the finest resolution
+    };
+
+    OcTreeComponents() : tree_depth(0) {}
+
+    /// removes all components, for a tree of the given depth
+    void clear(unsigned int tree_depth = 0) {
+      this->tree_depth = tree_depth;
+      components.clear();
+      leaf_lookup.assign(tree_depth + 1, KeyIndexMap());
+    }
+
+    size_t size() const { return components.size(); }
+    unsigned int getTreeDepth() const { return tree_depth; }
+
+    /// @return index of the component containing the voxel key (finest level), -1 if none
+    int findComponent(const OcTreeKey& key) const {
+      for (int depth = (int) tree_depth; depth >= 0; --depth) {
+        if (leaf_lookup[depth].empty())
+          continue;
+        KeyIndexMap::const_iterator it = leaf_lookup[depth].find(computeIndexKey(tree_depth - depth, key));
+        if (it != leaf_lookup[depth].end())
+          return (int) it->second;
+      }
+      return -1;
+    }
+
+    /// registers (or relabels) the leafs of component idx for findComponent()
+    void addLookup(unsigned int idx) {
+      const std::vector<Leaf>& leafs = components[idx].leafs;
+      for (size_t i = 0; i < leafs.size(); ++i)
+        leaf_lookup[leafs[i].depth][computeIndexKey(tree_depth - leafs[i].depth, leafs[i].key)] = idx;
+    }
+
+    /// removes the leafs of component idx from the lookup for findComponent()
+    void removeLookup(unsigned int idx) {
+      const std::vector<Leaf>& leafs = components[idx].leafs;
+      for (size_t i = 0; i < leafs.size(); ++i)
+        leaf_lookup[leafs[i].depth].erase(computeIndexKey(tree_depth - leafs[i].depth, leafs[i].key));
+    }
+
+    std::vector<Component> components;
+
+  protected:
+    typedef unordered_ns::unordered_map<OcTreeKey, unsigned int, OcTreeKey::KeyHash> KeyIndexMap;
+
+    unsigned int tree_depth;
+    /// component index per leaf, by depth and index key of the leaf
+    std::vector<KeyIndexMap> leaf_lookup;
+  };
+
+} // namespace
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_OCTREE_DIFF_H
+#define OCTOMAP_OCTREE_DIFF_H
+
+#include <vector>
+#include <octomap/OcTreeKey.h>
+
+namespace octomap {
+
+  /**
+   * Differences between two occupancy octrees A and B, computed by
+   * OccupancyOcTreeBase::diff(). Contains statistics over the compared volume
+   * and the list of regions whose occupancy state (unknown, free, occupied)
+   * changed, each at the coarsest possible depth.
+   */
+  class OcTreeDiff {
+  public:
+    /// occupancy state of a region
+    enum State { UNKNOWN = 0, FREE = 1, OCCUPIED = 2 };
+
+    /// region with different states in A and B, given as octree node
+    struct Region {
+      OcTreeKey key;      ///< key of the node, as returned by tree iterators
+      unsigned int depth; ///< depth of the node, its size is getNodeSize(depth)
+      State state_a;      ///< state in tree A
+      State state_b;      ///< state in tree B
+    };
+
+    OcTreeDiff() { clear(); }
+
+    void clear() {
+      for (unsigned int i = 0; i < 3; ++i)
+        for (unsigned int j = 0; j < 3; ++j)
+          volume[i][j] = 0.0;
+      value_changed_volume = 0.0;
+      kld = 0.0;
+      regions.clear();
+    }
+
+    /// adds the statistics and regions of other
+    void add(const OcTreeDiff& other) {
+      for (unsigned int i = 0; i < 3; ++i)
+        for (unsigned int j = 0; j < 3; ++j)
+          volume[i][j] += other.volume[i][j];
+      value_changed_volume += other.value_changed_volume;
+      kld += other.kld;
+      regions.insert(regions.end(), other.regions.begin(), other.regions.end());
+    }
+
+    /// @return volume (m^3) whose state changed between A and B
+    double getChangedVolume() const {
+      double changed = 0.0;
+      for (unsigned int i = 0; i < 3; ++i)
+        for (unsigned int j = 0; j < 3; ++j)
+          if (i != j)
+            changed += volume[i][j];
+      return changed;
+    }
+
+    /// volume (m^3) with state i in A and state j in B (unknown in both is not counted)
+    double volume[3][3];
+    /// volume (m^3) known in both trees with the same state but different log-odds
+    double value_changed_volume;
+    /// Kullback-Leibler divergence of B from A, summed over all voxels (finest resolution) known in both
+    double kld;
+    /// regions with different states, at the coarsest depth
+    std::vector<Region> regions;
+  };
+
+} // namespace
+
+#endif
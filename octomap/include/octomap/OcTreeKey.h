@@ -40,6 +40,7 @@
 #include <ciso646>
 
 #include <assert.h>
+#include <stdint.h>
 
 /* Libc++ does not implement the TR1 namespace, all c++11 related functionality
  * is instead implemented in the std namespace.
@@ -218,6 +219,41 @@ namespace octomap {
     return pos;
   }
 
+  /// spreads the 16 bits of v to every third bit (helper of computeMortonCode())
+  inline uint64_t spreadKeyBits(key_type v) {
+    uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000ff0000ffULL;
+    x = (x | (x << 8))  & 0x00f00f00f00fULL;
+    x = (x | (x << 4))  & 0x0c30c30c30c3ULL;
+    x = (x | (x << 2))  & 0x249249249249ULL;
+    return x;
+  }
+
+  /**
+   * Computes the Morton code (Z-order) of a key by interleaving the bits of its
+   * coordinates, with the x bit lowest as in computeChildIdx(). The three bits at
+   * position 3*level are the child index at that level, so sorting keys by their
+   * Morton code orders them depth-first, like a traversal of the tree.
+   */
+  inline uint64_t computeMortonCode(const OcTreeKey& key) {
+    return spreadKeyBits(key[0]) | (spreadKeyBits(key[1]) << 1) | (spreadKeyBits(key[2]) << 2);
+  }
+
+  /// inverse of spreadKeyBits(): collects every third bit of x
+  inline key_type compactKeyBits(uint64_t x) {
+    x &= 0x249249249249ULL;
+    x = (x | (x >> 2))  & 0x0c30c30c30c3ULL;
+    x = (x | (x >> 4))  & 0x00f00f00f00fULL;
+    x = (x | (x >> 8))  & 0x0000ff0000ffULL;
+    x = (x | (x >> 16)) & 0xffffULL;
+    return (key_type) x;
+  }
+
+  /// inverse of computeMortonCode()
+  inline OcTreeKey mortonCodeToKey(uint64_t code) {
+    return OcTreeKey(compactKeyBits(code), compactKeyBits(code >> 1), compactKeyBits(code >> 2));
+  }
+
   /**
    * Generates a unique key for all keys on a certain level of the tree
    *
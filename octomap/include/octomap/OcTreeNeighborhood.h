@@ -0,0 +1,164 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_OCTREE_NEIGHBORHOOD_H
+#define OCTOMAP_OCTREE_NEIGHBORHOOD_H
+
+#include <vector>
+#include <octomap/OcTreeKey.h>
+
+namespace octomap {
+
+  /**
+   * Accessor for the neighbors of a node, as an alternative to one
+   * OcTreeBaseImpl::search() from the root per neighbor.
+   *
+   * The accessor is positioned on a cell (node key at a given depth) with
+   * moveTo() and caches the path from the root to it. Neighbors are found with
+   * key arithmetic and descend only from the common ancestor of the cell and the
+   * neighbor, which usually is a few levels above the cell. Neighbors are looked
+   * up at the same depth as the cell; if a neighbor is pruned at a coarser depth,
+   * the enclosing leaf is returned together with its depth (as in
+   * OcTreeBaseImpl::searchWithDepth()). Moving to a neighboring cell reuses the
+   * cached path as well, so walking along voxels is cheap.
+   *
+   * The cached path is invalidated by changes of the tree structure (e.g. by
+   * pruning, expanding or deleting nodes), call reset() afterwards.
+   *
+   * Example:
+   * \code
+   * OcTreeNeighborhood<OcTree> neighborhood(tree);
+   * for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it) {
+   *   neighborhood.moveTo(it.getKey(), it.getDepth());
+   *   OcTreeNode* nodes[27];
+   *   unsigned int depths[27];
+   *   neighborhood.getNeighborhood(nodes, depths);
+   *   // nodes[OcTreeNeighborhood<OcTree>::neighborIndex(1, 0, 0)] is the neighbor in +x ...
+   * }
+   * \endcode
+   */
+  template <class TREETYPE>
+  class OcTreeNeighborhood {
+  public:
+    typedef typename TREETYPE::NodeType NodeType;
+
+    /// @param tree octree to access, has to outlive the accessor
+    explicit OcTreeNeighborhood(const TREETYPE& tree);
+
+    /// clears the cached path, needed after the structure of the tree changed
+    void reset();
+
+    /**
+     * Positions the accessor on the cell containing key at the given depth.
+     *
+     * @param key addressing key of the cell (any key inside the cell)
+     * @param depth depth of the cell (0: full tree depth)
+     * @return node of the cell (may be a pruned leaf above depth) or NULL if unknown
+     */
+    NodeType* moveTo(const OcTreeKey& key, unsigned int depth = 0);
+
+    /// @return node of the current cell (see moveTo())
+    NodeType* getNode() const { return node; }
+    /// @return depth of the node of the current cell or of the enclosing unknown cube
+    unsigned int getNodeDepth() const { return node_depth; }
+    /// @return depth of the current cell as given to moveTo()
+    unsigned int getDepth() const { return depth; }
+    /// @return center key of the current cell (see OcTreeBaseImpl::iterator_base::getKey())
+    OcTreeKey getKey() const;
+
+    /**
+     * Computes the key of a neighboring cell at the same depth as the current one.
+     *
+     * @param dx,dy,dz offset of the neighbor in cells
+     * @param[out] neighbor_key center key of the neighbor cell
+     * @return false if the neighbor is outside of the tree's key range
+     */
+    bool getNeighborKey(int dx, int dy, int dz, OcTreeKey& neighbor_key) const;
+
+    /**
+     * Searches the node of a neighboring cell at the same depth as the current one.
+     *
+     * @param dx,dy,dz offset of the neighbor in cells (arbitrary, but cheapest for small offsets)
+     * @param[out] neighbor_depth depth of the returned node (may be coarser than the
+     *   current cell) or of the enclosing unknown cube, 0 outside of the tree's key range
+     * @return neighbor node or NULL if unknown or outside of the tree's key range
+     */
+    NodeType* getNeighbor(int dx, int dy, int dz, unsigned int& neighbor_depth) const;
+
+    /// same as getNeighbor() above without reporting the depth
+    NodeType* getNeighbor(int dx, int dy, int dz) const;
+
+    /**
+     * Searches the full 3x3x3 block of cells around the current one, each neighbor
+     * descending from its common ancestor with the current cell (see getNeighbor()).
+     * Cells are ordered by neighborIndex(), the center cell has index 13.
+     *
+     * @param[out] nodes neighbor nodes, NULL for unknown cells and outside of the tree
+     * @param[out] depths depths of the nodes or unknown cubes, 0 outside of the tree
+     */
+    void getNeighborhood(NodeType* nodes[27], unsigned int depths[27]) const;
+
+    /// @return index of the cell at offset (dx, dy, dz) in [-1, 1] in getNeighborhood()
+    static unsigned int neighborIndex(int dx, int dy, int dz) { return (dx+1) + 3*(dy+1) + 9*(dz+1); }
+
+    /**
+     * @param index cell index of getNeighborhood()
+     * @param connectivity 6 (faces), 18 (faces and edges) or 26 (faces, edges and corners)
+     * @return true if the cell at index is a neighbor of the center cell with the given connectivity
+     */
+    static bool isNeighbor(unsigned int index, unsigned int connectivity);
+
+  protected:
+    /// descends from start towards key down to max_depth, recording the nodes in path_out if given
+    NodeType* descend(NodeType* start, unsigned int start_depth, const OcTreeKey& key,
+                      unsigned int max_depth, unsigned int& found_depth,
+                      std::vector<NodeType*>* path_out = NULL) const;
+    /// @return depth of the deepest node containing both (index) keys
+    unsigned int commonDepth(const OcTreeKey& a, const OcTreeKey& b) const;
+
+    const TREETYPE& tree;
+    unsigned int tree_depth;
+
+    OcTreeKey cell_min;  ///< index key (min corner) of the current cell
+    unsigned int depth;
+    NodeType* node;
+    unsigned int node_depth;
+    std::vector<NodeType*> path;  ///< existing nodes from the root to the current cell
+    unsigned int path_depth;      ///< depth of the deepest node in path
+  };
+
+} // namespace
+
+#include "octomap/OcTreeNeighborhood.hxx"
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+namespace octomap {
+
+  template <class TREETYPE>
+  OcTreeNeighborhood<TREETYPE>::OcTreeNeighborhood(const TREETYPE& tree)
+    : tree(tree), tree_depth(tree.getTreeDepth()), cell_min(0, 0, 0), depth(tree_depth),
+      node(NULL), node_depth(0), path_depth(0)
+  {
+    reset();
+  }
+
+  template <class TREETYPE>
+  void OcTreeNeighborhood<TREETYPE>::reset() {
+    path.assign(tree_depth+1, NULL);
+    path[0] = tree.getRoot();
+    node = descend(path[0], 0, cell_min, depth, node_depth, &path);
+    path_depth = (node != NULL || node_depth == 0) ? node_depth : node_depth-1;
+  }
+
+  template <class TREETYPE>
+  typename OcTreeNeighborhood<TREETYPE>::NodeType*
+  OcTreeNeighborhood<TREETYPE>::moveTo(const OcTreeKey& key, unsigned int depth) {
+    assert(depth <= tree_depth);
+    if (depth == 0)
+      depth = tree_depth;
+
+    OcTreeKey new_min = computeIndexKey(tree_depth - depth, key);
+    // restart from the deepest cached node which also contains the new cell
+    unsigned int start = std::min(std::min(commonDepth(cell_min, new_min), path_depth), depth);
+    cell_min = new_min;
+    this->depth = depth;
+
+    node = descend(path[start], start, cell_min, depth, node_depth, &path);
+    path_depth = (node != NULL || node_depth == 0) ? node_depth : node_depth-1;
+    return node;
+  }
+
+  template <class TREETYPE>
+  OcTreeKey OcTreeNeighborhood<TREETYPE>::getKey() const {
+    key_type center_offset = (key_type) ((1 << (tree_depth - depth)) >> 1);
+    return OcTreeKey(cell_min[0] + center_offset, cell_min[1] + center_offset,
+                     cell_min[2] + center_offset);
+  }
+
+  template <class TREETYPE>
+  bool OcTreeNeighborhood<TREETYPE>::getNeighborKey(int dx, int dy, int dz,
+                                                    OcTreeKey& neighbor_key) const {
+    const int size = 1 << (tree_depth - depth);
+    const int max_key = (1 << tree_depth) - size;
+    const int offset[3] = {dx, dy, dz};
+    for (unsigned int i = 0; i < 3; ++i) {
+      int k = (int) cell_min[i] + offset[i] * size;
+      if (k < 0 || k > max_key)
+        return false;
+      neighbor_key[i] = (key_type) (k + (size >> 1));
+    }
+    return true;
+  }
+
+  template <class TREETYPE>
+  typename OcTreeNeighborhood<TREETYPE>::NodeType*
+  OcTreeNeighborhood<TREETYPE>::getNeighbor(int dx, int dy, int dz,
+                                            unsigned int& neighbor_depth) const {
+    OcTreeKey neighbor_key;
+    if (!getNeighborKey(dx, dy, dz, neighbor_key)) {
+      neighbor_depth = 0;
+      return NULL;
+    }
+    unsigned int start = std::min(std::min(commonDepth(cell_min, neighbor_key), path_depth), depth);
+    return descend(path[start], start, neighbor_key, depth, neighbor_depth);
+  }
+
+  template <class TREETYPE>
+  typename OcTreeNeighborhood<TREETYPE>::NodeType*
+  OcTreeNeighborhood<TREETYPE>::getNeighbor(int dx, int dy, int dz) const {
+    unsigned int neighbor_depth;
+    return getNeighbor(dx, dy, dz, neighbor_depth);
+  }
+
+  template <class TREETYPE>
+  void OcTreeNeighborhood<TREETYPE>::getNeighborhood(NodeType* nodes[27], unsigned int depths[27]) const {
+    for (int dz = -1; dz <= 1; ++dz) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          unsigned int idx = neighborIndex(dx, dy, dz);
+          if (idx == 13) {
+            nodes[idx] = node;
+            depths[idx] = node_depth;
+          }
+          else
+            nodes[idx] = getNeighbor(dx, dy, dz, depths[idx]);
+        }
+      }
+    }
+  }
+
+  template <class TREETYPE>
+  bool OcTreeNeighborhood<TREETYPE>::isNeighbor(unsigned int index, unsigned int connectivity) {
+    if (index >= 27 || index == 13)
+      return false;
+    unsigned int num_axes = (index % 3 != 1) + ((index / 3) % 3 != 1) + (index / 9 != 1);
+    if (connectivity == 6)
+      return num_axes == 1;
+    else if (connectivity == 18)
+      return num_axes <= 2;
+    return true;
+  }
+
+  template <class TREETYPE>
+  typename OcTreeNeighborhood<TREETYPE>::NodeType*
+  OcTreeNeighborhood<TREETYPE>::descend(NodeType* start, unsigned int start_depth, const OcTreeKey& key,
+                                        unsigned int max_depth, unsigned int& found_depth,
+                                        std::vector<NodeType*>* path_out) const {
+    found_depth = start_depth;
+    if (start == NULL)
+      return NULL;
+
+    NodeType* cur = start;
+    for (unsigned int d = start_depth; d < max_depth; ++d) {
+      if (!tree.nodeHasChildren(cur))
+        return cur; // pruned leaf above max_depth
+
+      unsigned int pos = computeChildIdx(key, tree_depth-1-d);
+      if (!tree.nodeChildExists(cur, pos)) {
+        found_depth = d+1; // unknown cube of child size
+        return NULL;
+      }
+      cur = tree.getNodeChild(cur, pos);
+      found_depth = d+1;
+      if (path_out)
+        (*path_out)[d+1] = cur;
+    }
+    return cur;
+  }
+
+  template <class TREETYPE>
+  unsigned int OcTreeNeighborhood<TREETYPE>::commonDepth(const OcTreeKey& a, const OcTreeKey& b) const {
+    unsigned int diff = (a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]);
+    unsigned int d = tree_depth;
+    while (diff) {
+      diff >>= 1;
+      --d;
+    }
+    return d;
+  }
+
+} // namespace
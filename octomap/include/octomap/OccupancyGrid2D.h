@@ -0,0 +1,127 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_OCCUPANCY_GRID_2D_H
+#define OCTOMAP_OCCUPANCY_GRID_2D_H
+
+#include <vector>
+#include <limits>
+#include <octomap/OcTreeKey.h>
+
+namespace octomap {
+
+  /**
+   * Dense 2D grid obtained by projecting the occupancy of an octree
+   * within a height band (see OccupancyOcTreeBase::project2D()).
+   * Cells are aligned with the octree voxels at the finest resolution
+   * and stored row-major (index = y * size_x + x).
+   *
+   * Each cell holds the projected occupancy (UNKNOWN, FREE or OCCUPIED, as
+   * used by common 2D costmaps) and the lowest and highest extent of the
+   * occupied voxels in the band, which forms a height map of the obstacles.
+   * Heights of cells without occupied voxels are NaN.
+   */
+  class OccupancyGrid2D {
+  public:
+    /// occupancy values of the cells
+    enum CellValue { UNKNOWN = -1, FREE = 0, OCCUPIED = 100 };
+
+    OccupancyGrid2D() : resolution(0.0), origin_x(0.0), origin_y(0.0), size_x(0), size_y(0) {}
+
+    /// @return number of cells in x
+    unsigned int getSizeX() const { return size_x; }
+    /// @return number of cells in y
+    unsigned int getSizeY() const { return size_y; }
+    /// @return edge length of a cell (meters)
+    double getResolution() const { return resolution; }
+    /// @return x coordinate of the lower corner of the grid
+    double getOriginX() const { return origin_x; }
+    /// @return y coordinate of the lower corner of the grid
+    double getOriginY() const { return origin_y; }
+
+    /// @return index of the cell (x, y) in the data arrays
+    size_t index(unsigned int x, unsigned int y) const { return size_t(y) * size_x + x; }
+
+    /// @return true if the 2D coordinate lies within the grid, cell indices returned in x, y
+    bool coordToCell(double px, double py, unsigned int& x, unsigned int& y) const {
+      if (px < origin_x || py < origin_y)
+        return false;
+      x = (unsigned int) ((px - origin_x) / resolution);
+      y = (unsigned int) ((py - origin_y) / resolution);
+      return (x < size_x && y < size_y);
+    }
+
+    signed char getOccupancy(unsigned int x, unsigned int y) const { return occupancy[index(x, y)]; }
+    float getMinHeight(unsigned int x, unsigned int y) const { return min_height[index(x, y)]; }
+    float getMaxHeight(unsigned int x, unsigned int y) const { return max_height[index(x, y)]; }
+
+    /// resets all cells to UNKNOWN for a grid of the given geometry
+    void reset(double resolution, double origin_x, double origin_y,
+               unsigned int size_x, unsigned int size_y) {
+      this->resolution = resolution;
+      this->origin_x = origin_x;
+      this->origin_y = origin_y;
+      this->size_x = size_x;
+      this->size_y = size_y;
+      size_t num_cells = size_t(size_x) * size_y;
+      occupancy.assign(num_cells, UNKNOWN);
+      min_height.assign(num_cells, std::numeric_limits<float>::quiet_NaN());
+      max_height.assign(num_cells, std::numeric_limits<float>::quiet_NaN());
+    }
+
+    /// resets a single cell to UNKNOWN
+    void resetCell(size_t idx) {
+      occupancy[idx] = UNKNOWN;
+      min_height[idx] = std::numeric_limits<float>::quiet_NaN();
+      max_height[idx] = std::numeric_limits<float>::quiet_NaN();
+    }
+
+    std::vector<signed char> occupancy; ///< projected occupancy per cell
+    std::vector<float> min_height;      ///< lower extent of occupied voxels per cell
+    std::vector<float> max_height;      ///< upper extent of occupied voxels per cell
+
+    /// octree keys of the projected volume (x/y: grid extent, z: height band), set by the tree
+    OcTreeKey min_key;
+    OcTreeKey max_key;
+
+  protected:
+    double resolution;
+    double origin_x;
+    double origin_y;
+    unsigned int size_x;
+    unsigned int size_y;
+  };
+
+} // namespace
+
+#endif
@@ -43,6 +43,14 @@
 #include "octomap_utils.h"
 #include "OcTreeBaseImpl.h"
 #include "AbstractOccupancyOcTree.h"
+#include "SensorModel.h"
+#include "OccupancyGrid2D.h"
+#include "PointCloudWriter.h"
+#include "LikelihoodField.h"
+#include "IndexedMesh.h"
+#include "OcTreeDiff.h"
+#include "ScanEvaluation.h"
+#include "OcTreeComponents.h"
 
 
 namespace octomap {
@@ -145,6 +153,32 @@ namespace octomap {
      */
      virtual void insertPointCloudRays(const Pointcloud& scan, const point3d& sensor_origin, double maxrange = -1., bool lazy_eval = false);
 
+    /**
+     * Integrates a Pointcloud (in global reference frame) like insertPointCloud(), with the
+     * log-odds updates of a sensor model instead of the constant hit and miss probabilities.
+     * The model is a functor float model(size_t beam, float distance, float range, bool hit),
+     * which returns the update of a cell traversed by (hit: containing the endpoint of) the
+     * ray of scan[beam] at distance from the sensor along the ray, for the measured range
+     * (see ConstantSensorModel and RangeSensorModel). It is called concurrently with OpenMP.
+     *
+     * The updates of cells shared by several rays are combined while the keys are collected
+     * (in per-thread maps, so no additional pass is needed). Endpoints take precedence over
+     * traversed cells as in computeUpdate(). With ACCUMULATE_MAX and a ConstantSensorModel of
+     * the tree's probabilities, the result equals insertPointCloud().
+     *
+     * @param scan Pointcloud (measurement endpoints), in global reference frame
+     * @param sensor_origin measurement origin in global reference frame
+     * @param model sensor model functor
+     * @param maxrange maximum range for how long individual beams are inserted (default -1: complete beam)
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     *   This speeds up the insertion, but you need to call updateInnerOccupancy() when done.
+     * @param accumulation how the updates of the rays are combined per cell
+     */
+    template <class SENSOR_MODEL>
+    void insertPointCloudWithModel(const Pointcloud& scan, const point3d& sensor_origin, const SENSOR_MODEL& model,
+                                   double maxrange = -1., bool lazy_eval = false,
+                                   AbstractOccupancyOcTree::UpdateAccumulation accumulation = AbstractOccupancyOcTree::ACCUMULATE_MAX);
+
      /**
       * Set log_odds value of voxel to log_odds_value. This only works if key is at the lowest
       * octree level
@@ -327,7 +361,65 @@ namespace octomap {
 		 * @return True if the input voxel is known in the occupancy grid, and false if it is unknown.
 		 */
 		bool getNormals(const point3d& point, std::vector<point3d>& normals, bool unknownStatus=true) const;
+
+    /**
+     * Batch version of getNormals() for all occupied leaves, in the order of
+     * leaf_iterator. Neighboring voxels are sampled once per block of voxels
+     * instead of searched per cube corner, blocks are processed in parallel.
+     *
+     * @param[out] centers center of each occupied leaf
+     * @param[out] normals per leaf the normalized sum of the triangle normals getNormals()
+     *   returns for its center, (0,0,0) if it is not at the surface (e.g. inner voxels
+     *   and voxels inside of pruned leaves)
+     * @param[in] unknownStatus consider unknown cells as free (false) or occupied (default, true).
+     */
+    void getLeafNormals(point3d_collection& centers, point3d_collection& normals, bool unknownStatus=true) const;
+
+    /**
+     * Same as getLeafNormals(point3d_collection&, point3d_collection&, bool), limited to
+     * the occupied leaves with their centers within the bounding box [min, max].
+     */
+    void getLeafNormals(const point3d& min, const point3d& max, point3d_collection& centers,
+                        point3d_collection& normals, bool unknownStatus=true) const;
+
+    /**
+     * Evaluates the expected information gain of candidate sensor poses, e.g. for
+     * next-best-view planning. For each candidate, the ray fan of the sensor model is
+     * cast into the map and the number of distinct unknown voxels (at the finest
+     * resolution) observed before the first occupied voxel or the maximum range is counted.
+     * Known free space is skipped along the rays in steps of whole (pruned) nodes.
+     * Candidates are evaluated in parallel when compiled with OpenMP.
+     *
+     * @param[in] candidates candidate sensor poses, the sensor looks along the local x-axis
+     * @param[in] sensor field of view, angular resolution and maximum range of the sensor
+     * @param[out] gains number of unknown voxels observed for each candidate (same order)
+     */
+    void computeInformationGain(const std::vector<pose6d>& candidates, const FovSensorModel& sensor,
+                                std::vector<double>& gains);
 	
+    /**
+     * Projects the occupancy of all nodes within a height band onto a dense 2D grid
+     * (e.g. a costmap for ground robots). A grid cell is OCCUPIED if an occupied node
+     * overlaps its column within the band, FREE if only free nodes do and UNKNOWN otherwise.
+     * The lowest and highest extent of the occupied nodes are stored as height map.
+     *
+     * The tree is traversed hierarchically, nodes larger than a cell are filled in
+     * as rectangles without expanding them. With OpenMP, tiles of the grid are
+     * projected in parallel.
+     *
+     * @param[in] min lower corner of the projected volume, z is the bottom of the height band
+     * @param[in] max upper corner of the projected volume, z is the top of the height band
+     * @param[out] grid resulting grid at the tree resolution, covering [min.x, max.x] x [min.y, max.y]
+     * @return false if the volume is out of the tree bounds
+     */
+    bool project2D(const point3d& min, const point3d& max, OccupancyGrid2D& grid) const;
+
+    /**
+     * Updates a grid obtained from project2D() by projecting only the columns which
+     * contain changed keys (see enableChangeDetection()). Call it before resetChangeDetection().
+     */
+    void updateProjection2D(OccupancyGrid2D& grid) const;
+
     //-- set BBX limit (limits tree updates to this bounding box)
 
     ///  use or ignore BBX limit (default: ignore)
@@ -403,6 +495,60 @@ namespace octomap {
                        KeySet& occupied_cells,
                        double maxrange);
 
+    /**
+     * Evaluates how well the map predicts a scan: the cells the scan would update as free
+     * and occupied (as in computeUpdate()) are compared with their state in the map. The
+     * tree is not modified. With OpenMP, the rays are cast in parallel (with per-thread
+     * key buffers) and the cells are looked up with the batched searchSorted().
+     *
+     * @param scan point cloud measurement (global reference frame)
+     * @param origin origin of the sensor for ray casting
+     * @param maxrange maximum range for raycasting (-1: unlimited)
+     * @param[in,out] result the counts of the scan are added to result
+     */
+    void evaluateScan(const Pointcloud& scan, const octomap::point3d& origin, double maxrange,
+                      ScanEvaluation& result) const;
+
+    /**
+     * Computes the cells of computeUpdate() as sorted Morton codes (see computeMortonCode())
+     * without duplicates, occupied cells are removed from the free ones. Unlike
+     * computeUpdate(), it does not modify the tree and can be called from several threads.
+     */
+    void computeUpdateCodes(const Pointcloud& scan, const point3d& origin, double maxrange,
+                            std::vector<uint64_t>& free_codes, std::vector<uint64_t>& occupied_codes) const;
+
+    /**
+     * Scores candidate poses of a scan against the map, e.g. the particles of a localizer.
+     * For each pose, the points of scan (in the sensor frame) are transformed into the map
+     * and the points in occupied cells are counted. The cells of a pose are looked up in
+     * Morton order (see searchSorted()), so the paths shared by nearby points are descended
+     * once. Points are transformed in double precision, the cells are the same as for
+     * search() on the transformed points except for points within float rounding of a
+     * cell boundary (pose6d::transform() computes in float). Points outside of the tree
+     * are not counted. With OpenMP, poses are scored in parallel.
+     *
+     * @param scan points in the sensor frame, e.g. a downsampled scan
+     * @param poses candidate sensor poses in the map frame
+     * @param[out] hits number of points in occupied cells for each pose
+     */
+    void scorePoses(const Pointcloud& scan, const std::vector<pose6d>& poses, std::vector<unsigned int>& hits) const;
+
+    /**
+     * Computes the likelihood field of the occupied voxels within the box [min, max] at the
+     * tree resolution, for scoring poses with LikelihoodField::scorePoses() instead of tree
+     * lookups. Occupied leafs are rasterized into the dense grid without expanding them,
+     * distances are computed up to 4 sigma (where the likelihood has dropped below 0.1% of
+     * its peak). Occupied voxels outside of the box are not considered, extend it by that
+     * distance to include their influence. The grid stores 8 bytes per cell.
+     *
+     * @param sigma standard deviation of the endpoint noise (meters)
+     * @param random_prob likelihood of random measurements (in (0, 1]), the minimum of the field
+     * @param[out] field resulting likelihood field
+     * @return false if the box is out of the tree bounds
+     */
+    bool computeLikelihoodField(const point3d& min, const point3d& max, double sigma, double random_prob,
+                                LikelihoodField& field) const;
+
 
     // -- I/O  -----------------------------------------
 
@@ -449,6 +595,179 @@ namespace octomap {
      **/
     void updateInnerOccupancy();
 
+    /**
+     * Merges another tree of the same resolution into this tree. Both trees are traversed
+     * in lockstep: subtrees that are unknown in this tree are copied as a whole, overlapping
+     * nodes are fused according to the policy (the values are clamped), and pruned nodes of
+     * either tree are only expanded where the other tree is more detailed. The occupancy of
+     * affected inner nodes is recomputed once on the way back up. With OpenMP, the octants
+     * of the root are merged in parallel.
+     *
+     * The result is not pruned, call prune() afterwards for a compact tree. Changed keys
+     * are not tracked. Additional data of inner nodes (e.g. colors) is not updated.
+     *
+     * @param other tree to merge into this one, remains unchanged
+     * @param policy how to fuse nodes known in both trees (default: add log-odds)
+     * @return false if the trees are not compatible
+     */
+    bool merge(const OccupancyOcTreeBase<NODE>& other, AbstractOccupancyOcTree::MergePolicy policy = AbstractOccupancyOcTree::MERGE_ADD);
+
+    /**
+     * Resamples the tree under a rigid transformation, e.g. to align submaps or after a
+     * loop closure. Each node of the result is mapped back into this tree (inverse mapping),
+     * so a result node becomes a single leaf when it lies completely within a leaf or
+     * unknown cube of this tree, and is subdivided otherwise. Voxels at the finest resolution
+     * take the value at their transformed center. Translations by whole voxels without
+     * rotation are mapped exactly by offsetting the keys. With OpenMP, subtrees of the
+     * result are built in parallel.
+     *
+     * @param transform transformation applied to this tree
+     * @param[out] result tree receiving the transformed map (its resolution may differ,
+     *   existing nodes are cleared)
+     * @return false if result is this tree
+     */
+    bool transformed(const pose6d& transform, OccupancyOcTreeBase<NODE>& result) const;
+
+    /**
+     * Removes all subtrees that lie completely outside of the box [min, max], e.g. to keep
+     * only a local map. Subtrees are only tested down to crop_depth, so the cost depends on
+     * the number of nodes of that depth along the boundary and not on the size of the map;
+     * nodes that cross the boundary at crop_depth are kept. Inner nodes are updated.
+     *
+     * @param min minimum corner of the box
+     * @param max maximum corner of the box
+     * @param crop_depth finest depth of removed subtrees, 0 selects the depth of nodes with
+     *   at least 1/16 of the box extent
+     * @param spill if not NULL, removed subtrees are moved into this tree (same resolution)
+     *   instead of being deleted, e.g. to write them to disk. Their leafs replace known
+     *   nodes of spill.
+     * @return number of nodes removed from this tree
+     */
+    size_t cropToBBX(const point3d& min, const point3d& max, unsigned int crop_depth = 0,
+                     OccupancyOcTreeBase<NODE>* spill = NULL);
+
+    /// Removes all subtrees completely outside of the sphere around center, see cropToBBX()
+    size_t cropToSphere(const point3d& center, double radius, unsigned int crop_depth = 0,
+                        OccupancyOcTreeBase<NODE>* spill = NULL);
+
+    /**
+     * Enables a rolling local map: after each insertPointCloud(), the map is cropped with
+     * cropToSphere() around the sensor origin whenever the sensor moved by more than
+     * radius / 8 since the last crop. Memory and update costs then stay bounded on long
+     * missions.
+     *
+     * @param radius of the local map, <= 0 disables cropping (default)
+     * @param spill optional tree receiving the removed subtrees (see cropToBBX())
+     */
+    void setLocalMapRadius(double radius, OccupancyOcTreeBase<NODE>* spill = NULL);
+    double getLocalMapRadius() const { return local_map_radius; }
+
+    /**
+     * Compares this tree (A) with another tree (B) of the same resolution. Both trees are
+     * traversed in lockstep, pruned nodes are only expanded virtually where the other tree
+     * is more detailed. The result contains the volume of all state transitions
+     * (unknown / free / occupied), the volume of value-only changes, the KL divergence of B
+     * from A at the finest resolution and the regions that changed their state, coalesced
+     * to the coarsest depth. With OpenMP, subtrees are compared in parallel.
+     *
+     * @param other tree B
+     * @param[out] result differences of other with respect to this tree
+     * @return false if the trees are not compatible
+     */
+    bool diff(const OccupancyOcTreeBase<NODE>& other, OcTreeDiff& result) const;
+
+    /**
+     * Labels the connected components of the occupied space (26-neighborhood) with
+     * union-find. Neighbors are found by descending only into nodes that touch a leaf
+     * and contain occupied space, so pruned leafs are single units. With OpenMP, the
+     * leafs of different subtrees are processed in parallel and merged afterwards.
+     * Requires up-to-date inner nodes (see updateInnerOccupancy()).
+     *
+     * @param[out] components occupied leafs, bounding box and size of each component
+     */
+    void getConnectedComponents(OcTreeComponents& components) const;
+
+    /**
+     * Updates components obtained from getConnectedComponents() after changes
+     * tracked by the change detection (see enableChangeDetection()). Only the
+     * components touching changed keys are recomputed, by flood fill. Component
+     * indices are not preserved. Call it before resetChangeDetection().
+     */
+    void updateConnectedComponents(OcTreeComponents& components) const;
+
+    /**
+     * Dilates the occupied space by a radius, e.g. to plan in the configuration space of
+     * a spherical robot. A voxel of the result is occupied if its center lies within the
+     * radius of the center of an occupied voxel of this tree; it is then set to the
+     * maximum clamping value (with the data of that voxel otherwise, e.g. its color).
+     * All other nodes are copies of this tree (including unknown space). The result is
+     * built hierarchically: nodes completely within the radius of an occupied leaf become
+     * single leafs and subtrees away from occupied space are copied as a whole. With OpenMP,
+     * subtrees of the result are built in parallel. Requires up-to-date inner nodes
+     * (see updateInnerOccupancy()).
+     *
+     * @param radius inflation radius in meters
+     * @param[out] result tree receiving the inflated map (same resolution, existing nodes are cleared)
+     * @return false if result is this tree or has a different resolution
+     */
+    bool inflated(double radius, OccupancyOcTreeBase<NODE>& result) const;
+
+    /**
+     * Updates a tree obtained from inflated() after changes tracked by the change
+     * detection (see enableChangeDetection()). Only the blocks of 16^3 voxels within the
+     * radius of changed keys are rebuilt (in parallel with OpenMP). As the change detection
+     * only tracks changes of the occupancy state, other value changes are not propagated.
+     * Call it before resetChangeDetection().
+     *
+     * @param radius inflation radius in meters, as given to inflated()
+     * @param[in,out] result inflated tree to update
+     * @return false if result is this tree or has a different resolution
+     */
+    bool updateInflated(double radius, OccupancyOcTreeBase<NODE>& result) const;
+
+    /**
+     * Integrates a dense occupancy grid aligned with the tree's voxels, e.g. a voxelized
+     * CAD model. The result is the same as calling updateNode() with a hit for every
+     * occupied cell (and a miss for every free one if mark_free is set), followed by
+     * updateInnerOccupancy() and prune(), but the nodes are built bottom-up: uniform
+     * blocks are collapsed on the fly and no per-cell root descent is needed. With OpenMP,
+     * subtrees are built in parallel. The change detection is not updated.
+     *
+     * @param min_key key of grid cell (0, 0, 0)
+     * @param size_x number of grid cells in x direction (likewise size_y, size_z)
+     * @param cells grid values, cell (x, y, z) is cells[x*stride_x + y*stride_y + z*stride_z],
+     *   non-zero values are occupied
+     * @param stride_x offset between neighboring cells in x direction (likewise stride_y, stride_z)
+     * @param mark_free integrate zero cells as free, otherwise they are skipped (unknown)
+     * @return false if the grid exceeds the tree's key range (nothing is integrated)
+     */
+    bool insertDenseGrid(const OcTreeKey& min_key, unsigned int size_x, unsigned int size_y,
+                         unsigned int size_z, const unsigned char* cells, size_t stride_x,
+                         size_t stride_y, size_t stride_z, bool mark_free = false);
+
+    /**
+     * Writes the centers of all occupied voxels at the finest resolution (header and
+     * points, in depth-first order). Pruned leafs are enumerated directly, the tree is
+     * not expanded. The centers are computed in batches (in parallel with OpenMP) and
+     * streamed to writer, so the memory use is bounded by the batch size. Call
+     * writer.finish() afterwards. Requires up-to-date inner nodes (see updateInnerOccupancy()).
+     *
+     * @return number of points written
+     */
+    size_t writeOccupiedVoxelCenters(PointCloudWriter& writer) const;
+
+    /**
+     * Computes the exposed faces of the occupied leafs as a mesh, i.e. the faces
+     * bordering free or unknown space (or the tree bounds). Pruned leafs are kept as
+     * single boxes and faces hidden by occupied neighbors of any size are skipped.
+     * Vertices are shared between faces, triangles are counter-clockwise when seen from
+     * outside. With OpenMP, the faces of chunks of leafs are computed in parallel.
+     * Requires up-to-date inner nodes (see updateInnerOccupancy()).
+     *
+     * @param[out] mesh surface of the occupied space (previous content is cleared)
+     */
+    void getVoxelSurfaceMesh(IndexedMesh& mesh) const;
+
 
     /// integrate a "hit" measurement according to the tree's sensor model
     virtual void integrateHit(NODE* occupancyNode) const;
@@ -473,6 +792,26 @@ namespace octomap {
      */
     inline bool integrateMissOnRay(const point3d& origin, const point3d& end, bool lazy_eval = false);
 
+    /// accumulated log-odds update of a key in insertPointCloudWithModel()
+    struct KeyUpdate {
+      KeyUpdate(float log_odds, bool hit) : log_odds(log_odds), hit(hit) {}
+      float log_odds;
+      bool hit; ///< true if the key contains an endpoint, updates of traversing rays are then ignored
+    };
+    typedef unordered_ns::unordered_map<OcTreeKey, KeyUpdate, OcTreeKey::KeyHash> KeyUpdateMap;
+
+    /**
+     * Helper for insertPointCloudWithModel(): casts the rays of scan and collects the updates of
+     * model per key in updates.
+     */
+    template <class SENSOR_MODEL>
+    void computeModelUpdate(const Pointcloud& scan, const point3d& origin, const SENSOR_MODEL& model, double maxrange,
+                            AbstractOccupancyOcTree::UpdateAccumulation accumulation, KeyUpdateMap& updates);
+
+    /// combines the update of key with the updates collected so far
+    static void accumulateUpdate(KeyUpdateMap& updates, const OcTreeKey& key, float log_odds, bool hit,
+                                 AbstractOccupancyOcTree::UpdateAccumulation accumulation);
+
 
     // recursive calls ----------------------------
 
@@ -486,6 +825,247 @@ namespace octomap {
     
     void toMaxLikelihoodRecurs(NODE* node, unsigned int depth, unsigned int max_depth);
 
+    /// recursive call of merge(), counts created and deleted nodes of this tree
+    void mergeRecurs(NODE* node, const NODE* other_node, AbstractOccupancyOcTree::MergePolicy policy,
+                     size_t& num_created, size_t& num_deleted);
+
+    /// deep copy of other_node's data and descendants into node
+    void copyNodeRecurs(NODE* node, const NODE* other_node, size_t& num_created);
+
+    /// fuses the value of other_node into node
+    void mergeNodeValue(NODE* node, const NODE* other_node, AbstractOccupancyOcTree::MergePolicy policy) const;
+
+    /// subtree of a structural operation that is deferred and then processed in parallel
+    struct SubtreeTask {
+      NODE* node;
+      unsigned int depth;
+      OcTreeKey min_key; ///< lowest key covered by the node
+      bool has_content;  ///< whether the node contains known space after processing
+    };
+
+    /**
+     * Recursive call of transformed(): fills result's node covering the keys starting at
+     * min_key, returns false if it remains unknown. key_offset is NULL for a general
+     * transformation. Nodes at task_depth are deferred to tasks (if not NULL).
+     */
+    bool transformRecurs(OccupancyOcTreeBase<NODE>& result, NODE* node, unsigned int depth,
+                         const OcTreeKey& min_key, const pose6d& inverse, const int* key_offset,
+                         std::vector<SubtreeTask>* tasks, unsigned int task_depth,
+                         size_t& num_created, size_t& num_deleted) const;
+
+    /// @return true if a known node intersects the inclusive key range [first, last]
+    bool intersectsKnownRecurs(const NODE* node, unsigned int depth, unsigned int x0, unsigned int y0,
+                               unsigned int z0, const int* first, const int* last) const;
+
+    /**
+     * Completes the nodes above task_depth after the tasks have been processed: deletes
+     * unknown subtrees and prunes or updates the inner nodes. Returns false if node is unknown.
+     */
+    bool finishSubtreeTasksRecurs(NODE* node, unsigned int depth, unsigned int task_depth,
+                                  const std::vector<SubtreeTask>& tasks, size_t& task_idx,
+                                  size_t& num_deleted);
+
+    /// subtree comparison of diff() that is deferred and then processed in parallel
+    struct DiffTask {
+      const NODE* node;
+      const NODE* other_node;
+      unsigned int depth;
+      OcTreeKey min_key;
+      OcTreeDiff result;
+      bool changed;
+    };
+
+    /**
+     * Recursive call of diff() for node and other_node (NULL: unknown) covering the keys
+     * starting at min_key. Returns true if the whole node changed its state, then it was
+     * added as a single region. Without tasks, the comparison is done directly. Otherwise,
+     * the subtrees at task_depth are collected (task_idx == NULL) or their results are
+     * combined into the upper levels.
+     */
+    bool diffRecurs(const OccupancyOcTreeBase<NODE>& other, const NODE* node, const NODE* other_node,
+                    unsigned int depth, const OcTreeKey& min_key, OcTreeDiff& result,
+                    std::vector<DiffTask>* tasks, size_t* task_idx, unsigned int task_depth) const;
+
+    /**
+     * Prunes node if its children are identical leafs, otherwise updates its occupancy
+     * from the children. Unlike pruneNode(), tree_size is not modified (see allocNodeChild()).
+     */
+    void pruneOrUpdateNode(NODE* node, size_t& num_deleted);
+
+    /// projects node (with key range starting at x0, y0, z0) onto the grid cells in [x_min, x_max] x [y_min, y_max]
+    void project2DRecurs(const NODE* node, unsigned int depth, unsigned int x0, unsigned int y0, unsigned int z0,
+                         unsigned int x_min, unsigned int x_max, unsigned int y_min, unsigned int y_max,
+                         OccupancyGrid2D& grid) const;
+
+    /// occupied leaf found by getOccupiedLeafsRecurs()
+    struct OccupiedLeaf {
+      const NODE* node;
+      OcTreeKey min_key;
+      unsigned int depth;
+    };
+
+    /**
+     * Collects the occupied leafs (in depth-first order) below node, with its lowest key
+     * min_key, that intersect the key range [box_min, box_max].
+     */
+    void getOccupiedLeafsRecurs(const NODE* node, unsigned int depth, const OcTreeKey& min_key,
+                                const int* box_min, const int* box_max,
+                                std::vector<OccupiedLeaf>& leafs) const;
+
+    /// collects the occupied leafs touching leaf (26-neighborhood), including itself
+    void getOccupiedNeighborLeafs(const OcTreeKey& min_key, unsigned int depth,
+                                  std::vector<OccupiedLeaf>& leafs) const;
+
+    /// union-find: root of i, with path compression
+    static unsigned int findComponentRoot(std::vector<unsigned int>& parents, unsigned int i);
+    /// union-find: merges the sets of i and j, the smaller root becomes the new root
+    static void uniteComponents(std::vector<unsigned int>& parents, unsigned int i, unsigned int j);
+
+    /// appends a component of the given leafs, computing its bounds and size
+    void addComponent(const std::vector<OccupiedLeaf>& leafs, OcTreeComponents& components) const;
+
+    /// source node and candidate occupied leafs of a deferred subtree of inflated()
+    struct InflationTaskData {
+      const NODE* source_node;
+      std::vector<OccupiedLeaf> sources;
+    };
+
+    /**
+     * Recursive call of inflated(): fills result's node covering the keys starting at min_key
+     * from source_node (node, pruned leaf above or NULL for unknown space of this tree) and
+     * the occupied leafs in sources that may be within key_radius. Returns false if the node
+     * remains unknown. Nodes at task_depth are deferred to tasks (if not NULL).
+     */
+    bool inflateRecurs(OccupancyOcTreeBase<NODE>& result, NODE* node, unsigned int depth,
+                       const OcTreeKey& min_key, const NODE* source_node,
+                       const std::vector<OccupiedLeaf>& sources, double key_radius,
+                       std::vector<SubtreeTask>* tasks, std::vector<InflationTaskData>* task_data,
+                       unsigned int task_depth, size_t& num_created, size_t& num_deleted) const;
+
+    /**
+     * Completes the nodes above block_depth after updateInflated() rebuilt the blocks:
+     * recurses into the ancestors of rebuilt blocks (dirty, per depth), deletes unknown
+     * blocks and prunes or updates the inner nodes. Returns false if node is unknown.
+     */
+    bool finishInflationRecurs(NODE* node, unsigned int depth, const OcTreeKey& min_key,
+                               unsigned int block_depth, const std::vector<KeySet>& dirty,
+                               const KeyBoolMap& block_content, size_t& num_deleted);
+
+    /// exposed rectangle in the plane at key coordinate plane of axis, see getVoxelSurfaceMesh()
+    struct VoxelFace {
+      unsigned int axis;
+      bool positive;     ///< whether the face points in positive direction of axis
+      unsigned int plane;
+      unsigned int min[2]; ///< lowest key coordinates along the next two axes (cyclic)
+      unsigned int size[2];
+    };
+
+    /// orders faces into rows along the first in-plane axis (direction 0) or the second one
+    template <unsigned int DIRECTION>
+    struct VoxelFaceRowOrder {
+      bool operator()(const VoxelFace& a, const VoxelFace& b) const;
+    };
+
+    /// adds the exposed faces of an occupied leaf
+    void addExposedFaces(const OccupiedLeaf& leaf, std::vector<VoxelFace>& faces) const;
+
+    /**
+     * Adds the parts of the face of node (neighbor of an occupied leaf, covering the keys
+     * starting at min_key) in the plane that are not hidden by occupied space.
+     * positive: the leaf lies on the negative side.
+     */
+    void addExposedFacesRecurs(const NODE* node, unsigned int depth, const OcTreeKey& min_key,
+                               unsigned int axis, bool positive, unsigned int plane,
+                               std::vector<VoxelFace>& faces) const;
+
+    /// adds the face of the cube (min_key, size) in plane
+    static void addVoxelFace(const OcTreeKey& min_key, unsigned int size, unsigned int axis, bool positive,
+                             unsigned int plane, std::vector<VoxelFace>& faces);
+
+    /// merges adjacent faces of equal extent into longer rectangles along direction (0 or 1)
+    template <unsigned int DIRECTION>
+    static void mergeVoxelFaces(std::vector<VoxelFace>& faces);
+
+    /// dense grid of insertDenseGrid(), covering the keys [min_key, max_key)
+    struct DenseGrid {
+      const unsigned char* cells;
+      unsigned int min_key[3];
+      unsigned int max_key[3];
+      size_t stride[3];
+      bool mark_free;
+    };
+
+    /// subtree of insertDenseGrid() that is deferred and then processed in parallel
+    struct DenseGridTask {
+      NODE* node;
+      unsigned int depth;
+      OcTreeKey min_key;
+      bool node_created; ///< whether node was allocated for the grid (otherwise it is known)
+      bool has_content;  ///< whether the node contains known space after processing
+    };
+
+    /**
+     * Recursive call of insertDenseGrid() for node covering the keys starting at min_key,
+     * which intersects the grid. A node_created node has no value yet; it is deleted by the
+     * caller if false is returned (no known cells). Nodes at task_depth are collected into
+     * tasks (task_idx == NULL) or their results are combined into the upper levels.
+     */
+    bool insertDenseGridRecurs(NODE* node, bool node_created, unsigned int depth, const OcTreeKey& min_key,
+                               const DenseGrid& grid, std::vector<DenseGridTask>* tasks, size_t* task_idx,
+                               unsigned int task_depth, size_t& num_created, size_t& num_deleted);
+
+    /// computes the summed and normalized getNormals() results of all points, see getLeafNormals()
+    void computeVoxelNormals(const point3d_collection& points, point3d_collection& normals,
+                             bool unknownStatus) const;
+
+    enum CropState {CROP_OUTSIDE, CROP_INSIDE, CROP_PARTIAL};
+
+    /// region of cropToBBX() (box [min, max]) or cropToSphere() (center in min, radius)
+    struct CropRegion {
+      bool sphere;
+      double min[3];
+      double max[3];
+      double radius;
+    };
+
+    /// @return whether the node of depth covering the keys starting at min_key lies inside of region
+    CropState classifyCropRegion(const CropRegion& region, const OcTreeKey& min_key, unsigned int depth) const;
+
+    /// @return the deepest depth whose nodes have at least 1/16 of extent (in meters)
+    unsigned int computeCropDepth(double extent) const;
+
+    /// implementation of cropToBBX() and cropToSphere()
+    size_t crop(const CropRegion& region, unsigned int crop_depth, OccupancyOcTreeBase<NODE>* spill);
+
+    /**
+     * Recursive call of crop() for a node crossing the region boundary. Removed nodes are
+     * counted in num_removed. @return true if no children are left (node can be deleted)
+     */
+    bool cropRecurs(NODE* node, unsigned int depth, const OcTreeKey& min_key, const CropRegion& region,
+                    unsigned int crop_depth, OccupancyOcTreeBase<NODE>* spill, size_t& num_removed);
+
+    /// inserts a detached subtree with num_nodes nodes at depth and min_key into spill
+    void spillSubtree(NODE* subtree, size_t num_nodes, unsigned int depth, const OcTreeKey& min_key,
+                      OccupancyOcTreeBase<NODE>& spill) const;
+
+    /**
+     * Merges a detached subtree into node of spill: known leafs of subtree replace the nodes
+     * of spill, known leafs of spill are expanded where subtree is more detailed. Created and
+     * deleted nodes (including the merged nodes of subtree) are counted.
+     */
+    void mergeSpilledNodeRecurs(NODE* node, NODE* subtree, OccupancyOcTreeBase<NODE>& spill,
+                                size_t& num_created, size_t& num_deleted) const;
+
+    /// crops the rolling local map (see setLocalMapRadius()) after an update from sensor_origin
+    void updateLocalMap(const point3d& sensor_origin);
+
+    /**
+     * Recomputes the value of an inner node from its remaining children after crop() removed
+     * or replaced some of them. Derived trees with additional node data (e.g. colors) override
+     * it to update that data as well.
+     */
+    virtual void updateCroppedInnerNode(NODE* node) { node->updateOccupancyChildren(); }
+
 
   protected:
     bool use_bbx_limit;  ///< use bounding box for queries (needs to be set)?
@@ -497,6 +1077,11 @@ namespace octomap {
     bool use_change_detection;
     /// Set of leaf keys (lowest level) which changed since last resetChangeDetection
     KeyBoolMap changed_keys;
+
+    double local_map_radius; ///< radius of the rolling local map, <= 0: disabled
+    OccupancyOcTreeBase<NODE>* local_map_spill;
+    point3d local_map_origin; ///< sensor origin at the last crop of the local map
+    bool local_map_cropped;
     
 
   };
@@ -33,6 +33,8 @@
 
 #include <bitset>
 #include <algorithm>
+#include <iterator>
+#include <set>
 
 #include <octomap/MCTables.h>
 
@@ -40,14 +42,16 @@ namespace octomap {
 
   template <class NODE>
   OccupancyOcTreeBase<NODE>::OccupancyOcTreeBase(double in_resolution)
-    : OcTreeBaseImpl<NODE,AbstractOccupancyOcTree>(in_resolution), use_bbx_limit(false), use_change_detection(false)
+    : OcTreeBaseImpl<NODE,AbstractOccupancyOcTree>(in_resolution), use_bbx_limit(false), use_change_detection(false),
+      local_map_radius(0.0), local_map_spill(NULL), local_map_cropped(false)
   {
 
   }
 
   template <class NODE>
   OccupancyOcTreeBase<NODE>::OccupancyOcTreeBase(double in_resolution, unsigned int in_tree_depth, unsigned int in_tree_max_val)
-    : OcTreeBaseImpl<NODE,AbstractOccupancyOcTree>(in_resolution, in_tree_depth, in_tree_max_val), use_bbx_limit(false), use_change_detection(false)
+    : OcTreeBaseImpl<NODE,AbstractOccupancyOcTree>(in_resolution, in_tree_depth, in_tree_max_val), use_bbx_limit(false), use_change_detection(false),
+      local_map_radius(0.0), local_map_spill(NULL), local_map_cropped(false)
   {
 
   }
@@ -61,7 +65,9 @@ namespace octomap {
   OcTreeBaseImpl<NODE,AbstractOccupancyOcTree>(rhs), use_bbx_limit(rhs.use_bbx_limit),
     bbx_min(rhs.bbx_min), bbx_max(rhs.bbx_max),
     bbx_min_key(rhs.bbx_min_key), bbx_max_key(rhs.bbx_max_key),
-    use_change_detection(rhs.use_change_detection), changed_keys(rhs.changed_keys)
+    use_change_detection(rhs.use_change_detection), changed_keys(rhs.changed_keys),
+    local_map_radius(rhs.local_map_radius), local_map_spill(rhs.local_map_spill),
+    local_map_origin(rhs.local_map_origin), local_map_cropped(rhs.local_map_cropped)
   {
     this->clamping_thres_min = rhs.clamping_thres_min;
     this->clamping_thres_max = rhs.clamping_thres_max;
@@ -99,6 +105,9 @@ namespace octomap {
     for (KeySet::iterator it = occupied_cells.begin(); it != occupied_cells.end(); ++it) {
       updateNode(*it, true, lazy_eval);
     }
+
+    if (local_map_radius > 0.0)
+      updateLocalMap(sensor_origin);
   }
 
   template <class NODE>
@@ -142,6 +151,97 @@ namespace octomap {
       }
 
     }
+
+    if (local_map_radius > 0.0)
+      updateLocalMap(origin);
+  }
+
+  template <class NODE>
+  template <class SENSOR_MODEL>
+  void OccupancyOcTreeBase<NODE>::insertPointCloudWithModel(const Pointcloud& scan, const point3d& sensor_origin,
+                                                            const SENSOR_MODEL& model, double maxrange, bool lazy_eval,
+                                                            AbstractOccupancyOcTree::UpdateAccumulation accumulation) {
+    KeyUpdateMap updates;
+    computeModelUpdate(scan, sensor_origin, model, maxrange, accumulation, updates);
+
+    for (typename KeyUpdateMap::const_iterator it = updates.begin(); it != updates.end(); ++it) {
+      updateNode(it->first, it->second.log_odds, lazy_eval);
+    }
+
+    if (local_map_radius > 0.0)
+      updateLocalMap(sensor_origin);
+  }
+
+  template <class NODE>
+  template <class SENSOR_MODEL>
+  void OccupancyOcTreeBase<NODE>::computeModelUpdate(const Pointcloud& scan, const point3d& origin,
+                                                     const SENSOR_MODEL& model, double maxrange,
+                                                     AbstractOccupancyOcTree::UpdateAccumulation accumulation,
+                                                     KeyUpdateMap& updates) {
+    // one map per thread, combined afterwards
+    std::vector<KeyUpdateMap> thread_updates(this->keyrays.size());
+
+#ifdef _OPENMP
+    omp_set_num_threads(this->keyrays.size());
+    #pragma omp parallel for schedule(guided)
+#endif
+    for (int i = 0; i < (int)scan.size(); ++i) {
+      const point3d& p = scan[i];
+      unsigned threadIdx = 0;
+#ifdef _OPENMP
+      threadIdx = omp_get_thread_num();
+#endif
+      KeyRay* keyray = &(this->keyrays.at(threadIdx));
+      KeyUpdateMap& local_updates = thread_updates[threadIdx];
+
+      point3d direction = p - origin;
+      const float range = (float) direction.norm();
+      if (range > 0.0f)
+        direction /= range;
+      const bool is_hit = (maxrange < 0.0) || (range <= maxrange);
+      // with a bounding box, only endpoints within it are integrated (as in computeUpdate())
+      if (use_bbx_limit && !(is_hit && inBBX(p)))
+        continue;
+
+      const point3d end = is_hit ? p : origin + direction * (float) maxrange;
+      if (this->computeRayKeys(origin, end, *keyray)) {
+        for (KeyRay::iterator it = keyray->begin(); it != keyray->end(); ++it) {
+          if (use_bbx_limit && !inBBX(*it))
+            continue;
+          const float distance = (float) (this->keyToCoord(*it) - origin).dot(direction);
+          accumulateUpdate(local_updates, *it, model((size_t) i, distance, range, false), false, accumulation);
+        }
+      }
+      OcTreeKey key;
+      if (is_hit && this->coordToKeyChecked(p, key))
+        accumulateUpdate(local_updates, key, model((size_t) i, range, range, true), true, accumulation);
+    }
+
+    updates.swap(thread_updates[0]);
+    for (size_t t = 1; t < thread_updates.size(); ++t) {
+      for (typename KeyUpdateMap::const_iterator it = thread_updates[t].begin(); it != thread_updates[t].end(); ++it)
+        accumulateUpdate(updates, it->first, it->second.log_odds, it->second.hit, accumulation);
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::accumulateUpdate(KeyUpdateMap& updates, const OcTreeKey& key, float log_odds,
+                                                   bool hit, AbstractOccupancyOcTree::UpdateAccumulation accumulation) {
+    std::pair<typename KeyUpdateMap::iterator, bool> ret = updates.insert(std::make_pair(key, KeyUpdate(log_odds, hit)));
+    if (ret.second)
+      return;
+
+    KeyUpdate& update = ret.first->second;
+    if (hit != update.hit) {
+      // endpoints take precedence over traversing rays
+      if (hit)
+        update = KeyUpdate(log_odds, true);
+      return;
+    }
+    if (accumulation == AbstractOccupancyOcTree::ACCUMULATE_SUM)
+      update.log_odds += log_odds;
+    else
+      update.log_odds = std::max(update.log_odds, log_odds);
   }
 
   template <class NODE>
@@ -547,6 +647,514 @@ namespace octomap {
     }
   }
 
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::merge(const OccupancyOcTreeBase<NODE>& other, AbstractOccupancyOcTree::MergePolicy policy) {
+    if (&other == this) {
+      OCTOMAP_ERROR("Error in merge: cannot merge a tree with itself\n");
+      return false;
+    }
+    if (this->resolution != other.resolution || this->tree_depth != other.tree_depth) {
+      OCTOMAP_ERROR_STR("Error in merge: resolution " << other.resolution << " does not match "
+                        << this->resolution);
+      return false;
+    }
+
+    const NODE* other_root = other.root;
+    if (other_root == NULL)
+      return true;
+
+    size_t num_created = 0;
+    size_t num_deleted = 0;
+    if (this->root == NULL) {
+      this->root = new NODE();
+      num_created++;
+      copyNodeRecurs(this->root, other_root, num_created);
+    }
+    else if (!this->nodeHasChildren(other_root)) {
+      mergeRecurs(this->root, other_root, policy, num_created, num_deleted);
+    }
+    else {
+      if (!this->nodeHasChildren(this->root)) {
+        for (unsigned int i = 0; i < 8; ++i)
+          this->allocNodeChild(this->root, i, num_created)->copyData(*(this->root));
+      }
+
+      // octants are disjoint subtrees, the root's children array exists at this point
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(dynamic) reduction(+:num_created, num_deleted)
+#endif
+      for (int i = 0; i < 8; ++i) {
+        if (!this->nodeChildExists(other_root, i))
+          continue;
+
+        const NODE* other_child = this->getNodeChild(other_root, i);
+        if (this->nodeChildExists(this->root, i))
+          mergeRecurs(this->getNodeChild(this->root, i), other_child, policy, num_created, num_deleted);
+        else
+          copyNodeRecurs(this->allocNodeChild(this->root, i, num_created), other_child, num_created);
+      }
+      this->root->updateOccupancyChildren();
+    }
+
+    this->tree_size = this->tree_size + num_created - num_deleted;
+    this->size_changed = true;
+    return true;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::mergeRecurs(NODE* node, const NODE* other_node, AbstractOccupancyOcTree::MergePolicy policy,
+                                              size_t& num_created, size_t& num_deleted) {
+    if (!this->nodeHasChildren(other_node)) {
+      if (!this->nodeHasChildren(node)) {
+        mergeNodeValue(node, other_node, policy);
+        return;
+      }
+      if (policy == AbstractOccupancyOcTree::MERGE_OVERWRITE) {
+        this->deleteNodeDescendants(node, num_deleted);
+        node->copyData(*other_node);
+        return;
+      }
+      // apply the (pruned) leaf to all descendants, unknown parts take its value
+      for (unsigned int i = 0; i < 8; ++i) {
+        if (this->nodeChildExists(node, i))
+          mergeRecurs(this->getNodeChild(node, i), other_node, policy, num_created, num_deleted);
+        else
+          this->allocNodeChild(node, i, num_created)->copyData(*other_node);
+      }
+    }
+    else {
+      if (!this->nodeHasChildren(node)) {
+        // expand pruned node only where the other tree has more detail
+        for (unsigned int i = 0; i < 8; ++i)
+          this->allocNodeChild(node, i, num_created)->copyData(*node);
+      }
+      for (unsigned int i = 0; i < 8; ++i) {
+        if (!this->nodeChildExists(other_node, i))
+          continue;
+
+        const NODE* other_child = this->getNodeChild(other_node, i);
+        if (this->nodeChildExists(node, i))
+          mergeRecurs(this->getNodeChild(node, i), other_child, policy, num_created, num_deleted);
+        else
+          copyNodeRecurs(this->allocNodeChild(node, i, num_created), other_child, num_created);
+      }
+    }
+    node->updateOccupancyChildren();
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::copyNodeRecurs(NODE* node, const NODE* other_node, size_t& num_created) {
+    node->copyData(*other_node);
+    if (!this->nodeHasChildren(other_node))
+      return;
+
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (this->nodeChildExists(other_node, i))
+        copyNodeRecurs(this->allocNodeChild(node, i, num_created), this->getNodeChild(other_node, i), num_created);
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::mergeNodeValue(NODE* node, const NODE* other_node, AbstractOccupancyOcTree::MergePolicy policy) const {
+    switch (policy) {
+    case AbstractOccupancyOcTree::MERGE_ADD:
+      updateNodeLogOdds(node, other_node->getLogOdds());
+      break;
+    case AbstractOccupancyOcTree::MERGE_MAX: {
+      float value = std::max(node->getLogOdds(), other_node->getLogOdds());
+      value = std::min(std::max(value, this->clamping_thres_min), this->clamping_thres_max);
+      node->setLogOdds(value);
+      break;
+    }
+    case AbstractOccupancyOcTree::MERGE_OVERWRITE:
+      node->copyData(*other_node);
+      break;
+    }
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::transformed(const pose6d& transform, OccupancyOcTreeBase<NODE>& result) const {
+    if (&result == this) {
+      OCTOMAP_ERROR("Error in transformed: result must be a different tree\n");
+      return false;
+    }
+    result.clear();
+    if (this->root == NULL)
+      return true;
+
+    // translation by whole voxels without rotation: exact key offset
+    int key_offset[3];
+    bool use_key_offset = (result.resolution == this->resolution)
+        && fabs(fabs(transform.rot().u()) - 1.0) < 1e-6;
+    for (unsigned int i = 0; i < 3 && use_key_offset; ++i) {
+      double offset = transform.trans()(i) / this->resolution;
+      key_offset[i] = (int) floor(offset + 0.5);
+      use_key_offset = fabs(offset - key_offset[i]) < 1e-4;
+    }
+    const pose6d inverse = transform.inv();
+
+    // build the upper levels, deferring the subtrees below task_depth
+    const unsigned int task_depth = (result.tree_depth > 6) ? result.tree_depth - 6 : 0;
+    std::vector<SubtreeTask> tasks;
+    size_t num_created = 1;
+    size_t num_deleted = 0;
+    result.root = new NODE();
+    OcTreeKey root_key(0, 0, 0);
+    if (!transformRecurs(result, result.root, 0, root_key, inverse, use_key_offset ? key_offset : NULL,
+                         &tasks, task_depth, num_created, num_deleted)) {
+      result.clear();
+      return true;
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(+:num_created, num_deleted)
+#endif
+    for (int i = 0; i < (int) tasks.size(); ++i) {
+      SubtreeTask& task = tasks[i];
+      task.has_content = transformRecurs(result, task.node, task.depth, task.min_key, inverse,
+                                         use_key_offset ? key_offset : NULL, NULL, task_depth,
+                                         num_created, num_deleted);
+    }
+
+    size_t task_idx = 0;
+    bool has_content = result.finishSubtreeTasksRecurs(result.root, 0, task_depth, tasks, task_idx, num_deleted);
+    result.tree_size = num_created - num_deleted;
+    result.size_changed = true;
+    if (!has_content)
+      result.clear();
+
+    return true;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::transformRecurs(OccupancyOcTreeBase<NODE>& result, NODE* node, unsigned int depth,
+                                                  const OcTreeKey& min_key, const pose6d& inverse, const int* key_offset,
+                                                  std::vector<SubtreeTask>* tasks, unsigned int task_depth,
+                                                  size_t& num_created, size_t& num_deleted) const {
+    if (tasks && depth == task_depth) {
+      SubtreeTask task;
+      task.node = node;
+      task.depth = depth;
+      task.min_key = min_key;
+      task.has_content = false;
+      tasks->push_back(task);
+      return true;
+    }
+
+    const unsigned int size = 1u << (result.tree_depth - depth);
+    const int max_key_val = 2 * (int) this->tree_max_val - 1;
+    // inclusive key range of this tree covering the node, clipped to the tree bounds
+    // (space outside of the bounds is unknown)
+    int first[3], last[3];
+    bool in_bounds = true;
+
+    if (key_offset) {
+      // exact: shifted key range
+      for (unsigned int i = 0; i < 3; ++i) {
+        first[i] = (int) min_key[i] - key_offset[i];
+        last[i] = first[i] + (int) size - 1;
+      }
+    }
+    else {
+      const double node_size = size * result.resolution;
+      point3d lower_corner;
+      for (unsigned int i = 0; i < 3; ++i)
+        lower_corner(i) = (float) ((double((int) min_key[i] - (int) result.tree_max_val)) * result.resolution);
+
+      if (depth == result.tree_depth) {
+        // finest resolution: value at the center
+        point3d center = lower_corner + point3d(0.5f, 0.5f, 0.5f) * (float) node_size;
+        OcTreeKey source_key;
+        if (!this->coordToKeyChecked(inverse.transform(center), source_key))
+          return false;
+        const NODE* source_node = this->search(source_key);
+        if (source_node == NULL)
+          return false;
+        node->copyData(*source_node);
+        return true;
+      }
+
+      // bounding box of the transformed node (with a small margin for numerical robustness)
+      double lower[3], upper[3];
+      for (unsigned int c = 0; c < 8; ++c) {
+        point3d corner = lower_corner + point3d((c & 1) ? 1.0f : 0.0f, (c & 2) ? 1.0f : 0.0f,
+                                                (c & 4) ? 1.0f : 0.0f) * (float) node_size;
+        point3d p = inverse.transform(corner);
+        for (unsigned int i = 0; i < 3; ++i) {
+          if (c == 0 || p(i) < lower[i]) lower[i] = p(i);
+          if (c == 0 || p(i) > upper[i]) upper[i] = p(i);
+        }
+      }
+      const double margin = 1e-3;
+      for (unsigned int i = 0; i < 3; ++i) {
+        first[i] = (int) floor(lower[i] * this->resolution_factor + margin) + (int) this->tree_max_val;
+        last[i] = (int) floor(upper[i] * this->resolution_factor - margin) + (int) this->tree_max_val;
+      }
+    }
+
+    for (unsigned int i = 0; i < 3; ++i) {
+      if (first[i] < 0 || last[i] > max_key_val) {
+        in_bounds = false;
+        first[i] = std::max(first[i], 0);
+        last[i] = std::min(last[i], max_key_val);
+      }
+      if (first[i] > last[i])
+        return false;
+    }
+
+    // uniform if the range lies within a single leaf or unknown cube
+    unsigned int source_depth;
+    const NODE* source_node = this->searchWithDepth(OcTreeKey((key_type) first[0], (key_type) first[1],
+                                                              (key_type) first[2]), source_depth);
+    bool contained = true;
+    const unsigned int shift = this->tree_depth - source_depth;
+    for (unsigned int i = 0; i < 3 && contained; ++i)
+      contained = ((first[i] >> shift) == (last[i] >> shift));
+
+    if (contained && source_node == NULL)
+      return false;
+    if (contained && in_bounds) {
+      node->copyData(*source_node);
+      return true;
+    }
+    // unknown space spanning several unknown cubes
+    if (!intersectsKnownRecurs(this->root, 0, 0, 0, 0, first, last))
+      return false;
+
+    if (depth == result.tree_depth)
+      return false;
+
+    // subdivide
+    const unsigned int half = size / 2;
+    bool has_content = false;
+    for (unsigned int i = 0; i < 8; ++i) {
+      OcTreeKey child_key (min_key[0] + ((i & 1) ? half : 0),
+                           min_key[1] + ((i & 2) ? half : 0),
+                           min_key[2] + ((i & 4) ? half : 0));
+      NODE* child = result.allocNodeChild(node, i, num_created);
+      if (transformRecurs(result, child, depth + 1, child_key, inverse, key_offset,
+                          tasks, task_depth, num_created, num_deleted))
+        has_content = true;
+      else
+        result.freeNodeChild(node, i, num_deleted);
+    }
+
+    if (!has_content)
+      result.deleteNodeDescendants(node, num_deleted);
+    else if (tasks == NULL)
+      result.pruneOrUpdateNode(node, num_deleted);
+    // otherwise, the node is completed in finishSubtreeTasksRecurs()
+
+    return has_content;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::intersectsKnownRecurs(const NODE* node, unsigned int depth,
+                                                        unsigned int x0, unsigned int y0, unsigned int z0,
+                                                        const int* first, const int* last) const {
+    const int size = 1 << (this->tree_depth - depth);
+    if ((int) x0 > last[0] || (int) x0 + size - 1 < first[0]
+        || (int) y0 > last[1] || (int) y0 + size - 1 < first[1]
+        || (int) z0 > last[2] || (int) z0 + size - 1 < first[2])
+      return false;
+
+    if (!this->nodeHasChildren(node))
+      return true;
+
+    const unsigned int half = size / 2;
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (this->nodeChildExists(node, i)
+          && intersectsKnownRecurs(this->getNodeChild(node, i), depth + 1, x0 + ((i & 1) ? half : 0),
+                                   y0 + ((i & 2) ? half : 0), z0 + ((i & 4) ? half : 0), first, last))
+        return true;
+    }
+    return false;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::finishSubtreeTasksRecurs(NODE* node, unsigned int depth, unsigned int task_depth,
+                                                           const std::vector<SubtreeTask>& tasks, size_t& task_idx,
+                                                           size_t& num_deleted) {
+    if (depth == task_depth) {
+      assert(task_idx < tasks.size() && tasks[task_idx].node == node);
+      return tasks[task_idx++].has_content;
+    }
+    if (!this->nodeHasChildren(node))
+      return true; // uniform leaf above the task depth
+
+    bool has_content = false;
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+      if (finishSubtreeTasksRecurs(this->getNodeChild(node, i), depth + 1, task_depth, tasks, task_idx, num_deleted))
+        has_content = true;
+      else
+        this->freeNodeChild(node, i, num_deleted);
+    }
+
+    if (has_content)
+      pruneOrUpdateNode(node, num_deleted);
+    else
+      this->deleteNodeDescendants(node, num_deleted);
+
+    return has_content;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::pruneOrUpdateNode(NODE* node, size_t& num_deleted) {
+    bool collapsible = this->nodeChildExists(node, 0) && !this->nodeHasChildren(this->getNodeChild(node, 0));
+    for (unsigned int i = 1; i < 8 && collapsible; ++i) {
+      collapsible = this->nodeChildExists(node, i) && !this->nodeHasChildren(this->getNodeChild(node, i))
+          && *(this->getNodeChild(node, i)) == *(this->getNodeChild(node, 0));
+    }
+
+    if (collapsible) {
+      node->copyData(*(this->getNodeChild(node, 0)));
+      this->deleteNodeDescendants(node, num_deleted);
+    } else {
+      node->updateOccupancyChildren();
+    }
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::diff(const OccupancyOcTreeBase<NODE>& other, OcTreeDiff& result) const {
+    result.clear();
+    if (this->resolution != other.resolution || this->tree_depth != other.tree_depth) {
+      OCTOMAP_ERROR_STR("Error in diff: resolution " << other.resolution << " does not match "
+                        << this->resolution);
+      return false;
+    }
+    if (this->root == NULL && other.root == NULL)
+      return true;
+
+    // collect the subtrees at task_depth, compare them in parallel and combine the results
+    const unsigned int task_depth = (this->tree_depth > 6) ? this->tree_depth - 6 : 0;
+    std::vector<DiffTask> tasks;
+    OcTreeKey root_key(0, 0, 0);
+    diffRecurs(other, this->root, other.root, 0, root_key, result, &tasks, NULL, task_depth);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < (int) tasks.size(); ++i) {
+      DiffTask& task = tasks[i];
+      task.changed = diffRecurs(other, task.node, task.other_node, task.depth, task.min_key,
+                                task.result, NULL, NULL, task_depth);
+    }
+
+    size_t task_idx = 0;
+    diffRecurs(other, this->root, other.root, 0, root_key, result, &tasks, &task_idx, task_depth);
+    return true;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::diffRecurs(const OccupancyOcTreeBase<NODE>& other, const NODE* node,
+                                             const NODE* other_node, unsigned int depth, const OcTreeKey& min_key,
+                                             OcTreeDiff& result, std::vector<DiffTask>* tasks, size_t* task_idx,
+                                             unsigned int task_depth) const {
+    if (node == NULL && other_node == NULL)
+      return false;
+
+    if (tasks && depth == task_depth) {
+      if (task_idx == NULL) {
+        DiffTask task;
+        task.node = node;
+        task.other_node = other_node;
+        task.depth = depth;
+        task.min_key = min_key;
+        task.changed = false;
+        tasks->push_back(task);
+        return false;
+      }
+      const DiffTask& task = (*tasks)[(*task_idx)++];
+      result.add(task.result);
+      return task.changed;
+    }
+
+    const bool node_leaf = (node == NULL || !this->nodeHasChildren(node));
+    const bool other_leaf = (other_node == NULL || !this->nodeHasChildren(other_node));
+    const unsigned int size = 1u << (this->tree_depth - depth);
+
+    if (node_leaf && other_leaf) {
+      if (tasks && task_idx == NULL)
+        return false; // collecting tasks only
+
+      OcTreeDiff::State state = OcTreeDiff::UNKNOWN;
+      if (node)
+        state = this->isNodeOccupied(node) ? OcTreeDiff::OCCUPIED : OcTreeDiff::FREE;
+      OcTreeDiff::State other_state = OcTreeDiff::UNKNOWN;
+      if (other_node)
+        other_state = other.isNodeOccupied(other_node) ? OcTreeDiff::OCCUPIED : OcTreeDiff::FREE;
+
+      const double volume = pow(this->getNodeSize(depth), 3);
+      result.volume[state][other_state] += volume;
+
+      if (node && other_node && node->getLogOdds() != other_node->getLogOdds()) {
+        if (state == other_state)
+          result.value_changed_volume += volume;
+
+        double p1 = node->getOccupancy();
+        double p2 = other_node->getOccupancy();
+        double kld;
+        if (p1 < 0.0001)
+          kld = log((1-p1)/(1-p2))*(1-p1);
+        else if (p1 > 0.9999)
+          kld = log(p1/p2)*p1;
+        else
+          kld = log(p1/p2)*p1 + log((1-p1)/(1-p2))*(1-p1);
+        result.kld += kld * pow(8.0, (double) (this->tree_depth - depth)); // number of voxels
+      }
+
+      if (state == other_state)
+        return false;
+
+      OcTreeDiff::Region region;
+      for (unsigned int i = 0; i < 3; ++i)
+        region.key[i] = min_key[i] + (size >> 1);
+      region.depth = depth;
+      region.state_a = state;
+      region.state_b = other_state;
+      result.regions.push_back(region);
+      return true;
+    }
+
+    // recurse, a leaf is compared to all children of the other node
+    const unsigned int half = size / 2;
+    unsigned int num_changed = 0;
+    for (unsigned int i = 0; i < 8; ++i) {
+      const NODE* child = node;
+      if (!node_leaf)
+        child = this->nodeChildExists(node, i) ? this->getNodeChild(node, i) : NULL;
+      const NODE* other_child = other_node;
+      if (!other_leaf)
+        other_child = this->nodeChildExists(other_node, i) ? this->getNodeChild(other_node, i) : NULL;
+
+      OcTreeKey child_key (min_key[0] + ((i & 1) ? half : 0),
+                           min_key[1] + ((i & 2) ? half : 0),
+                           min_key[2] + ((i & 4) ? half : 0));
+      if (diffRecurs(other, child, other_child, depth + 1, child_key, result, tasks, task_idx, task_depth))
+        num_changed++;
+    }
+
+    if (num_changed < 8)
+      return false;
+
+    // coalesce the children's regions if they have the same transition
+    std::vector<OcTreeDiff::Region>& regions = result.regions;
+    const OcTreeDiff::Region& first = regions[regions.size() - 8];
+    for (size_t i = regions.size() - 7; i < regions.size(); ++i) {
+      if (regions[i].state_a != first.state_a || regions[i].state_b != first.state_b)
+        return false;
+    }
+    OcTreeDiff::Region region = first;
+    for (unsigned int i = 0; i < 3; ++i)
+      region.key[i] = min_key[i] + (size >> 1);
+    region.depth = depth;
+    regions.resize(regions.size() - 8);
+    regions.push_back(region);
+    return true;
+  }
+
   template <class NODE>
   bool OccupancyOcTreeBase<NODE>::getNormals(const point3d& point, std::vector<point3d>& normals,
                                              bool unknownStatus) const {
@@ -567,7 +1175,7 @@ namespace octomap {
 
     // There is 8 neighbouring sets
     // The current cube can be at any of the 8 vertex
-    int x_index[4][4] = {{1, 1, 0, 0}, {1, 1, 0, 0}, {0, 0 -1, -1}, {0, 0 -1, -1}};
+    int x_index[4][4] = {{1, 1, 0, 0}, {1, 1, 0, 0}, {0, 0, -1, -1}, {0, 0, -1, -1}};
     int y_index[4][4] = {{1, 0, 0, 1}, {0, -1, -1, 0}, {0, -1, -1, 0}, {1, 0, 0, 1}};
     int z_index[2][2] = {{0, 1}, {-1, 0}};
 
@@ -611,7 +1219,7 @@ namespace octomap {
 
         // All vertices are occupied or free resulting in no normal
         if (edgeTable[cube_index] == 0)
-          return true;
+          continue;
 
         // No interpolation is done yet, we use vertexList in <MCTables.h>.
         for(int i = 0; triTable[cube_index][i] != -1; i += 3){
@@ -635,6 +1243,1787 @@ namespace octomap {
     return true;
   }
 
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getConnectedComponents(OcTreeComponents& components) const {
+    components.clear(this->tree_depth);
+    if (this->root == NULL)
+      return;
+
+    std::vector<OccupiedLeaf> leafs;
+    const int box_min[3] = {0, 0, 0};
+    const int box_max[3] = {65535, 65535, 65535};
+    getOccupiedLeafsRecurs(this->root, 0, OcTreeKey(0, 0, 0), box_min, box_max, leafs);
+    if (leafs.empty())
+      return;
+
+    unordered_ns::unordered_map<const NODE*, unsigned int> leaf_index;
+    for (size_t i = 0; i < leafs.size(); ++i)
+      leaf_index[leafs[i].node] = (unsigned int) i;
+
+    // the leafs are in depth-first order, so the leafs of each subtree at
+    // task_depth form a consecutive range (coarser leafs are a range each)
+    const unsigned int task_depth = 3;
+    const unsigned int task_shift = this->tree_depth - task_depth;
+    std::vector<unsigned int> range_begin;
+    for (size_t i = 0; i < leafs.size(); ++i) {
+      bool new_range = (i == 0) || (leafs[i].depth < task_depth) || (leafs[i-1].depth < task_depth);
+      for (unsigned int k = 0; k < 3 && !new_range; ++k)
+        new_range = ((leafs[i].min_key[k] >> task_shift) != (leafs[i-1].min_key[k] >> task_shift));
+      if (new_range)
+        range_begin.push_back((unsigned int) i);
+    }
+    range_begin.push_back((unsigned int) leafs.size());
+
+    std::vector<unsigned int> parents(leafs.size());
+    for (size_t i = 0; i < parents.size(); ++i)
+      parents[i] = (unsigned int) i;
+
+    // unite neighbors within each range in parallel, collect the pairs across ranges
+    std::vector<std::pair<unsigned int, unsigned int> > border_pairs;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int r = 0; r < (int) range_begin.size() - 1; ++r) {
+      std::vector<std::pair<unsigned int, unsigned int> > range_border_pairs;
+      std::vector<OccupiedLeaf> neighbors;
+      for (unsigned int i = range_begin[r]; i < range_begin[r+1]; ++i) {
+        neighbors.clear();
+        getOccupiedNeighborLeafs(leafs[i].min_key, leafs[i].depth, neighbors);
+        for (size_t n = 0; n < neighbors.size(); ++n) {
+          unsigned int j = leaf_index.find(neighbors[n].node)->second;
+          if (j <= i) // each pair only once
+            continue;
+          if (j < range_begin[r+1])
+            uniteComponents(parents, i, j);
+          else
+            range_border_pairs.push_back(std::make_pair(i, j));
+        }
+      }
+#ifdef _OPENMP
+      #pragma omp critical
+#endif
+      border_pairs.insert(border_pairs.end(), range_border_pairs.begin(), range_border_pairs.end());
+    }
+
+    for (size_t p = 0; p < border_pairs.size(); ++p)
+      uniteComponents(parents, border_pairs[p].first, border_pairs[p].second);
+
+    // group the leafs by their roots, components ordered by their first leaf
+    std::vector<int> root_component(leafs.size(), -1);
+    std::vector<std::vector<OccupiedLeaf> > component_leafs;
+    for (unsigned int i = 0; i < leafs.size(); ++i) {
+      unsigned int root = findComponentRoot(parents, i);
+      if (root_component[root] < 0) {
+        root_component[root] = (int) component_leafs.size();
+        component_leafs.push_back(std::vector<OccupiedLeaf>());
+      }
+      component_leafs[root_component[root]].push_back(leafs[i]);
+    }
+    for (size_t c = 0; c < component_leafs.size(); ++c)
+      addComponent(component_leafs[c], components);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::updateConnectedComponents(OcTreeComponents& components) const {
+    if (components.getTreeDepth() != this->tree_depth) {
+      getConnectedComponents(components);
+      return;
+    }
+
+    // components touching changed voxels are recomputed
+    std::set<unsigned int> dead;
+    std::vector<OccupiedLeaf> seeds;
+    for (KeyBoolMap::const_iterator it = changed_keys.begin(); it != changed_keys.end(); ++it) {
+      const OcTreeKey& key = it->first;
+      int box_min[3], box_max[3];
+      for (unsigned int i = 0; i < 3; ++i) {
+        box_min[i] = std::max((int) key[i] - 1, 0);
+        box_max[i] = std::min((int) key[i] + 1, 65535);
+      }
+      for (int z = box_min[2]; z <= box_max[2]; ++z) {
+        for (int y = box_min[1]; y <= box_max[1]; ++y) {
+          for (int x = box_min[0]; x <= box_max[0]; ++x) {
+            int c = components.findComponent(OcTreeKey((key_type) x, (key_type) y, (key_type) z));
+            if (c >= 0)
+              dead.insert((unsigned int) c);
+          }
+        }
+      }
+      if (this->root)
+        getOccupiedLeafsRecurs(this->root, 0, OcTreeKey(0, 0, 0), box_min, box_max, seeds);
+    }
+    if (dead.empty() && seeds.empty())
+      return;
+
+    // the current occupied leafs within the old leafs of these components
+    for (std::set<unsigned int>::const_iterator it = dead.begin(); it != dead.end(); ++it) {
+      const std::vector<OcTreeComponents::Leaf>& old_leafs = components.components[*it].leafs;
+      for (size_t i = 0; i < old_leafs.size() && this->root; ++i) {
+        int size = 1 << (this->tree_depth - old_leafs[i].depth);
+        OcTreeKey min_key = computeIndexKey(this->tree_depth - old_leafs[i].depth, old_leafs[i].key);
+        int box_min[3], box_max[3];
+        for (unsigned int k = 0; k < 3; ++k) {
+          box_min[k] = min_key[k];
+          box_max[k] = min_key[k] + size - 1;
+        }
+        getOccupiedLeafsRecurs(this->root, 0, OcTreeKey(0, 0, 0), box_min, box_max, seeds);
+      }
+    }
+
+    // flood fill from all seeds
+    std::vector<std::vector<OccupiedLeaf> > new_components;
+    unordered_ns::unordered_set<const NODE*> visited;
+    std::vector<OccupiedLeaf> neighbors;
+    for (size_t s = 0; s < seeds.size(); ++s) {
+      if (!visited.insert(seeds[s].node).second)
+        continue;
+      new_components.push_back(std::vector<OccupiedLeaf>(1, seeds[s]));
+      std::vector<OccupiedLeaf>& component_leafs = new_components.back();
+      for (size_t i = 0; i < component_leafs.size(); ++i) {
+        // connected to an unchanged component (e.g. after pruning): recompute it as well
+        int c = components.findComponent(component_leafs[i].min_key);
+        if (c >= 0)
+          dead.insert((unsigned int) c);
+
+        neighbors.clear();
+        getOccupiedNeighborLeafs(component_leafs[i].min_key, component_leafs[i].depth, neighbors);
+        for (size_t n = 0; n < neighbors.size(); ++n) {
+          if (visited.insert(neighbors[n].node).second)
+            component_leafs.push_back(neighbors[n]);
+        }
+      }
+    }
+
+    // remove the old components (the last component fills each gap), add the new ones
+    for (std::set<unsigned int>::const_iterator it = dead.begin(); it != dead.end(); ++it)
+      components.removeLookup(*it);
+    for (std::set<unsigned int>::reverse_iterator it = dead.rbegin(); it != dead.rend(); ++it) {
+      unsigned int last = (unsigned int) components.components.size() - 1;
+      if (*it != last) {
+        components.components[*it] = components.components[last];
+        components.addLookup(*it);
+      }
+      components.components.pop_back();
+    }
+    for (size_t c = 0; c < new_components.size(); ++c)
+      addComponent(new_components[c], components);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getOccupiedLeafsRecurs(const NODE* node, unsigned int depth,
+                                                         const OcTreeKey& min_key,
+                                                         const int* box_min, const int* box_max,
+                                                         std::vector<OccupiedLeaf>& leafs) const {
+    int size = 1 << (this->tree_depth - depth);
+    for (unsigned int i = 0; i < 3; ++i) {
+      if ((int) min_key[i] > box_max[i] || (int) min_key[i] + size - 1 < box_min[i])
+        return;
+    }
+    // inner nodes hold the maximum occupancy of their children
+    if (!this->isNodeOccupied(node))
+      return;
+
+    if (!this->nodeHasChildren(node)) {
+      OccupiedLeaf leaf;
+      leaf.node = node;
+      leaf.min_key = min_key;
+      leaf.depth = depth;
+      leafs.push_back(leaf);
+      return;
+    }
+
+    key_type half = (key_type) (size >> 1);
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+      OcTreeKey child_min(min_key[0] + ((i & 1) ? half : 0),
+                          min_key[1] + ((i & 2) ? half : 0),
+                          min_key[2] + ((i & 4) ? half : 0));
+      getOccupiedLeafsRecurs(this->getNodeChild(node, i), depth + 1, child_min, box_min, box_max, leafs);
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getOccupiedNeighborLeafs(const OcTreeKey& min_key, unsigned int depth,
+                                                           std::vector<OccupiedLeaf>& leafs) const {
+    int size = 1 << (this->tree_depth - depth);
+    int box_min[3], box_max[3];
+    for (unsigned int i = 0; i < 3; ++i) {
+      box_min[i] = std::max((int) min_key[i] - 1, 0);
+      box_max[i] = std::min((int) min_key[i] + size, 65535);
+    }
+    getOccupiedLeafsRecurs(this->root, 0, OcTreeKey(0, 0, 0), box_min, box_max, leafs);
+  }
+
+  template <class NODE>
+  unsigned int OccupancyOcTreeBase<NODE>::findComponentRoot(std::vector<unsigned int>& parents, unsigned int i) {
+    while (parents[i] != i) {
+      parents[i] = parents[parents[i]]; // path halving
+      i = parents[i];
+    }
+    return i;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::uniteComponents(std::vector<unsigned int>& parents, unsigned int i, unsigned int j) {
+    unsigned int root_i = findComponentRoot(parents, i);
+    unsigned int root_j = findComponentRoot(parents, j);
+    if (root_i < root_j)
+      parents[root_j] = root_i;
+    else if (root_j < root_i)
+      parents[root_i] = root_j;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::addComponent(const std::vector<OccupiedLeaf>& leafs,
+                                               OcTreeComponents& components) const {
+    OcTreeComponents::Component component;
+    component.leafs.resize(leafs.size());
+    int min_key[3] = {65535, 65535, 65535};
+    int max_key[3] = {0, 0, 0};
+    for (size_t i = 0; i < leafs.size(); ++i) {
+      int size = 1 << (this->tree_depth - leafs[i].depth);
+      for (unsigned int k = 0; k < 3; ++k) {
+        min_key[k] = std::min(min_key[k], (int) leafs[i].min_key[k]);
+        max_key[k] = std::max(max_key[k], (int) leafs[i].min_key[k] + size - 1);
+        component.leafs[i].key[k] = (key_type) (leafs[i].min_key[k] + (size >> 1));
+      }
+      component.leafs[i].depth = leafs[i].depth;
+      double node_size = this->getNodeSize(leafs[i].depth);
+      component.volume += node_size * node_size * node_size;
+      component.num_voxels += (unsigned long long) size * size * size;
+    }
+    for (unsigned int k = 0; k < 3; ++k) {
+      component.min_key[k] = (key_type) min_key[k];
+      component.max_key[k] = (key_type) max_key[k];
+    }
+    double half_res = 0.5 * this->resolution;
+    component.bbx_min = this->keyToCoord(component.min_key) - point3d((float) half_res, (float) half_res, (float) half_res);
+    component.bbx_max = this->keyToCoord(component.max_key) + point3d((float) half_res, (float) half_res, (float) half_res);
+    components.components.push_back(component);
+    components.addLookup((unsigned int) components.components.size() - 1);
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::inflated(double radius, OccupancyOcTreeBase<NODE>& result) const {
+    if (&result == this) {
+      OCTOMAP_ERROR("Error in inflated: result must be a different tree\n");
+      return false;
+    }
+    if (result.resolution != this->resolution || result.tree_depth != this->tree_depth) {
+      OCTOMAP_ERROR("Error in inflated: trees must have the same resolution\n");
+      return false;
+    }
+    result.clear();
+    if (this->root == NULL)
+      return true;
+
+    // all occupied leafs are candidates at the root
+    std::vector<OccupiedLeaf> sources;
+    const int box_min[3] = {0, 0, 0};
+    const int box_max[3] = {65535, 65535, 65535};
+    getOccupiedLeafsRecurs(this->root, 0, OcTreeKey(0, 0, 0), box_min, box_max, sources);
+    const double key_radius = std::max(radius, 0.0) / this->resolution;
+
+    // build the upper levels, deferring the subtrees below task_depth
+    const unsigned int task_depth = (this->tree_depth > 6) ? this->tree_depth - 6 : 0;
+    std::vector<SubtreeTask> tasks;
+    std::vector<InflationTaskData> task_data;
+    size_t num_created = 1;
+    size_t num_deleted = 0;
+    result.root = new NODE();
+    if (!inflateRecurs(result, result.root, 0, OcTreeKey(0, 0, 0), this->root, sources, key_radius,
+                       &tasks, &task_data, task_depth, num_created, num_deleted)) {
+      result.clear();
+      return true;
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(+:num_created, num_deleted)
+#endif
+    for (int i = 0; i < (int) tasks.size(); ++i) {
+      SubtreeTask& task = tasks[i];
+      task.has_content = inflateRecurs(result, task.node, task.depth, task.min_key, task_data[i].source_node,
+                                       task_data[i].sources, key_radius, NULL, NULL, task_depth,
+                                       num_created, num_deleted);
+      std::vector<OccupiedLeaf>().swap(task_data[i].sources);
+    }
+
+    size_t task_idx = 0;
+    bool has_content = result.finishSubtreeTasksRecurs(result.root, 0, task_depth, tasks, task_idx, num_deleted);
+    result.tree_size = num_created - num_deleted;
+    result.size_changed = true;
+    if (!has_content)
+      result.clear();
+
+    return true;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::updateInflated(double radius, OccupancyOcTreeBase<NODE>& result) const {
+    if (&result == this) {
+      OCTOMAP_ERROR("Error in updateInflated: result must be a different tree\n");
+      return false;
+    }
+    if (result.resolution != this->resolution || result.tree_depth != this->tree_depth) {
+      OCTOMAP_ERROR("Error in updateInflated: trees must have the same resolution\n");
+      return false;
+    }
+    if (!use_change_detection) {
+      OCTOMAP_WARNING("updateInflated: change detection is not enabled, inflating the whole tree\n");
+      return inflated(radius, result);
+    }
+    if (changed_keys.empty())
+      return true;
+    if (this->root == NULL) {
+      result.clear();
+      return true;
+    }
+
+    // blocks of the result within the radius of changed keys
+    const double key_radius = std::max(radius, 0.0) / this->resolution;
+    const int reach = (int) floor(key_radius);
+    const unsigned int block_depth = (this->tree_depth > 4) ? this->tree_depth - 4 : 0;
+    const unsigned int block_shift = this->tree_depth - block_depth;
+    const int max_key_val = 2 * (int) this->tree_max_val - 1;
+    KeySet block_keys;
+    for (KeyBoolMap::const_iterator it = changed_keys.begin(); it != changed_keys.end(); ++it) {
+      int first[3], last[3];
+      for (unsigned int i = 0; i < 3; ++i) {
+        first[i] = std::max((int) it->first[i] - reach, 0) >> block_shift;
+        last[i] = std::min((int) it->first[i] + reach, max_key_val) >> block_shift;
+      }
+      for (int x = first[0]; x <= last[0]; ++x)
+        for (int y = first[1]; y <= last[1]; ++y)
+          for (int z = first[2]; z <= last[2]; ++z)
+            block_keys.insert(OcTreeKey((key_type) (x << block_shift), (key_type) (y << block_shift),
+                                        (key_type) (z << block_shift)));
+    }
+
+    // create the paths to the blocks in result, expanding pruned leafs
+    size_t num_created = 0;
+    size_t num_deleted = 0;
+    bool root_created = false;
+    if (result.root == NULL) {
+      result.root = new NODE();
+      num_created++;
+      root_created = true;
+    }
+    std::vector<SubtreeTask> tasks;
+    std::vector<InflationTaskData> task_data;
+    std::vector<KeySet> dirty(block_depth + 1);
+    const int block_size = 1 << block_shift;
+    for (KeySet::const_iterator it = block_keys.begin(); it != block_keys.end(); ++it) {
+      NODE* node = result.root;
+      bool created = root_created;
+      for (unsigned int d = 0; d < block_depth; ++d) {
+        dirty[d].insert(computeIndexKey(this->tree_depth - d, *it));
+        if (!created && !result.nodeHasChildren(node)) {
+          for (unsigned int i = 0; i < 8; ++i)
+            result.allocNodeChild(node, i, num_created)->copyData(*node);
+        }
+        unsigned int pos = computeChildIdx(*it, this->tree_depth - 1 - d);
+        if (!result.nodeChildExists(node, pos)) {
+          result.allocNodeChild(node, pos, num_created);
+          created = true;
+        }
+        node = result.getNodeChild(node, pos);
+      }
+      dirty[block_depth].insert(*it);
+      result.deleteNodeDescendants(node, num_deleted);
+
+      SubtreeTask task;
+      task.node = node;
+      task.depth = block_depth;
+      task.min_key = *it;
+      task.has_content = false;
+      tasks.push_back(task);
+
+      InflationTaskData data;
+      unsigned int source_depth;
+      data.source_node = this->searchWithDepth(*it, source_depth, block_depth);
+      task_data.push_back(data);
+      int box_min[3], box_max[3];
+      for (unsigned int i = 0; i < 3; ++i) {
+        box_min[i] = (int) (*it)[i] - reach;
+        box_max[i] = (int) (*it)[i] + block_size - 1 + reach;
+      }
+      getOccupiedLeafsRecurs(this->root, 0, OcTreeKey(0, 0, 0), box_min, box_max, task_data.back().sources);
+    }
+
+    // rebuild the blocks
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(+:num_created, num_deleted)
+#endif
+    for (int i = 0; i < (int) tasks.size(); ++i) {
+      SubtreeTask& task = tasks[i];
+      task.has_content = inflateRecurs(result, task.node, task.depth, task.min_key, task_data[i].source_node,
+                                       task_data[i].sources, key_radius, NULL, NULL, 0,
+                                       num_created, num_deleted);
+    }
+
+    KeyBoolMap block_content;
+    for (size_t i = 0; i < tasks.size(); ++i)
+      block_content[tasks[i].min_key] = tasks[i].has_content;
+    bool has_content = result.finishInflationRecurs(result.root, 0, OcTreeKey(0, 0, 0), block_depth,
+                                                    dirty, block_content, num_deleted);
+    result.tree_size += num_created;
+    result.tree_size -= num_deleted;
+    result.size_changed = true;
+    if (!has_content)
+      result.clear();
+
+    return true;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::inflateRecurs(OccupancyOcTreeBase<NODE>& result, NODE* node, unsigned int depth,
+                                                const OcTreeKey& min_key, const NODE* source_node,
+                                                const std::vector<OccupiedLeaf>& sources, double key_radius,
+                                                std::vector<SubtreeTask>* tasks,
+                                                std::vector<InflationTaskData>* task_data,
+                                                unsigned int task_depth, size_t& num_created,
+                                                size_t& num_deleted) const {
+    if (tasks && depth == task_depth) {
+      SubtreeTask task;
+      task.node = node;
+      task.depth = depth;
+      task.min_key = min_key;
+      task.has_content = false;
+      tasks->push_back(task);
+      InflationTaskData data;
+      data.source_node = source_node;
+      task_data->push_back(data);
+      task_data->back().sources = sources;
+      return true;
+    }
+
+    // occupied leafs within the radius of the node, by distances between voxel
+    // centers (in keys): the node is covered if its farthest voxel is within the radius
+    const int size = 1 << (this->tree_depth - depth);
+    const double radius_sq = key_radius * key_radius;
+    std::vector<OccupiedLeaf> near_sources;
+    const NODE* covering_node = NULL;
+    for (typename std::vector<OccupiedLeaf>::const_iterator it = sources.begin(); it != sources.end(); ++it) {
+      const int source_size = 1 << (this->tree_depth - it->depth);
+      double min_dist_sq = 0.0;
+      double max_dist_sq = 0.0;
+      for (unsigned int i = 0; i < 3; ++i) {
+        const int source_first = it->min_key[i];
+        const int source_last = source_first + source_size - 1;
+        const int first = min_key[i];
+        const int last = first + size - 1;
+        const int min_dist = std::max(0, std::max(source_first - last, first - source_last));
+        const int max_dist = std::max(std::max(0, std::max(source_first - first, first - source_last)),
+                                      std::max(0, std::max(source_first - last, last - source_last)));
+        min_dist_sq += double(min_dist) * min_dist;
+        max_dist_sq += double(max_dist) * max_dist;
+      }
+      if (min_dist_sq > radius_sq)
+        continue;
+      if (max_dist_sq <= radius_sq) {
+        covering_node = it->node;
+        break;
+      }
+      near_sources.push_back(*it);
+    }
+
+    if (covering_node) {
+      node->copyData(*covering_node);
+      node->setLogOdds(this->clamping_thres_max);
+      return true;
+    }
+
+    if (near_sources.empty()) {
+      if (source_node == NULL)
+        return false;
+      if (!this->nodeHasChildren(source_node)) {
+        node->copyData(*source_node);
+        return true;
+      }
+      if (tasks == NULL) {
+        result.copyNodeRecurs(node, source_node, num_created);
+        return true;
+      }
+      // otherwise, descend to the deferred subtrees
+    }
+
+    // subdivide
+    const unsigned int half = size / 2;
+    bool has_content = false;
+    for (unsigned int i = 0; i < 8; ++i) {
+      OcTreeKey child_key (min_key[0] + ((i & 1) ? half : 0),
+                           min_key[1] + ((i & 2) ? half : 0),
+                           min_key[2] + ((i & 4) ? half : 0));
+      const NODE* child_source = source_node;
+      if (source_node && this->nodeHasChildren(source_node))
+        child_source = this->nodeChildExists(source_node, i) ? this->getNodeChild(source_node, i) : NULL;
+
+      NODE* child = result.allocNodeChild(node, i, num_created);
+      if (inflateRecurs(result, child, depth + 1, child_key, child_source, near_sources, key_radius,
+                        tasks, task_data, task_depth, num_created, num_deleted))
+        has_content = true;
+      else
+        result.freeNodeChild(node, i, num_deleted);
+    }
+
+    if (!has_content)
+      result.deleteNodeDescendants(node, num_deleted);
+    else if (tasks == NULL)
+      result.pruneOrUpdateNode(node, num_deleted);
+    // otherwise, the node is completed in finishSubtreeTasksRecurs()
+
+    return has_content;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::finishInflationRecurs(NODE* node, unsigned int depth, const OcTreeKey& min_key,
+                                                        unsigned int block_depth, const std::vector<KeySet>& dirty,
+                                                        const KeyBoolMap& block_content, size_t& num_deleted) {
+    if (depth == block_depth)
+      return block_content.find(min_key)->second;
+
+    const unsigned int half = 1u << (this->tree_depth - depth - 1);
+    bool has_content = false;
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+      OcTreeKey child_key (min_key[0] + ((i & 1) ? half : 0),
+                           min_key[1] + ((i & 2) ? half : 0),
+                           min_key[2] + ((i & 4) ? half : 0));
+      if (dirty[depth + 1].find(child_key) != dirty[depth + 1].end()
+          && !finishInflationRecurs(this->getNodeChild(node, i), depth + 1, child_key, block_depth,
+                                    dirty, block_content, num_deleted)) {
+        this->freeNodeChild(node, i, num_deleted);
+        continue;
+      }
+      has_content = true;
+    }
+
+    if (has_content)
+      pruneOrUpdateNode(node, num_deleted);
+    else
+      this->deleteNodeDescendants(node, num_deleted);
+
+    return has_content;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::insertDenseGrid(const OcTreeKey& min_key, unsigned int size_x, unsigned int size_y,
+                                                  unsigned int size_z, const unsigned char* cells, size_t stride_x,
+                                                  size_t stride_y, size_t stride_z, bool mark_free) {
+    DenseGrid grid;
+    grid.cells = cells;
+    grid.stride[0] = stride_x;
+    grid.stride[1] = stride_y;
+    grid.stride[2] = stride_z;
+    grid.mark_free = mark_free;
+    const unsigned int sizes[3] = {size_x, size_y, size_z};
+    for (unsigned int i = 0; i < 3; ++i) {
+      grid.min_key[i] = min_key[i];
+      grid.max_key[i] = (unsigned int) min_key[i] + sizes[i];
+      if (grid.max_key[i] > 2 * (unsigned int) this->tree_max_val) {
+        OCTOMAP_ERROR("Error in insertDenseGrid: grid exceeds the key range of the tree\n");
+        return false;
+      }
+      if (sizes[i] == 0)
+        return true;
+    }
+
+    size_t num_created = 0;
+    size_t num_deleted = 0;
+    bool root_created = (this->root == NULL);
+    if (root_created) {
+      this->root = new NODE();
+      num_created++;
+    }
+
+    // build the upper levels serially, deferring the subtrees at task_depth
+    const unsigned int task_depth = (this->tree_depth > 6) ? this->tree_depth - 6 : 0;
+    std::vector<DenseGridTask> tasks;
+    OcTreeKey root_key(0, 0, 0);
+    insertDenseGridRecurs(this->root, root_created, 0, root_key, grid, &tasks, NULL, task_depth,
+                          num_created, num_deleted);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(+:num_created, num_deleted)
+#endif
+    for (int i = 0; i < (int) tasks.size(); ++i) {
+      DenseGridTask& task = tasks[i];
+      task.has_content = insertDenseGridRecurs(task.node, task.node_created, task.depth, task.min_key, grid,
+                                               NULL, NULL, task_depth, num_created, num_deleted);
+    }
+
+    size_t task_idx = 0;
+    bool has_content = insertDenseGridRecurs(this->root, root_created, 0, root_key, grid, &tasks, &task_idx,
+                                             task_depth, num_created, num_deleted);
+    if (!has_content) {
+      delete this->root;
+      this->root = NULL;
+      num_deleted++;
+    }
+    this->tree_size += num_created;
+    this->tree_size -= num_deleted;
+    this->size_changed = true;
+    return true;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::insertDenseGridRecurs(NODE* node, bool node_created, unsigned int depth,
+                                                        const OcTreeKey& min_key, const DenseGrid& grid,
+                                                        std::vector<DenseGridTask>* tasks, size_t* task_idx,
+                                                        unsigned int task_depth, size_t& num_created,
+                                                        size_t& num_deleted) {
+    if (depth == this->tree_depth) {
+      unsigned char value = grid.cells[(min_key[0] - grid.min_key[0]) * grid.stride[0]
+                                       + (min_key[1] - grid.min_key[1]) * grid.stride[1]
+                                       + (min_key[2] - grid.min_key[2]) * grid.stride[2]];
+      if (value == 0 && !grid.mark_free)
+        return !node_created;
+      updateNodeLogOdds(node, value ? this->prob_hit_log : this->prob_miss_log);
+      return true;
+    }
+
+    if (tasks && depth == task_depth) {
+      if (task_idx) {
+        assert(*task_idx < tasks->size() && (*tasks)[*task_idx].node == node);
+        return (*tasks)[(*task_idx)++].has_content;
+      }
+      DenseGridTask task;
+      task.node = node;
+      task.depth = depth;
+      task.min_key = min_key;
+      task.node_created = node_created;
+      task.has_content = false;
+      tasks->push_back(task);
+      return true;
+    }
+
+    const unsigned int size = 1u << (this->tree_depth - depth);
+    bool inside = true;
+    for (unsigned int i = 0; i < 3 && inside; ++i)
+      inside = (min_key[i] >= grid.min_key[i] && min_key[i] + size <= grid.max_key[i]);
+
+    // lowest inner level: a uniform block of new cells becomes a single leaf
+    if (node_created && inside && size == 2) {
+      const unsigned char* first = grid.cells + (min_key[0] - grid.min_key[0]) * grid.stride[0]
+          + (min_key[1] - grid.min_key[1]) * grid.stride[1] + (min_key[2] - grid.min_key[2]) * grid.stride[2];
+      bool occupied = (first[0] != 0);
+      bool uniform = true;
+      for (unsigned int i = 1; i < 8 && uniform; ++i) {
+        const unsigned char* cell = first + ((i & 1) ? grid.stride[0] : 0) + ((i & 2) ? grid.stride[1] : 0)
+            + ((i & 4) ? grid.stride[2] : 0);
+        uniform = ((*cell != 0) == occupied);
+      }
+      if (uniform) {
+        if (!occupied && !grid.mark_free)
+          return false;
+        updateNodeLogOdds(node, occupied ? this->prob_hit_log : this->prob_miss_log);
+        return true;
+      }
+    }
+
+    const bool collect = (tasks != NULL && task_idx == NULL);
+    const bool finish = !collect;
+    // a known leaf is expanded before it is partially updated
+    if (!node_created && !this->nodeHasChildren(node)) {
+      for (unsigned int i = 0; i < 8; ++i)
+        this->allocNodeChild(node, i, num_created)->copyData(*node);
+    }
+
+    const unsigned int half = size / 2;
+    for (unsigned int i = 0; i < 8; ++i) {
+      OcTreeKey child_key (min_key[0] + ((i & 1) ? half : 0),
+                           min_key[1] + ((i & 2) ? half : 0),
+                           min_key[2] + ((i & 4) ? half : 0));
+      bool intersects = true;
+      for (unsigned int j = 0; j < 3 && intersects; ++j)
+        intersects = (child_key[j] < grid.max_key[j] && child_key[j] + half > grid.min_key[j]);
+      if (!intersects)
+        continue;
+
+      bool child_created = false;
+      NODE* child;
+      if (this->nodeChildExists(node, i)) {
+        child = this->getNodeChild(node, i);
+      } else {
+        child = this->allocNodeChild(node, i, num_created);
+        child_created = true;
+      }
+      // (when finishing tasks, child_created is only relevant at the task depth, where it is stored)
+      bool child_content = insertDenseGridRecurs(child, child_created, depth + 1, child_key, grid,
+                                                 tasks, task_idx, task_depth, num_created, num_deleted);
+      if (finish && !child_content)
+        this->freeNodeChild(node, i, num_deleted);
+    }
+
+    if (collect)
+      return true; // completed when finishing the tasks
+
+    if (!this->nodeHasChildren(node))
+      return false; // new node without known cells
+    pruneOrUpdateNode(node, num_deleted);
+    return true;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::writeOccupiedVoxelCenters(PointCloudWriter& writer) const {
+    std::vector<OccupiedLeaf> leafs;
+    if (this->root) {
+      const int max_key_val = 2 * (int) this->tree_max_val - 1;
+      int box_min[3] = {0, 0, 0};
+      int box_max[3] = {max_key_val, max_key_val, max_key_val};
+      getOccupiedLeafsRecurs(this->root, 0, OcTreeKey(0, 0, 0), box_min, box_max, leafs);
+    }
+
+    // split the voxels of the leafs into batches, each starting at a voxel
+    // (Morton order within the leaf) of a leaf
+    const size_t batch_size = 1 << 16;
+    std::vector<std::pair<size_t, uint64_t> > batch_starts;
+    size_t num_points = 0;
+    for (size_t l = 0; l < leafs.size(); ++l) {
+      const uint64_t num_voxels = ((uint64_t) 1) << (3 * (this->tree_depth - leafs[l].depth));
+      uint64_t v = 0;
+      while (v < num_voxels) {
+        size_t fill = num_points % batch_size;
+        if (fill == 0)
+          batch_starts.push_back(std::make_pair(l, v));
+        uint64_t count = std::min(num_voxels - v, (uint64_t) (batch_size - fill));
+        v += count;
+        num_points += (size_t) count;
+      }
+    }
+    writer.writeHeader(num_points);
+
+    // compute a group of batches in parallel, then write them in order
+    const int group_size = 16;
+    std::vector<point3d_collection> centers(group_size);
+    for (size_t group_start = 0; group_start < batch_starts.size(); group_start += group_size) {
+      const int num_batches = (int) std::min((size_t) group_size, batch_starts.size() - group_start);
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(static)
+#endif
+      for (int b = 0; b < num_batches; ++b) {
+        const size_t batch = group_start + b;
+        const size_t count = std::min(batch_size, num_points - batch * batch_size);
+        point3d_collection& batch_centers = centers[b];
+        batch_centers.resize(count);
+        size_t l = batch_starts[batch].first;
+        uint64_t v = batch_starts[batch].second;
+        uint64_t num_voxels = ((uint64_t) 1) << (3 * (this->tree_depth - leafs[l].depth));
+        for (size_t i = 0; i < count; ++i) {
+          if (v == num_voxels) {
+            ++l;
+            v = 0;
+            num_voxels = ((uint64_t) 1) << (3 * (this->tree_depth - leafs[l].depth));
+          }
+          OcTreeKey offset = mortonCodeToKey(v++);
+          const OcTreeKey& min_key = leafs[l].min_key;
+          batch_centers[i] = this->keyToCoord(OcTreeKey(min_key[0] + offset[0], min_key[1] + offset[1],
+                                                        min_key[2] + offset[2]));
+        }
+      }
+      for (int b = 0; b < num_batches; ++b)
+        writer.writePoints(&centers[b][0], centers[b].size());
+    }
+    return num_points;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::cropToBBX(const point3d& min, const point3d& max, unsigned int crop_depth,
+                                              OccupancyOcTreeBase<NODE>* spill) {
+    CropRegion region;
+    region.sphere = false;
+    region.radius = 0.0;
+    double extent = 0.0;
+    for (unsigned int i = 0; i < 3; ++i) {
+      region.min[i] = std::min(min(i), max(i));
+      region.max[i] = std::max(min(i), max(i));
+      extent = std::max(extent, region.max[i] - region.min[i]);
+    }
+    return crop(region, crop_depth ? crop_depth : computeCropDepth(extent), spill);
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::cropToSphere(const point3d& center, double radius, unsigned int crop_depth,
+                                                 OccupancyOcTreeBase<NODE>* spill) {
+    CropRegion region;
+    region.sphere = true;
+    region.radius = std::max(radius, 0.0);
+    for (unsigned int i = 0; i < 3; ++i)
+      region.min[i] = region.max[i] = center(i);
+    return crop(region, crop_depth ? crop_depth : computeCropDepth(2.0 * region.radius), spill);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::setLocalMapRadius(double radius, OccupancyOcTreeBase<NODE>* spill) {
+    local_map_radius = radius;
+    local_map_spill = spill;
+    local_map_cropped = false;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::updateLocalMap(const point3d& sensor_origin) {
+    if (local_map_cropped && (sensor_origin - local_map_origin).norm() <= local_map_radius / 8.0)
+      return;
+    cropToSphere(sensor_origin, local_map_radius, 0, local_map_spill);
+    local_map_origin = sensor_origin;
+    local_map_cropped = true;
+  }
+
+  template <class NODE>
+  typename OccupancyOcTreeBase<NODE>::CropState
+  OccupancyOcTreeBase<NODE>::classifyCropRegion(const CropRegion& region, const OcTreeKey& min_key,
+                                                unsigned int depth) const {
+    const double size = this->resolution * (double) (1 << (this->tree_depth - depth));
+    double lo[3], hi[3];
+    for (unsigned int i = 0; i < 3; ++i) {
+      lo[i] = ((int) min_key[i] - (int) this->tree_max_val) * this->resolution;
+      hi[i] = lo[i] + size;
+    }
+
+    if (!region.sphere) {
+      bool inside = true;
+      for (unsigned int i = 0; i < 3; ++i) {
+        if (hi[i] <= region.min[i] || lo[i] > region.max[i])
+          return CROP_OUTSIDE;
+        if (lo[i] < region.min[i] || hi[i] > region.max[i])
+          inside = false;
+      }
+      return inside ? CROP_INSIDE : CROP_PARTIAL;
+    }
+
+    // distance of the nearest and farthest point of the node to the center
+    double near_sq = 0.0, far_sq = 0.0;
+    for (unsigned int i = 0; i < 3; ++i) {
+      const double c = region.min[i];
+      const double d_near = (c < lo[i]) ? lo[i] - c : ((c > hi[i]) ? c - hi[i] : 0.0);
+      const double d_far = std::max(c - lo[i], hi[i] - c);
+      near_sq += d_near * d_near;
+      far_sq += d_far * d_far;
+    }
+    const double radius_sq = region.radius * region.radius;
+    if (near_sq > radius_sq)
+      return CROP_OUTSIDE;
+    return (far_sq <= radius_sq) ? CROP_INSIDE : CROP_PARTIAL;
+  }
+
+  template <class NODE>
+  unsigned int OccupancyOcTreeBase<NODE>::computeCropDepth(double extent) const {
+    unsigned int depth = this->tree_depth;
+    while (depth > 1 && this->resolution * (double) (1 << (this->tree_depth - depth)) < extent / 16.0)
+      --depth;
+    return depth;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::crop(const CropRegion& region, unsigned int crop_depth,
+                                         OccupancyOcTreeBase<NODE>* spill) {
+    if (spill == this || (spill && (spill->getResolution() != this->resolution
+                                    || spill->getTreeDepth() != this->tree_depth))) {
+      OCTOMAP_ERROR("Spill tree of crop must be a different tree with the same resolution.\n");
+      return 0;
+    }
+    if (this->root == NULL)
+      return 0;
+
+    const OcTreeKey root_key(0, 0, 0);
+    size_t num_removed = 0;
+    CropState state = classifyCropRegion(region, root_key, 0);
+    if (state == CROP_OUTSIDE) {
+      num_removed = this->tree_size;
+      if (spill)
+        spillSubtree(this->root, num_removed, 0, root_key, *spill);
+      else
+        this->deleteNodeRecurs(this->root);
+      this->root = NULL;
+    } else if (state == CROP_PARTIAL && crop_depth > 0 && this->nodeHasChildren(this->root)) {
+      if (cropRecurs(this->root, 0, root_key, region, crop_depth, spill, num_removed)) {
+        this->deleteNodeDescendants(this->root, num_removed);
+        delete this->root;
+        this->root = NULL;
+        ++num_removed;
+      }
+    }
+
+    if (num_removed > 0) {
+      this->tree_size -= num_removed;
+      this->size_changed = true;
+    }
+    return num_removed;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::cropRecurs(NODE* node, unsigned int depth, const OcTreeKey& min_key,
+                                             const CropRegion& region, unsigned int crop_depth,
+                                             OccupancyOcTreeBase<NODE>* spill, size_t& num_removed) {
+    const size_t num_removed_before = num_removed;
+    const unsigned int child_size = 1 << (this->tree_depth - depth - 1);
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+      OcTreeKey child_key(min_key[0] + ((i & 1) ? child_size : 0),
+                          min_key[1] + ((i & 2) ? child_size : 0),
+                          min_key[2] + ((i & 4) ? child_size : 0));
+      CropState state = classifyCropRegion(region, child_key, depth + 1);
+      if (state == CROP_OUTSIDE) {
+        if (spill) {
+          NODE* subtree = this->detachNodeChild(node, i);
+          size_t num_nodes = 1;
+          this->calcNumNodesRecurs(subtree, num_nodes);
+          spillSubtree(subtree, num_nodes, depth + 1, child_key, *spill);
+          num_removed += num_nodes;
+        } else
+          this->freeNodeChild(node, i, num_removed);
+      } else if (state == CROP_PARTIAL && depth + 1 < crop_depth
+                 && this->nodeHasChildren(this->getNodeChild(node, i))) {
+        if (cropRecurs(this->getNodeChild(node, i), depth + 1, child_key, region, crop_depth, spill, num_removed))
+          this->freeNodeChild(node, i, num_removed);
+      }
+    }
+
+    if (num_removed == num_removed_before)
+      return false;
+    if (!this->nodeHasChildren(node))
+      return true;
+    updateCroppedInnerNode(node);
+    return false;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::spillSubtree(NODE* subtree, size_t num_nodes, unsigned int depth,
+                                               const OcTreeKey& min_key, OccupancyOcTreeBase<NODE>& spill) const {
+    spill.size_changed = true;
+    size_t num_created = 0, num_deleted = 0;
+    if (depth == 0) {
+      if (spill.root)
+        mergeSpilledNodeRecurs(spill.root, subtree, spill, num_created, num_deleted);
+      else
+        spill.root = subtree;
+      spill.tree_size += num_nodes + num_created - num_deleted;
+      return;
+    }
+
+    bool created = false;
+    if (spill.root == NULL) {
+      spill.root = new NODE();
+      ++num_created;
+      created = true;
+    }
+
+    // path to the parent of the subtree, known leafs on the way are expanded
+    std::vector<NODE*> path(depth);
+    NODE* node = spill.root;
+    for (unsigned int d = 0; d < depth; ++d) {
+      if (!created && !spill.nodeHasChildren(node)) {
+        for (unsigned int k = 0; k < 8; ++k)
+          spill.allocNodeChild(node, k, num_created)->copyData(*node);
+      }
+      path[d] = node;
+      unsigned int pos = computeChildIdx(min_key, this->tree_depth - 1 - d);
+      if (d + 1 == depth) {
+        if (spill.nodeChildExists(node, pos))
+          mergeSpilledNodeRecurs(spill.getNodeChild(node, pos), subtree, spill, num_created, num_deleted);
+        else
+          spill.attachNodeChild(node, pos, subtree);
+      } else if (spill.nodeChildExists(node, pos)) {
+        node = spill.getNodeChild(node, pos);
+        created = false;
+      } else {
+        node = spill.allocNodeChild(node, pos, num_created);
+        created = true;
+      }
+    }
+
+    for (unsigned int d = depth; d > 0; --d)
+      spill.updateCroppedInnerNode(path[d - 1]);
+    spill.tree_size += num_nodes + num_created - num_deleted;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::mergeSpilledNodeRecurs(NODE* node, NODE* subtree, OccupancyOcTreeBase<NODE>& spill,
+                                                         size_t& num_created, size_t& num_deleted) const {
+    if (!this->nodeHasChildren(subtree)) {
+      // a known leaf replaces the spilled content
+      spill.deleteNodeDescendants(node, num_deleted);
+      node->copyData(*subtree);
+      spill.deleteNodeDescendants(subtree, num_deleted);
+      delete subtree;
+      ++num_deleted;
+      return;
+    }
+
+    // parts not covered by the subtree keep the value of a known leaf
+    if (!spill.nodeHasChildren(node)) {
+      for (unsigned int k = 0; k < 8; ++k)
+        spill.allocNodeChild(node, k, num_created)->copyData(*node);
+    }
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (!this->nodeChildExists(subtree, i))
+        continue;
+      NODE* child = spill.detachNodeChild(subtree, i);
+      if (spill.nodeChildExists(node, i))
+        mergeSpilledNodeRecurs(spill.getNodeChild(node, i), child, spill, num_created, num_deleted);
+      else
+        spill.attachNodeChild(node, i, child);
+    }
+    delete subtree;
+    ++num_deleted;
+    spill.updateCroppedInnerNode(node);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::evaluateScan(const Pointcloud& scan, const point3d& origin, double maxrange,
+                                               ScanEvaluation& result) const {
+    std::vector<uint64_t> free_codes, occupied_codes;
+    computeUpdateCodes(scan, origin, maxrange, free_codes, occupied_codes);
+
+    std::vector<NODE*> free_nodes, occupied_nodes;
+    this->searchSorted(free_codes, free_nodes);
+    this->searchSorted(occupied_codes, occupied_nodes);
+
+    size_t free_correct = 0, free_wrong = 0, free_unknown = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for reduction(+:free_correct, free_wrong, free_unknown)
+#endif
+    for (long i = 0; i < (long) free_nodes.size(); ++i) {
+      if (free_nodes[i] == NULL)
+        ++free_unknown;
+      else if (this->isNodeOccupied(free_nodes[i]))
+        ++free_wrong;
+      else
+        ++free_correct;
+    }
+    size_t occupied_correct = 0, occupied_wrong = 0, occupied_unknown = 0;
+    for (size_t i = 0; i < occupied_nodes.size(); ++i) {
+      if (occupied_nodes[i] == NULL)
+        ++occupied_unknown;
+      else if (this->isNodeOccupied(occupied_nodes[i]))
+        ++occupied_correct;
+      else
+        ++occupied_wrong;
+    }
+
+    result.num_scans++;
+    result.num_points += scan.size();
+    result.free_correct += free_correct;
+    result.free_wrong += free_wrong;
+    result.free_unknown += free_unknown;
+    result.occupied_correct += occupied_correct;
+    result.occupied_wrong += occupied_wrong;
+    result.occupied_unknown += occupied_unknown;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::computeUpdateCodes(const Pointcloud& scan, const point3d& origin, double maxrange,
+                                                     std::vector<uint64_t>& free_codes,
+                                                     std::vector<uint64_t>& occupied_codes) const {
+    unsigned int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+    std::vector<KeySet> thread_free(num_threads), thread_occupied(num_threads);
+
+    // same cells as in computeUpdate(), collected per thread without locking
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+      unsigned int thread_idx = 0;
+#ifdef _OPENMP
+      thread_idx = omp_get_thread_num();
+#endif
+      KeyRay keyray;
+      KeySet& free_cells = thread_free[thread_idx];
+      KeySet& occupied_cells = thread_occupied[thread_idx];
+
+#ifdef _OPENMP
+      #pragma omp for schedule(guided)
+#endif
+      for (int i = 0; i < (int) scan.size(); ++i) {
+        const point3d& p = scan[i];
+        OcTreeKey key;
+        if (!use_bbx_limit) {
+          if ((maxrange < 0.0) || ((p - origin).norm() <= maxrange)) {
+            if (this->computeRayKeys(origin, p, keyray))
+              free_cells.insert(keyray.begin(), keyray.end());
+            if (this->coordToKeyChecked(p, key))
+              occupied_cells.insert(key);
+          } else {
+            point3d new_end = origin + (p - origin).normalized() * (float) maxrange;
+            if (this->computeRayKeys(origin, new_end, keyray))
+              free_cells.insert(keyray.begin(), keyray.end());
+          }
+        } else if (inBBX(p) && ((maxrange < 0.0) || ((p - origin).norm() <= maxrange))) {
+          if (this->coordToKeyChecked(p, key))
+            occupied_cells.insert(key);
+          if (this->computeRayKeys(origin, p, keyray)) {
+            for (KeyRay::reverse_iterator rit = keyray.rbegin(); rit != keyray.rend() && inBBX(*rit); ++rit)
+              free_cells.insert(*rit);
+          }
+        }
+      }
+    }
+
+    free_codes.clear();
+    occupied_codes.clear();
+    for (unsigned int t = 0; t < num_threads; ++t) {
+      for (KeySet::const_iterator it = thread_occupied[t].begin(); it != thread_occupied[t].end(); ++it)
+        occupied_codes.push_back(computeMortonCode(*it));
+      for (KeySet::const_iterator it = thread_free[t].begin(); it != thread_free[t].end(); ++it)
+        free_codes.push_back(computeMortonCode(*it));
+      KeySet().swap(thread_free[t]);
+    }
+    std::sort(occupied_codes.begin(), occupied_codes.end());
+    std::sort(free_codes.begin(), free_codes.end());
+    if (num_threads > 1) {
+      free_codes.erase(std::unique(free_codes.begin(), free_codes.end()), free_codes.end());
+      occupied_codes.erase(std::unique(occupied_codes.begin(), occupied_codes.end()), occupied_codes.end());
+    }
+
+    // prefer occupied cells over free ones
+    std::vector<uint64_t> free_only;
+    free_only.reserve(free_codes.size());
+    std::set_difference(free_codes.begin(), free_codes.end(), occupied_codes.begin(), occupied_codes.end(),
+                        std::back_inserter(free_only));
+    free_codes.swap(free_only);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::scorePoses(const Pointcloud& scan, const std::vector<pose6d>& poses,
+                                             std::vector<unsigned int>& hits) const {
+    hits.assign(poses.size(), 0);
+    const size_t num_points = scan.size();
+    if (this->root == NULL || num_points == 0)
+      return;
+
+    // separate coordinate arrays for the transform loop
+    std::vector<double> xs(num_points);
+    std::vector<double> ys(num_points);
+    std::vector<double> zs(num_points);
+    for (size_t j = 0; j < num_points; ++j) {
+      xs[j] = scan[j].x();
+      ys[j] = scan[j].y();
+      zs[j] = scan[j].z();
+    }
+
+    const int num_poses = (int) poses.size();
+    const int key_offset = (int) this->tree_max_val;
+    const double max_val = (double) this->tree_max_val;
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+      std::vector<uint64_t> codes;
+      codes.reserve(num_points);
+      std::vector<NODE*> nodes;
+      std::vector<double> rot;
+#ifdef _OPENMP
+      #pragma omp for schedule(dynamic, 16)
+#endif
+      for (int i = 0; i < num_poses; ++i) {
+        // transform in double and scale like coordToKey(), into (continuous) keys
+        // without the offset of tree_max_val
+        poses[i].rot().toRotMatrix(rot);
+        double m[9];
+        for (unsigned int k = 0; k < 9; ++k)
+          m[k] = rot[k];
+        const point3d& t = poses[i].trans();
+        const double t0 = t.x();
+        const double t1 = t.y();
+        const double t2 = t.z();
+        const double* px = &xs[0];
+        const double* py = &ys[0];
+        const double* pz = &zs[0];
+
+        codes.clear();
+        for (size_t j = 0; j < num_points; ++j) {
+          const double x = this->resolution_factor * (m[0] * px[j] + m[1] * py[j] + m[2] * pz[j] + t0);
+          const double y = this->resolution_factor * (m[3] * px[j] + m[4] * py[j] + m[5] * pz[j] + t1);
+          const double z = this->resolution_factor * (m[6] * px[j] + m[7] * py[j] + m[8] * pz[j] + t2);
+          // range check before the conversion, which overflows far outside of the tree
+          if (x >= -max_val && y >= -max_val && z >= -max_val && x < max_val && y < max_val && z < max_val)
+            codes.push_back(computeMortonCode(OcTreeKey((key_type) ((int) floor(x) + key_offset),
+                                                        (key_type) ((int) floor(y) + key_offset),
+                                                        (key_type) ((int) floor(z) + key_offset))));
+        }
+        std::sort(codes.begin(), codes.end());
+        this->searchSorted(codes, nodes);
+
+        unsigned int num_hits = 0;
+        for (size_t j = 0; j < nodes.size(); ++j) {
+          if (nodes[j] && this->isNodeOccupied(nodes[j]))
+            ++num_hits;
+        }
+        hits[i] = num_hits;
+      }
+    }
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::computeLikelihoodField(const point3d& min, const point3d& max, double sigma,
+                                                         double random_prob, LikelihoodField& field) const {
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(min, min_key) || !this->coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in computeLikelihoodField: box [" << min << ", " << max << "] is out of the tree bounds");
+      return false;
+    }
+    for (unsigned int i = 0; i < 3; ++i) {
+      if (min_key[i] > max_key[i]) {
+        OCTOMAP_ERROR_STR("Error in computeLikelihoodField: box [" << min << ", " << max << "] is empty");
+        return false;
+      }
+    }
+
+    const double half_res = 0.5 * this->resolution;
+    point3d origin = this->keyToCoord(min_key);
+    origin -= point3d((float) half_res, (float) half_res, (float) half_res);
+    field.reset(this->resolution, origin, max_key[0] - min_key[0] + 1,
+                max_key[1] - min_key[1] + 1, max_key[2] - min_key[2] + 1);
+
+    if (this->root) {
+      for (typename OccupancyOcTreeBase<NODE>::leaf_bbx_iterator it = this->begin_leafs_bbx(min_key, max_key),
+             end = this->end_leafs_bbx(); it != end; ++it) {
+        if (!this->isNodeOccupied(*it))
+          continue;
+
+        // occupied leafs above the finest depth fill their whole extent (within the box)
+        const unsigned int leaf_size = 1 << (this->tree_depth - it.getDepth());
+        const OcTreeKey key = it.getKey();
+        unsigned int lo[3];
+        unsigned int hi[3];
+        for (unsigned int i = 0; i < 3; ++i) {
+          unsigned int leaf_min = key[i] - key[i] % leaf_size;
+          lo[i] = std::max(leaf_min, (unsigned int) min_key[i]) - min_key[i];
+          hi[i] = std::min(leaf_min + leaf_size - 1, (unsigned int) max_key[i]) - min_key[i];
+        }
+        for (unsigned int z = lo[2]; z <= hi[2]; ++z)
+          for (unsigned int y = lo[1]; y <= hi[1]; ++y)
+            for (unsigned int x = lo[0]; x <= hi[0]; ++x)
+              field.distance[field.index(x, y, z)] = 0.0f;
+      }
+    }
+
+    field.computeDistances(4.0 * sigma);
+    field.setSensorModel(sigma, random_prob);
+    return true;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getVoxelSurfaceMesh(IndexedMesh& mesh) const {
+    mesh.clear();
+    if (this->root == NULL)
+      return;
+
+    std::vector<OccupiedLeaf> leafs;
+    const int max_key_val = 2 * (int) this->tree_max_val - 1;
+    int box_min[3] = {0, 0, 0};
+    int box_max[3] = {max_key_val, max_key_val, max_key_val};
+    getOccupiedLeafsRecurs(this->root, 0, OcTreeKey(0, 0, 0), box_min, box_max, leafs);
+
+    // faces of chunks of (spatially close) leafs, merged into rectangles
+    // within the chunk and combined in order for a deterministic result
+    const size_t chunk_size = 1024;
+    std::vector<std::vector<VoxelFace> > chunk_faces((leafs.size() + chunk_size - 1) / chunk_size);
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int c = 0; c < (int) chunk_faces.size(); ++c) {
+      size_t end = std::min(leafs.size(), (c + 1) * chunk_size);
+      for (size_t l = c * chunk_size; l < end; ++l)
+        addExposedFaces(leafs[l], chunk_faces[c]);
+      mergeVoxelFaces<0>(chunk_faces[c]);
+      mergeVoxelFaces<1>(chunk_faces[c]);
+    }
+
+    // share the vertices at the same lattice points (coordinates up to 2^16: 17 bits each)
+    unordered_ns::unordered_map<uint64_t, unsigned int> vertex_indices;
+    for (size_t c = 0; c < chunk_faces.size(); ++c) {
+      const std::vector<VoxelFace>& faces = chunk_faces[c];
+      for (size_t f = 0; f < faces.size(); ++f) {
+        const VoxelFace& face = faces[f];
+        const unsigned int u = (face.axis + 1) % 3;
+        const unsigned int v = (face.axis + 2) % 3;
+        // counter-clockwise seen from the positive side of axis
+        const unsigned int offsets[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+        unsigned int corners[4];
+        for (unsigned int i = 0; i < 4; ++i) {
+          const unsigned int* offset = offsets[face.positive ? i : 3 - i];
+          uint64_t coords[3];
+          coords[face.axis] = face.plane;
+          coords[u] = face.min[0] + offset[0] * face.size[0];
+          coords[v] = face.min[1] + offset[1] * face.size[1];
+          uint64_t id = coords[0] | (coords[1] << 17) | (coords[2] << 34);
+          std::pair<typename unordered_ns::unordered_map<uint64_t, unsigned int>::iterator, bool> inserted
+              = vertex_indices.insert(std::make_pair(id, (unsigned int) mesh.vertices.size()));
+          if (inserted.second) {
+            mesh.vertices.push_back(point3d((float) (((double) coords[0] - this->tree_max_val) * this->resolution),
+                                            (float) (((double) coords[1] - this->tree_max_val) * this->resolution),
+                                            (float) (((double) coords[2] - this->tree_max_val) * this->resolution)));
+          }
+          corners[i] = inserted.first->second;
+        }
+        const unsigned int triangles[6] = {corners[0], corners[1], corners[2], corners[0], corners[2], corners[3]};
+        mesh.indices.insert(mesh.indices.end(), triangles, triangles + 6);
+      }
+      std::vector<VoxelFace>().swap(chunk_faces[c]);
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::addExposedFaces(const OccupiedLeaf& leaf, std::vector<VoxelFace>& faces) const {
+    const unsigned int size = 1u << (this->tree_depth - leaf.depth);
+    for (unsigned int axis = 0; axis < 3; ++axis) {
+      for (unsigned int side = 0; side < 2; ++side) {
+        const bool positive = (side == 1);
+        const unsigned int plane = leaf.min_key[axis] + (positive ? size : 0);
+        // cube of the same size across the face
+        OcTreeKey neighbor_key = leaf.min_key;
+        if (positive) {
+          if (plane >= 2 * (unsigned int) this->tree_max_val) {
+            addVoxelFace(leaf.min_key, size, axis, positive, plane, faces);
+            continue;
+          }
+          neighbor_key[axis] = (key_type) plane;
+        } else {
+          if (plane == 0) {
+            addVoxelFace(leaf.min_key, size, axis, positive, plane, faces);
+            continue;
+          }
+          neighbor_key[axis] = (key_type) (plane - size);
+        }
+
+        const NODE* node = this->root;
+        unsigned int depth = 0;
+        for (; depth < leaf.depth; ++depth) {
+          unsigned int pos = computeChildIdx(neighbor_key, this->tree_depth - 1 - depth);
+          if (!this->nodeHasChildren(node) || !this->nodeChildExists(node, pos))
+            break;
+          node = this->getNodeChild(node, pos);
+        }
+        if (depth == leaf.depth)
+          addExposedFacesRecurs(node, depth, neighbor_key, axis, positive, plane, faces);
+        else if (!this->nodeHasChildren(node) && this->isNodeOccupied(node))
+          continue; // hidden by a larger occupied leaf
+        else
+          addVoxelFace(neighbor_key, size, axis, positive, plane, faces);
+      }
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::addExposedFacesRecurs(const NODE* node, unsigned int depth,
+                                                        const OcTreeKey& min_key, unsigned int axis,
+                                                        bool positive, unsigned int plane,
+                                                        std::vector<VoxelFace>& faces) const {
+    const unsigned int size = 1u << (this->tree_depth - depth);
+    // inner nodes hold the maximum occupancy of their children
+    if (!this->isNodeOccupied(node)) {
+      addVoxelFace(min_key, size, axis, positive, plane, faces);
+      return;
+    }
+    if (!this->nodeHasChildren(node))
+      return;
+
+    // children touching the face
+    const unsigned int half = size / 2;
+    const unsigned int axis_bit = 1u << axis;
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (((i & axis_bit) != 0) == positive)
+        continue;
+      OcTreeKey child_key (min_key[0] + ((i & 1) ? half : 0),
+                           min_key[1] + ((i & 2) ? half : 0),
+                           min_key[2] + ((i & 4) ? half : 0));
+      if (this->nodeChildExists(node, i))
+        addExposedFacesRecurs(this->getNodeChild(node, i), depth + 1, child_key, axis, positive, plane, faces);
+      else
+        addVoxelFace(child_key, half, axis, positive, plane, faces);
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::addVoxelFace(const OcTreeKey& min_key, unsigned int size, unsigned int axis,
+                                               bool positive, unsigned int plane, std::vector<VoxelFace>& faces) {
+    VoxelFace face;
+    face.axis = axis;
+    face.positive = positive;
+    face.plane = plane;
+    face.min[0] = min_key[(axis + 1) % 3];
+    face.min[1] = min_key[(axis + 2) % 3];
+    face.size[0] = face.size[1] = size;
+    faces.push_back(face);
+  }
+
+  template <class NODE>
+  template <unsigned int DIRECTION>
+  bool OccupancyOcTreeBase<NODE>::VoxelFaceRowOrder<DIRECTION>::operator()(const VoxelFace& a,
+                                                                           const VoxelFace& b) const {
+    const unsigned int other = 1 - DIRECTION;
+    if (a.axis != b.axis) return a.axis < b.axis;
+    if (a.positive != b.positive) return b.positive;
+    if (a.plane != b.plane) return a.plane < b.plane;
+    if (a.min[other] != b.min[other]) return a.min[other] < b.min[other];
+    if (a.size[other] != b.size[other]) return a.size[other] < b.size[other];
+    return a.min[DIRECTION] < b.min[DIRECTION];
+  }
+
+  template <class NODE>
+  template <unsigned int DIRECTION>
+  void OccupancyOcTreeBase<NODE>::mergeVoxelFaces(std::vector<VoxelFace>& faces) {
+    if (faces.empty())
+      return;
+    std::sort(faces.begin(), faces.end(), VoxelFaceRowOrder<DIRECTION>());
+
+    const unsigned int other = 1 - DIRECTION;
+    size_t last = 0;
+    for (size_t i = 1; i < faces.size(); ++i) {
+      VoxelFace& prev = faces[last];
+      const VoxelFace& face = faces[i];
+      if (face.axis == prev.axis && face.positive == prev.positive && face.plane == prev.plane
+          && face.min[other] == prev.min[other] && face.size[other] == prev.size[other]
+          && face.min[DIRECTION] == prev.min[DIRECTION] + prev.size[DIRECTION])
+        prev.size[DIRECTION] += face.size[DIRECTION];
+      else
+        faces[++last] = face;
+    }
+    faces.resize(last + 1);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getLeafNormals(point3d_collection& centers, point3d_collection& normals,
+                                                 bool unknownStatus) const {
+    centers.clear();
+    for (typename OccupancyOcTreeBase<NODE>::leaf_iterator it = this->begin_leafs(),
+           end = this->end_leafs(); it != end; ++it) {
+      if (this->isNodeOccupied(*it))
+        centers.push_back(it.getCoordinate());
+    }
+    computeVoxelNormals(centers, normals, unknownStatus);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getLeafNormals(const point3d& min, const point3d& max,
+                                                 point3d_collection& centers, point3d_collection& normals,
+                                                 bool unknownStatus) const {
+    centers.clear();
+    normals.clear();
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(min, min_key) || !this->coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in getLeafNormals: bounding box " << min << " - " << max << " out of tree bounds");
+      return;
+    }
+    for (typename OccupancyOcTreeBase<NODE>::leaf_bbx_iterator it = this->begin_leafs_bbx(min_key, max_key),
+           end = this->end_leafs_bbx(); it != end; ++it) {
+      point3d center = it.getCoordinate();
+      if (this->isNodeOccupied(*it)
+          && center.x() >= min.x() && center.y() >= min.y() && center.z() >= min.z()
+          && center.x() <= max.x() && center.y() <= max.y() && center.z() <= max.z())
+        centers.push_back(center);
+    }
+    computeVoxelNormals(centers, normals, unknownStatus);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::computeVoxelNormals(const point3d_collection& points, point3d_collection& normals,
+                                                      bool unknownStatus) const {
+    normals.assign(points.size(), point3d(0.0f, 0.0f, 0.0f));
+
+    // group the points by blocks of voxels, which are sampled once (with a margin
+    // of one voxel for the neighbors) instead of searching every cube corner
+    const unsigned int block_size_log2 = 4;
+    const int block_size = 1 << block_size_log2;
+    const int n = block_size + 2;
+    std::vector<OcTreeKey> keys(points.size());
+    unordered_ns::unordered_map<OcTreeKey, size_t, OcTreeKey::KeyHash> block_index;
+    std::vector<OcTreeKey> block_keys;
+    std::vector<std::vector<size_t> > block_points;
+    for (size_t i = 0; i < points.size(); ++i) {
+      if (!this->coordToKeyChecked(points[i], keys[i])) {
+        OCTOMAP_WARNING_STR("Voxel out of bounds");
+        continue;
+      }
+      OcTreeKey block_key(keys[i][0] >> block_size_log2, keys[i][1] >> block_size_log2,
+                          keys[i][2] >> block_size_log2);
+      std::pair<typename unordered_ns::unordered_map<OcTreeKey, size_t, OcTreeKey::KeyHash>::iterator, bool> inserted
+        = block_index.insert(std::make_pair(block_key, block_keys.size()));
+      if (inserted.second) {
+        block_keys.push_back(block_key);
+        block_points.push_back(std::vector<size_t>());
+      }
+      block_points[inserted.first->second].push_back(i);
+    }
+
+    // same neighborhood as in getNormals()
+    static const int x_index[4][4] = {{1, 1, 0, 0}, {1, 1, 0, 0}, {0, 0, -1, -1}, {0, 0, -1, -1}};
+    static const int y_index[4][4] = {{1, 0, 0, 1}, {0, -1, -1, 0}, {0, -1, -1, 0}, {1, 0, 0, 1}};
+    static const int z_index[2][2] = {{0, 1}, {-1, 0}};
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int b = 0; b < (int) block_keys.size(); ++b) {
+      // sample the block and its neighbors: grid cell (x, y, z) holds key origin + (x, y, z)
+      int origin[3];
+      OcTreeKey min_key, max_key;
+      for (unsigned int i = 0; i < 3; ++i) {
+        origin[i] = ((int) block_keys[b][i] << block_size_log2) - 1;
+        min_key[i] = (key_type) std::max(origin[i], 0);
+        max_key[i] = (key_type) std::min(origin[i] + n - 1, 65535);
+      }
+      std::vector<char> grid(n * n * n, (char) unknownStatus);
+      const unsigned int tree_depth = this->tree_depth;
+      for (typename OccupancyOcTreeBase<NODE>::leaf_bbx_iterator it = this->begin_leafs_bbx(min_key, max_key),
+             end = this->end_leafs_bbx(); it != end; ++it) {
+        OcTreeKey leaf_min = it.getIndexKey();
+        int leaf_size = 1 << (tree_depth - it.getDepth());
+        int lo[3], hi[3];
+        for (unsigned int i = 0; i < 3; ++i) {
+          lo[i] = std::max((int) leaf_min[i], (int) min_key[i]) - origin[i];
+          hi[i] = std::min((int) leaf_min[i] + leaf_size - 1, (int) max_key[i]) - origin[i];
+        }
+        char occupied = (char) this->isNodeOccupied(*it);
+        for (int z = lo[2]; z <= hi[2]; ++z)
+          for (int y = lo[1]; y <= hi[1]; ++y)
+            for (int x = lo[0]; x <= hi[0]; ++x)
+              grid[(z * n + y) * n + x] = occupied;
+      }
+
+      for (size_t p = 0; p < block_points[b].size(); ++p) {
+        size_t idx = block_points[b][p];
+        int x0 = (int) keys[idx][0] - origin[0];
+        int y0 = (int) keys[idx][1] - origin[1];
+        int z0 = (int) keys[idx][2] - origin[2];
+        point3d normal(0.0f, 0.0f, 0.0f);
+
+        for (int m = 0; m < 2; ++m) {
+          for (int l = 0; l < 4; ++l) {
+            int cube_index = 0;
+            int k = 0;
+            for (int j = 0; j < 2; ++j) {
+              for (int i = 0; i < 4; ++i) {
+                if (grid[((z0 + z_index[m][j]) * n + (y0 + y_index[l][i])) * n + (x0 + x_index[l][i])])
+                  cube_index |= (1 << k);
+                ++k;
+              }
+            }
+            if (edgeTable[cube_index] == 0)
+              continue;
+
+            for (int i = 0; triTable[cube_index][i] != -1; i += 3) {
+              point3d p1 = vertexList[triTable[cube_index][i  ]];
+              point3d p2 = vertexList[triTable[cube_index][i+1]];
+              point3d p3 = vertexList[triTable[cube_index][i+2]];
+              normal += (p2 - p1).cross(p3 - p1).normalize();
+            }
+          }
+        }
+
+        if (normal.norm() > 0.0)
+          normal.normalize();
+        normals[idx] = normal;
+      }
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::computeInformationGain(const std::vector<pose6d>& candidates,
+                                                         const FovSensorModel& sensor,
+                                                         std::vector<double>& gains) {
+    gains.assign(candidates.size(), 0.0);
+    if (candidates.empty())
+      return;
+
+    const std::vector<point3d>& directions = sensor.getRayDirections();
+    const double max_range = sensor.getMaxRange();
+
+#ifdef _OPENMP
+    omp_set_num_threads(this->keyrays.size());
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int c = 0; c < (int)candidates.size(); ++c) {
+      unsigned threadIdx = 0;
+#ifdef _OPENMP
+      threadIdx = omp_get_thread_num();
+#endif
+      KeyRay* keyray = &(this->keyrays.at(threadIdx));
+
+      const pose6d& pose = candidates[c];
+      const point3d origin = pose.trans();
+      KeySet unknown_cells;
+
+      for (size_t r = 0; r < directions.size(); ++r) {
+        point3d end = origin + pose.rot().rotate(directions[r]) * (float) max_range;
+        OcTreeKey end_key;
+        if (!this->coordToKeyChecked(end, end_key) || !this->computeRayKeys(origin, end, *keyray))
+          continue;
+        keyray->addKey(end_key); // the ray excludes its endpoint
+
+        // the last known cube (free leaf or unknown space) on the ray, keys inside of it
+        // need no further lookup
+        OcTreeKey cube_key;
+        unsigned int cube_shift = 0;
+        bool cube_valid = false;
+        bool cube_unknown = false;
+
+        for (KeyRay::iterator it = keyray->begin(); it != keyray->end(); ++it) {
+          const OcTreeKey& key = *it;
+          if (cube_valid
+              && (key[0] >> cube_shift) == (cube_key[0] >> cube_shift)
+              && (key[1] >> cube_shift) == (cube_key[1] >> cube_shift)
+              && (key[2] >> cube_shift) == (cube_key[2] >> cube_shift)) {
+            if (cube_unknown)
+              unknown_cells.insert(key);
+            continue;
+          }
+
+          unsigned int node_depth;
+          NODE* node = this->searchWithDepth(key, node_depth);
+          if (node && this->isNodeOccupied(node))
+            break; // ray blocked
+
+          cube_key = key;
+          cube_shift = this->tree_depth - node_depth;
+          cube_valid = true;
+          cube_unknown = (node == NULL);
+          if (cube_unknown)
+            unknown_cells.insert(key);
+        }
+      }
+      gains[c] = (double) unknown_cells.size();
+    }
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::project2D(const point3d& min, const point3d& max, OccupancyGrid2D& grid) const {
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(min, min_key) || !this->coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in project2D: [" << min << "] - [" << max << "] is out of OcTree bounds!");
+      return false;
+    }
+    for (unsigned int i = 0; i < 3; ++i) {
+      if (min_key[i] > max_key[i]) {
+        OCTOMAP_ERROR_STR("Error in project2D: min [" << min << "] is not below max [" << max << "]");
+        return false;
+      }
+    }
+
+    grid.reset(this->resolution,
+               (double((int) min_key[0] - (int) this->tree_max_val)) * this->resolution,
+               (double((int) min_key[1] - (int) this->tree_max_val)) * this->resolution,
+               max_key[0] - min_key[0] + 1, max_key[1] - min_key[1] + 1);
+    grid.min_key = min_key;
+    grid.max_key = max_key;
+
+    if (this->root == NULL)
+      return true;
+
+    // tiles of the grid are disjoint and can be filled independently
+    const unsigned int tile_size = 64;
+    const unsigned int tiles_x = (grid.getSizeX() + tile_size - 1) / tile_size;
+    const unsigned int tiles_y = (grid.getSizeY() + tile_size - 1) / tile_size;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int t = 0; t < (int) (tiles_x * tiles_y); ++t) {
+      unsigned int x_min = min_key[0] + (t % tiles_x) * tile_size;
+      unsigned int y_min = min_key[1] + (t / tiles_x) * tile_size;
+      unsigned int x_max = std::min(x_min + tile_size - 1, (unsigned int) max_key[0]);
+      unsigned int y_max = std::min(y_min + tile_size - 1, (unsigned int) max_key[1]);
+      project2DRecurs(this->root, 0, 0, 0, 0, x_min, x_max, y_min, y_max, grid);
+    }
+    return true;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::updateProjection2D(OccupancyGrid2D& grid) const {
+    std::vector<unsigned int> cells;
+    {
+      std::vector<bool> touched (grid.occupancy.size(), false);
+      for (KeyBoolMap::const_iterator it = changed_keys.begin(); it != changed_keys.end(); ++it) {
+        const OcTreeKey& key = it->first;
+        if (key[0] < grid.min_key[0] || key[0] > grid.max_key[0]
+            || key[1] < grid.min_key[1] || key[1] > grid.max_key[1]
+            || key[2] < grid.min_key[2] || key[2] > grid.max_key[2])
+          continue;
+
+        size_t idx = grid.index(key[0] - grid.min_key[0], key[1] - grid.min_key[1]);
+        if (!touched[idx]) {
+          touched[idx] = true;
+          cells.push_back((unsigned int) idx);
+        }
+      }
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 64)
+#endif
+    for (int i = 0; i < (int) cells.size(); ++i) {
+      grid.resetCell(cells[i]);
+      if (this->root) {
+        unsigned int x = grid.min_key[0] + cells[i] % grid.getSizeX();
+        unsigned int y = grid.min_key[1] + cells[i] / grid.getSizeX();
+        project2DRecurs(this->root, 0, 0, 0, 0, x, x, y, y, grid);
+      }
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::project2DRecurs(const NODE* node, unsigned int depth,
+                                                  unsigned int x0, unsigned int y0, unsigned int z0,
+                                                  unsigned int x_min, unsigned int x_max,
+                                                  unsigned int y_min, unsigned int y_max,
+                                                  OccupancyGrid2D& grid) const {
+    const unsigned int size = 1u << (this->tree_depth - depth);
+    if (x0 > x_max || x0 + size - 1 < x_min || y0 > y_max || y0 + size - 1 < y_min
+        || z0 > grid.max_key[2] || z0 + size - 1 < grid.min_key[2])
+      return;
+
+    if (this->nodeHasChildren(node)) {
+      const unsigned int half = size / 2;
+      for (unsigned int i = 0; i < 8; ++i) {
+        if (this->nodeChildExists(node, i)) {
+          project2DRecurs(this->getNodeChild(node, i), depth + 1,
+                          x0 + ((i & 1) ? half : 0), y0 + ((i & 2) ? half : 0), z0 + ((i & 4) ? half : 0),
+                          x_min, x_max, y_min, y_max, grid);
+        }
+      }
+      return;
+    }
+
+    // leaf: fill the overlapping rectangle of the grid
+    const bool occupied = this->isNodeOccupied(node);
+    float z_bottom = 0.0f, z_top = 0.0f;
+    if (occupied) {
+      unsigned int z_lo = std::max(z0, (unsigned int) grid.min_key[2]);
+      unsigned int z_hi = std::min(z0 + size - 1, (unsigned int) grid.max_key[2]) + 1;
+      z_bottom = (float) ((double((int) z_lo - (int) this->tree_max_val)) * this->resolution);
+      z_top = (float) ((double((int) z_hi - (int) this->tree_max_val)) * this->resolution);
+    }
+
+    const unsigned int cx_min = std::max(x0, x_min) - grid.min_key[0];
+    const unsigned int cx_max = std::min(x0 + size - 1, x_max) - grid.min_key[0];
+    const unsigned int cy_min = std::max(y0, y_min) - grid.min_key[1];
+    const unsigned int cy_max = std::min(y0 + size - 1, y_max) - grid.min_key[1];
+    for (unsigned int y = cy_min; y <= cy_max; ++y) {
+      size_t idx = grid.index(cx_min, y);
+      for (unsigned int x = cx_min; x <= cx_max; ++x, ++idx) {
+        if (occupied) {
+          if (grid.occupancy[idx] != OccupancyGrid2D::OCCUPIED) {
+            grid.occupancy[idx] = OccupancyGrid2D::OCCUPIED;
+            grid.min_height[idx] = z_bottom;
+            grid.max_height[idx] = z_top;
+          } else {
+            grid.min_height[idx] = std::min(grid.min_height[idx], z_bottom);
+            grid.max_height[idx] = std::max(grid.max_height[idx], z_top);
+          }
+        } else if (grid.occupancy[idx] == OccupancyGrid2D::UNKNOWN) {
+          grid.occupancy[idx] = OccupancyGrid2D::FREE;
+        }
+      }
+    }
+  }
+
   template <class NODE>
   bool OccupancyOcTreeBase<NODE>::castRay(const point3d& origin, const point3d& directionP, point3d& end,
                                           bool ignoreUnknown, double maxRange) const {
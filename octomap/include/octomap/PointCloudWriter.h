@@ -0,0 +1,120 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_POINT_CLOUD_WRITER_H
+#define OCTOMAP_POINT_CLOUD_WRITER_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <cstring>
+#include <octomap/octomap_types.h>
+
+namespace octomap {
+
+  /**
+   * Collects many small writes (e.g. binary point records) in a fixed-size buffer
+   * and passes them to the stream in large blocks. The buffer is flushed on destruction.
+   */
+  class BufferedWriter {
+  public:
+    BufferedWriter(std::ostream& s, size_t buffer_size = 1 << 20);
+    ~BufferedWriter();
+
+    inline void write(const void* data, size_t size) {
+      if (used + size > buffer.size()) {
+        flush();
+        if (size > buffer.size()) {
+          stream.write((const char*) data, size);
+          return;
+        }
+      }
+      memcpy(&buffer[used], data, size);
+      used += size;
+    }
+
+    /// writes the buffered data to the stream, @return false on a stream error
+    bool flush();
+
+    std::ostream& getStream() { return stream; }
+
+  private:
+    BufferedWriter(const BufferedWriter&);
+    BufferedWriter& operator=(const BufferedWriter&);
+
+    std::ostream& stream;
+    std::vector<char> buffer;
+    size_t used;
+  };
+
+  /**
+   * Writes point clouds as binary PCD (v0.7) or PLY files through a BufferedWriter,
+   * so that points can be streamed without keeping the cloud in memory. The number of
+   * points has to be known when writing the header.
+   */
+  class PointCloudWriter {
+  public:
+    enum Format {PCD, PLY};
+
+    /// s has to be opened in binary mode
+    PointCloudWriter(std::ostream& s, Format format);
+
+    /// writes the header for num_points points
+    void writeHeader(size_t num_points);
+
+    inline void writePoint(const point3d& p) {
+      float xyz[3] = {p.x(), p.y(), p.z()};
+      out.write(xyz, sizeof(xyz));
+      ++num_written;
+    }
+
+    void writePoints(const point3d* points, size_t num_points);
+
+    /// flushes the buffer, @return false on a stream error or if the number of points does not match the header
+    bool finish();
+
+    size_t getNumPointsWritten() const { return num_written; }
+
+    /// determines the format from the file extension (".pcd" or ".ply"), @return false if unknown
+    static bool formatFromFilename(const std::string& filename, Format& format);
+
+  protected:
+    BufferedWriter out;
+    Format format;
+    size_t num_points;
+    size_t num_written;
+  };
+
+} // namespace
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_SCAN_EVALUATION_H
+#define OCTOMAP_SCAN_EVALUATION_H
+
+#include <cstddef>
+
+namespace octomap {
+
+  /**
+   * Accuracy of an occupancy map with respect to scans, computed by
+   * OccupancyOcTreeBase::evaluateScan(). The cells a scan observes as free
+   * (traversed by its rays) or occupied (containing an endpoint) are counted
+   * as correct, wrong or unknown depending on their state in the map.
+   */
+  class ScanEvaluation {
+  public:
+    ScanEvaluation() { clear(); }
+
+    void clear() {
+      num_scans = num_points = 0;
+      free_correct = free_wrong = free_unknown = 0;
+      occupied_correct = occupied_wrong = occupied_unknown = 0;
+    }
+
+    /// adds the counts of other
+    void add(const ScanEvaluation& other) {
+      num_scans += other.num_scans;
+      num_points += other.num_points;
+      free_correct += other.free_correct;
+      free_wrong += other.free_wrong;
+      free_unknown += other.free_unknown;
+      occupied_correct += other.occupied_correct;
+      occupied_wrong += other.occupied_wrong;
+      occupied_unknown += other.occupied_unknown;
+    }
+
+    size_t getNumCorrect() const { return free_correct + occupied_correct; }
+    size_t getNumWrong() const { return free_wrong + occupied_wrong; }
+    size_t getNumUnknown() const { return free_unknown + occupied_unknown; }
+
+    /// @return fraction of the known observed cells with the correct state (0 if none is known)
+    double getAccuracy() const {
+      size_t num_known = getNumCorrect() + getNumWrong();
+      return (num_known > 0) ? getNumCorrect() / double(num_known) : 0.0;
+    }
+
+    size_t num_scans;
+    size_t num_points;
+    size_t free_correct;     ///< observed free, free in the map
+    size_t free_wrong;       ///< observed free, occupied in the map
+    size_t free_unknown;     ///< observed free, unknown in the map
+    size_t occupied_correct; ///< observed occupied, occupied in the map
+    size_t occupied_wrong;   ///< observed occupied, free in the map
+    size_t occupied_unknown; ///< observed occupied, unknown in the map
+  };
+
+} // namespace
+
+#endif
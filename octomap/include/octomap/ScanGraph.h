@@ -36,10 +36,14 @@
 
 
 #include <string>
+#include <fstream>
 #include <math.h>
+#include <stdint.h>
 
 #include "Pointcloud.h"
 #include "octomap_types.h"
+#include "ScanLogReader.h"
+#include "PointCloudWriter.h"
 
 namespace octomap {
 
@@ -211,7 +215,8 @@ namespace octomap {
      *
      * Lines starting with the NODE keyword contain the 6D pose of a scan node,
      * all 3D point following until the next NODE keyword (or end of file) are
-     * inserted into that scan node as pointcloud in its local coordinate frame
+     * inserted into that scan node as pointcloud in its local coordinate frame.
+     * Consecutive nodes are connected by edges. Parsing is done by ScanLogReader.
      *
      * @param s input stream to read from
      * @return read stream
@@ -225,6 +230,43 @@ namespace octomap {
     std::vector<ScanEdge*> edges;
   };
 
+
+  /**
+   * Writes a binary graph file (as ScanGraph::writeBinary()) while the scans arrive, so
+   * that logs can be converted without keeping the graph in memory. Consecutive nodes
+   * are connected by edges as in ScanGraph::readPlainASCII(). Only the poses are kept
+   * until close(), the node and point counts are written into the file afterwards.
+   */
+  class ScanGraphWriter : public ScanLogReader::Handler {
+   public:
+    ScanGraphWriter(const std::string& filename);
+    virtual ~ScanGraphWriter();
+
+    bool isOpen() const { return file.is_open(); }
+
+    virtual void beginNode(const pose6d& pose);
+    virtual void addPoints(const point3d* points, size_t num_points);
+    virtual void endNode();
+
+    /// writes the edges and completes the file, @return false on write errors
+    bool close();
+
+    size_t getNumNodes() const { return poses.size(); }
+    size_t getNumPoints() const { return num_points; }
+
+   protected:
+    /// writes value at pos and returns to the end of the file
+    void writeAt(std::streampos pos, uint32_t value);
+
+    std::ofstream file;
+    BufferedWriter out;
+    std::vector<pose6d> poses;
+    std::streampos node_size_pos;
+    size_t node_points;
+    size_t num_points;
+    bool in_node;
+  };
+
 }
 
 
@@ -0,0 +1,107 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_SCAN_LOG_READER_H
+#define OCTOMAP_SCAN_LOG_READER_H
+
+#include <iostream>
+#include <vector>
+#include <octomap/octomap_types.h>
+
+namespace octomap {
+
+  /**
+   * Reads plain text scan logs as used by log2graph and ScanGraph::readPlainASCII():
+   * @code
+   * NODE x y z roll pitch yaw
+   * x y z
+   * ...
+   * @endcode
+   * Lines that are empty or start with '#' or ' ' are ignored.
+   *
+   * The log is read in large blocks which are split at line boundaries and parsed in
+   * parallel with OpenMP (with a hand-written number parser instead of stream extraction).
+   * Scans are passed to a Handler in the order of the log, so memory use does not depend
+   * on the size of the log.
+   */
+  class ScanLogReader {
+  public:
+    /// Receives the scans of a log, points of a scan may arrive in several calls to addPoints()
+    class Handler {
+    public:
+      virtual ~Handler() {}
+      virtual void beginNode(const pose6d& pose) = 0;
+      virtual void addPoints(const point3d* points, size_t num_points) = 0;
+      virtual void endNode() = 0;
+    };
+
+    ScanLogReader(size_t block_size = 1 << 24);
+
+    /**
+     * Parses the log from s and passes its scans to handler.
+     * @return false if a point occurs before the first NODE line (reading stops there)
+     */
+    bool read(std::istream& s, Handler& handler);
+
+    /**
+     * Parses a number as istream >> float would (optional whitespace, sign, digits,
+     * fraction, exponent), advancing p past it. @return false if there is no number at p.
+     */
+    static bool parseFloat(const char*& p, const char* end, float& value);
+
+  protected:
+    /// Scan start within the points of a chunk
+    struct NodeMark {
+      size_t point_idx;
+      pose6d pose;
+    };
+
+    /// Parsed content of a part of a block
+    struct Chunk {
+      std::vector<point3d> points;
+      std::vector<NodeMark> nodes;
+    };
+
+    /// parses the complete lines in [begin, end)
+    static void parseLines(const char* begin, const char* end, Chunk& chunk);
+
+    /// passes a parsed chunk to the handler, @return false on points outside of a scan
+    bool dispatch(const Chunk& chunk, Handler& handler);
+
+    size_t block_size;
+    bool in_node;
+  };
+
+} // namespace
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_SCAN_REINTEGRATOR_H
+#define OCTOMAP_SCAN_REINTEGRATOR_H
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include <octomap/OccupancyOcTreeBase.h>
+#include <octomap/ScanGraph.h>
+
+namespace octomap {
+
+  /**
+   * Keeps an occupancy map consistent with the poses of a ScanGraph, e.g.
+   * after loop closures corrected them. The cells every scan observed as free
+   * or occupied are recorded (as Morton codes, see computeMortonCode()) together
+   * with the number of hits and misses each cell received from all scans.
+   * When poses change, update() removes the old contributions of the affected
+   * scans and adds the new ones, so the map is corrected in time proportional
+   * to the number of changed scans instead of being rebuilt from scratch.
+   *
+   * The log-odds of a cell are the sum of its hits and misses clamped
+   * to the tree's thresholds, so they equal those of insertPointCloud()
+   * (without discretization) as long as clamping never took effect there.
+   * Cells no scan observes anymore are deleted from the tree.
+   * The tree should not be changed by other means while it is managed here.
+   */
+  template <class NODE>
+  class ScanReintegrator {
+  public:
+    /// manages the map tree, rays of the scans are truncated at maxrange (< 0: no limit)
+    ScanReintegrator(OccupancyOcTreeBase<NODE>& tree, double maxrange = -1.0);
+
+    /**
+     * Integrates the scan (in its sensor frame) taken at pose, replacing an
+     * earlier scan with the same id.
+     */
+    void insertScan(unsigned int id, const Pointcloud& scan, const pose6d& pose);
+
+    /// removes the contribution of the scan with id, @return false if there is none
+    bool removeScan(unsigned int id);
+
+    /**
+     * Makes the map consistent with graph: scans of new nodes are inserted,
+     * scans whose pose moved by more than translation_eps (meters) or
+     * rotation_eps (radians) are re-integrated and scans not in the graph
+     * anymore are removed. The contributions are computed in parallel.
+     *
+     * @return number of scans inserted, re-integrated or removed
+     */
+    size_t update(const ScanGraph& graph, double translation_eps = 1e-4, double rotation_eps = 1e-4);
+
+    /// number of integrated scans
+    size_t getNumScans() const { return scans.size(); }
+
+    /// number of cells observed by at least one scan
+    size_t getNumObservedCells() const { return observations.size(); }
+
+    /// approximate memory usage of the recorded contributions in bytes (without the tree)
+    size_t memoryUsage() const;
+
+  protected:
+    /// cells a scan observed
+    struct Contribution {
+      pose6d pose;
+      std::vector<uint64_t> free_codes;
+      std::vector<uint64_t> occupied_codes;
+    };
+
+    /// number of scans that observed a cell as occupied (hits) or free (misses)
+    struct CellObservation {
+      CellObservation() : hits(0), misses(0) {}
+      unsigned int hits;
+      unsigned int misses;
+    };
+
+    /// change of a CellObservation
+    struct CellDelta {
+      CellDelta(uint64_t code, int hits, int misses) : code(code), hits(hits), misses(misses) {}
+      bool operator<(const CellDelta& other) const { return code < other.code; }
+      uint64_t code;
+      int hits;
+      int misses;
+    };
+
+    typedef std::map<unsigned int, Contribution> ContributionMap;
+    typedef unordered_ns::unordered_map<uint64_t, CellObservation> ObservationMap;
+
+    /// computes the cells scan (in its sensor frame) observes from pose
+    void computeContribution(const Pointcloud& scan, const pose6d& pose, Contribution& contribution) const;
+
+    /// @return true if the poses differ by more than the given thresholds
+    static bool poseChanged(const pose6d& a, const pose6d& b, double translation_eps, double rotation_eps);
+
+    /// appends the cell changes of contribution with sign (+1 to add, -1 to remove it)
+    static void appendDeltas(const Contribution& contribution, int sign, std::vector<CellDelta>& deltas);
+
+    /// applies the cell changes to the observations and the tree (in Morton order)
+    void applyDeltas(std::vector<CellDelta>& deltas);
+
+    OccupancyOcTreeBase<NODE>& tree;
+    double maxrange;
+    ContributionMap scans;
+    ObservationMap observations;
+  };
+
+} // namespace
+
+#include "octomap/ScanReintegrator.hxx"
+
+#endif
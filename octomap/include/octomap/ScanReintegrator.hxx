@@ -0,0 +1,216 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <set>
+
+namespace octomap {
+
+  template <class NODE>
+  ScanReintegrator<NODE>::ScanReintegrator(OccupancyOcTreeBase<NODE>& tree, double maxrange)
+    : tree(tree), maxrange(maxrange)
+  {
+
+  }
+
+  template <class NODE>
+  void ScanReintegrator<NODE>::insertScan(unsigned int id, const Pointcloud& scan, const pose6d& pose) {
+    Contribution contribution;
+    computeContribution(scan, pose, contribution);
+
+    std::vector<CellDelta> deltas;
+    typename ContributionMap::iterator it = scans.find(id);
+    if (it != scans.end())
+      appendDeltas(it->second, -1, deltas);
+    appendDeltas(contribution, 1, deltas);
+    applyDeltas(deltas);
+
+    scans[id] = contribution;
+  }
+
+  template <class NODE>
+  bool ScanReintegrator<NODE>::removeScan(unsigned int id) {
+    typename ContributionMap::iterator it = scans.find(id);
+    if (it == scans.end())
+      return false;
+
+    std::vector<CellDelta> deltas;
+    appendDeltas(it->second, -1, deltas);
+    applyDeltas(deltas);
+    scans.erase(it);
+    return true;
+  }
+
+  template <class NODE>
+  size_t ScanReintegrator<NODE>::update(const ScanGraph& graph, double translation_eps, double rotation_eps) {
+    // scans to (re-)integrate
+    std::vector<const ScanNode*> changed;
+    std::set<unsigned int> graph_ids;
+    for (ScanGraph::const_iterator it = graph.begin(); it != graph.end(); ++it) {
+      const ScanNode* node = *it;
+      if (!node->scan)
+        continue;
+      graph_ids.insert(node->id);
+      typename ContributionMap::const_iterator scan_it = scans.find(node->id);
+      if (scan_it == scans.end() || poseChanged(scan_it->second.pose, node->pose, translation_eps, rotation_eps))
+        changed.push_back(node);
+    }
+
+    std::vector<Contribution> contributions(changed.size());
+    int num_changed = (int) changed.size();
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) if (num_changed > 1)
+#endif
+    for (int i = 0; i < num_changed; ++i)
+      computeContribution(*changed[i]->scan, changed[i]->pose, contributions[i]);
+
+    std::vector<CellDelta> deltas;
+    size_t num_removed = 0;
+    for (typename ContributionMap::iterator it = scans.begin(); it != scans.end(); ) {
+      if (graph_ids.find(it->first) == graph_ids.end()) {
+        appendDeltas(it->second, -1, deltas);
+        scans.erase(it++);
+        ++num_removed;
+      } else
+        ++it;
+    }
+    for (size_t i = 0; i < changed.size(); ++i) {
+      typename ContributionMap::iterator it = scans.find(changed[i]->id);
+      if (it != scans.end())
+        appendDeltas(it->second, -1, deltas);
+      appendDeltas(contributions[i], 1, deltas);
+    }
+    applyDeltas(deltas);
+
+    for (size_t i = 0; i < changed.size(); ++i) {
+      Contribution& contribution = scans[changed[i]->id];
+      contribution.pose = contributions[i].pose;
+      contribution.free_codes.swap(contributions[i].free_codes);
+      contribution.occupied_codes.swap(contributions[i].occupied_codes);
+    }
+
+    return changed.size() + num_removed;
+  }
+
+  template <class NODE>
+  size_t ScanReintegrator<NODE>::memoryUsage() const {
+    size_t num_codes = 0;
+    for (typename ContributionMap::const_iterator it = scans.begin(); it != scans.end(); ++it)
+      num_codes += it->second.free_codes.capacity() + it->second.occupied_codes.capacity();
+
+    return sizeof(ScanReintegrator<NODE>)
+      + scans.size() * (sizeof(Contribution) + sizeof(unsigned int) + 4 * sizeof(void*))
+      + num_codes * sizeof(uint64_t)
+      + observations.size() * (sizeof(uint64_t) + sizeof(CellObservation) + 2 * sizeof(void*))
+      + observations.bucket_count() * sizeof(void*);
+  }
+
+  template <class NODE>
+  void ScanReintegrator<NODE>::computeContribution(const Pointcloud& scan, const pose6d& pose,
+                                                   Contribution& contribution) const {
+    Pointcloud transformed_scan(scan);
+    transformed_scan.transform(pose);
+
+    contribution.pose = pose;
+    contribution.free_codes.clear();
+    contribution.occupied_codes.clear();
+    tree.computeUpdateCodes(transformed_scan, pose.trans(), maxrange,
+                            contribution.free_codes, contribution.occupied_codes);
+
+    // drop the spare capacity, the codes are kept for the lifetime of the scan
+    std::vector<uint64_t>(contribution.free_codes).swap(contribution.free_codes);
+    std::vector<uint64_t>(contribution.occupied_codes).swap(contribution.occupied_codes);
+  }
+
+  template <class NODE>
+  bool ScanReintegrator<NODE>::poseChanged(const pose6d& a, const pose6d& b,
+                                           double translation_eps, double rotation_eps) {
+    if ((a.trans() - b.trans()).norm() > translation_eps)
+      return true;
+
+    // angle of the relative rotation (atan2 stays accurate for small angles, unlike acos)
+    octomath::Quaternion relative = a.rot().inv() * b.rot();
+    double sin_half = sqrt(relative.x() * relative.x() + relative.y() * relative.y()
+                           + relative.z() * relative.z());
+    double angle = 2.0 * atan2(sin_half, fabs(relative.u()));
+    return angle > rotation_eps;
+  }
+
+  template <class NODE>
+  void ScanReintegrator<NODE>::appendDeltas(const Contribution& contribution, int sign,
+                                            std::vector<CellDelta>& deltas) {
+    deltas.reserve(deltas.size() + contribution.free_codes.size() + contribution.occupied_codes.size());
+    for (size_t i = 0; i < contribution.free_codes.size(); ++i)
+      deltas.push_back(CellDelta(contribution.free_codes[i], 0, sign));
+    for (size_t i = 0; i < contribution.occupied_codes.size(); ++i)
+      deltas.push_back(CellDelta(contribution.occupied_codes[i], sign, 0));
+  }
+
+  template <class NODE>
+  void ScanReintegrator<NODE>::applyDeltas(std::vector<CellDelta>& deltas) {
+    // Morton order merges the changes of each cell and keeps the tree accesses local
+    std::sort(deltas.begin(), deltas.end());
+
+    const float prob_hit_log = tree.getProbHitLog();
+    const float prob_miss_log = tree.getProbMissLog();
+
+    size_t i = 0;
+    while (i < deltas.size()) {
+      const uint64_t code = deltas[i].code;
+      int hits = 0;
+      int misses = 0;
+      for (; i < deltas.size() && deltas[i].code == code; ++i) {
+        hits += deltas[i].hits;
+        misses += deltas[i].misses;
+      }
+      if (hits == 0 && misses == 0)
+        continue;
+
+      CellObservation& observation = observations[code];
+      assert(int(observation.hits) + hits >= 0 && int(observation.misses) + misses >= 0);
+      observation.hits += hits;
+      observation.misses += misses;
+
+      const OcTreeKey key = mortonCodeToKey(code);
+      if (observation.hits == 0 && observation.misses == 0) {
+        observations.erase(code);
+        tree.deleteNode(key);
+      } else {
+        tree.setNodeValue(key, observation.hits * prob_hit_log + observation.misses * prob_miss_log);
+      }
+    }
+  }
+
+} // namespace
@@ -0,0 +1,134 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_SENSOR_MODEL_H
+#define OCTOMAP_SENSOR_MODEL_H
+
+#include <vector>
+#include <algorithm>
+#include <octomap/octomap_types.h>
+
+namespace octomap {
+
+  /**
+   * Simple range sensor model given by its field of view, angular resolution
+   * and maximum range, e.g. for evaluating candidate views in exploration.
+   * The sensor looks along its local x-axis, with y pointing left and z up.
+   */
+  class FovSensorModel {
+  public:
+    /**
+     * @param horizontal_fov horizontal opening angle (radians)
+     * @param vertical_fov vertical opening angle (radians)
+     * @param angular_resolution angle between neighboring rays (radians)
+     * @param max_range maximum sensing range (meters)
+     */
+    FovSensorModel(double horizontal_fov, double vertical_fov,
+                   double angular_resolution, double max_range);
+
+    double getHorizontalFov() const { return horizontal_fov; }
+    double getVerticalFov() const { return vertical_fov; }
+    double getAngularResolution() const { return angular_resolution; }
+    double getMaxRange() const { return max_range; }
+
+    /// @return number of rays cast by the sensor
+    size_t getNumRays() const { return ray_directions.size(); }
+
+    /// unit direction vectors of all rays in the sensor frame
+    const std::vector<point3d>& getRayDirections() const { return ray_directions; }
+
+  protected:
+    void computeRayDirections();
+
+    double horizontal_fov;
+    double vertical_fov;
+    double angular_resolution;
+    double max_range;
+    std::vector<point3d> ray_directions;
+  };
+
+  /**
+   * Inverse sensor model with constant log-odds updates for hits and misses, which
+   * are the updates of OccupancyOcTreeBase::insertPointCloud(). Sensor models for
+   * OccupancyOcTreeBase::insertPointCloudWithModel() are functors like this one.
+   */
+  class ConstantSensorModel {
+  public:
+    ConstantSensorModel(float hit_log_odds, float miss_log_odds)
+      : hit_log_odds(hit_log_odds), miss_log_odds(miss_log_odds) {}
+
+    /**
+     * @param beam index of the ray's point in the scan
+     * @param distance distance of the cell from the sensor along the ray
+     * @param range measured range of the ray
+     * @param hit true for the cell of the endpoint, false for cells traversed by the ray
+     * @return log-odds update of the cell
+     */
+    float operator()(size_t /* beam */, float /* distance */, float /* range */, bool hit) const {
+      return hit ? hit_log_odds : miss_log_odds;
+    }
+
+  protected:
+    float hit_log_odds;
+    float miss_log_odds;
+  };
+
+  /**
+   * Inverse sensor model whose updates get weaker with the distance from the sensor,
+   * e.g. for sensors with range-dependent noise. The updates are interpolated
+   * linearly between their values at the sensor and at max_range (and constant beyond).
+   */
+  class RangeSensorModel {
+  public:
+    RangeSensorModel(float hit_log_odds_near, float hit_log_odds_far,
+                     float miss_log_odds_near, float miss_log_odds_far, float max_range)
+      : hit_near(hit_log_odds_near), hit_far(hit_log_odds_far),
+        miss_near(miss_log_odds_near), miss_far(miss_log_odds_far), max_range(max_range) {}
+
+    /// see ConstantSensorModel::operator()
+    float operator()(size_t /* beam */, float distance, float /* range */, bool hit) const {
+      float t = (max_range > 0.0f) ? std::min(std::max(distance / max_range, 0.0f), 1.0f) : 0.0f;
+      return hit ? hit_near + t * (hit_far - hit_near) : miss_near + t * (miss_far - miss_near);
+    }
+
+  protected:
+    float hit_near;
+    float hit_far;
+    float miss_near;
+    float miss_far;
+    float max_range;
+  };
+
+} // namespace
+
+#endif
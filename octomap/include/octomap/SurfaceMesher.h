@@ -0,0 +1,137 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_SURFACE_MESHER_H
+#define OCTOMAP_SURFACE_MESHER_H
+
+#include <vector>
+#include <octomap/OcTreeKey.h>
+#include <octomap/IndexedMesh.h>
+
+namespace octomap {
+
+  /**
+   * Extracts the surface of the occupied volume of an occupancy octree with
+   * marching cubes (using the tables in MCTables.h, see also
+   * OccupancyOcTreeBase::getNormals()). The cubes of the algorithm connect the
+   * centers of neighboring voxels at the finest resolution.
+   *
+   * The volume is split into cubic blocks which are meshed in parallel (with
+   * OpenMP enabled) and cached. After the tree changed, update() re-meshes only
+   * the blocks touched by the tree's changed keys (see
+   * OccupancyOcTreeBase::enableChangeDetection()) or by markChanged().
+   *
+   * Example:
+   * \code
+   * tree.enableChangeDetection(true);
+   * SurfaceMesher<OcTree> mesher(tree);
+   * mesher.update();
+   * // ... insert scans into tree ...
+   * mesher.update();
+   * tree.resetChangeDetection();
+   * mesher.getMesh().writeObj("surface.obj");
+   * \endcode
+   */
+  template <class TREETYPE>
+  class SurfaceMesher {
+  public:
+    /**
+     * @param tree occupancy tree to mesh, has to outlive the mesher
+     * @param block_size edge length of the cached blocks in voxels (power of 2)
+     * @param unknown_status consider unknown cells as occupied (true) or free (default, false)
+     * @param interpolate place vertices by interpolating the occupancy probabilities
+     *   of the voxels at the isolevel of the occupancy threshold instead of at edge midpoints
+     */
+    SurfaceMesher(const TREETYPE& tree, unsigned int block_size = 16,
+                  bool unknown_status = false, bool interpolate = false);
+
+    /**
+     * Meshes all blocks on the first call. Afterwards, only re-meshes the blocks
+     * touched by changed keys of the tree (if change detection is enabled) and
+     * by markChanged(). Call it before resetting the tree's change detection.
+     * Note that the change detection only tracks changes of the occupancy state,
+     * with interpolation use markChanged() for changed probabilities.
+     */
+    void update();
+
+    /// discards all cached blocks and meshes the whole tree again
+    void rebuild();
+
+    /// marks the blocks around the voxel at key for re-meshing in the next update()
+    void markChanged(const OcTreeKey& key);
+
+    /// @return the mesh of all blocks, vertices on block borders are shared
+    const IndexedMesh& getMesh();
+
+    /// @return number of blocks with a non-empty cached mesh
+    size_t getNumBlocks() const { return blocks.size(); }
+
+    unsigned int getBlockSize() const { return 1u << block_size_log2; }
+    bool getUnknownStatus() const { return unknown_status; }
+    bool getInterpolate() const { return interpolate; }
+
+  protected:
+    /// cached mesh of a block, vertex ids identify the lattice edges of the vertices
+    struct BlockMesh {
+      std::vector<point3d> vertices;
+      std::vector<uint64_t> vertex_ids;
+      std::vector<unsigned int> indices;
+    };
+    typedef unordered_ns::unordered_map<OcTreeKey, BlockMesh, OcTreeKey::KeyHash> BlockMap;
+
+    /// collects all blocks which may contain surface cubes
+    void collectBlocks(KeySet& block_keys) const;
+    /// adds the blocks containing cubes which touch the voxels [min, max] (not interior ones)
+    void addLeafBlocks(const OcTreeKey& min, const OcTreeKey& max, KeySet& block_keys) const;
+    /// runs marching cubes on all cubes of a block
+    void meshBlock(const OcTreeKey& block_key, BlockMesh& mesh) const;
+    /// re-meshes all blocks in dirty_blocks
+    void meshDirtyBlocks();
+
+    const TREETYPE& tree;
+    unsigned int block_size_log2;
+    bool unknown_status;
+    bool interpolate;
+
+    bool initialized;
+    BlockMap blocks;
+    KeySet dirty_blocks;
+    IndexedMesh mesh;
+    bool mesh_valid;
+  };
+
+} // namespace
+
+#include "octomap/SurfaceMesher.hxx"
+
+#endif
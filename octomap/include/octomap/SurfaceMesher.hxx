@@ -0,0 +1,304 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <octomap/MCTables.h>
+
+namespace octomap {
+
+  template <class TREETYPE>
+  SurfaceMesher<TREETYPE>::SurfaceMesher(const TREETYPE& tree, unsigned int block_size,
+                                         bool unknown_status, bool interpolate)
+    : tree(tree), block_size_log2(0), unknown_status(unknown_status), interpolate(interpolate),
+      initialized(false), mesh_valid(false)
+  {
+    while (block_size_log2 < 15 && (2u << block_size_log2) <= block_size)
+      ++block_size_log2;
+    if ((1u << block_size_log2) != block_size) {
+      OCTOMAP_WARNING("Block size %u is not a power of 2, using %u\n", block_size, 1u << block_size_log2);
+    }
+  }
+
+  template <class TREETYPE>
+  void SurfaceMesher<TREETYPE>::update() {
+    if (!initialized) {
+      rebuild();
+      return;
+    }
+    if (tree.isChangeDetectionEnabled()) {
+      for (KeyBoolMap::const_iterator it = tree.changedKeysBegin(); it != tree.changedKeysEnd(); ++it)
+        markChanged(it->first);
+    }
+    if (!dirty_blocks.empty())
+      meshDirtyBlocks();
+  }
+
+  template <class TREETYPE>
+  void SurfaceMesher<TREETYPE>::rebuild() {
+    blocks.clear();
+    dirty_blocks.clear();
+    collectBlocks(dirty_blocks);
+    initialized = true;
+    meshDirtyBlocks();
+  }
+
+  template <class TREETYPE>
+  void SurfaceMesher<TREETYPE>::markChanged(const OcTreeKey& key) {
+    // the voxel is a corner of the cubes starting at key-1 and key
+    OcTreeKey block_key;
+    for (int dz = -1; dz <= 0; ++dz) {
+      for (int dy = -1; dy <= 0; ++dy) {
+        for (int dx = -1; dx <= 0; ++dx) {
+          int cube[3] = {(int) key[0] + dx, (int) key[1] + dy, (int) key[2] + dz};
+          if (cube[0] < 0 || cube[1] < 0 || cube[2] < 0)
+            continue;
+          for (unsigned int i = 0; i < 3; ++i)
+            block_key[i] = (key_type) (cube[i] >> block_size_log2);
+          dirty_blocks.insert(block_key);
+        }
+      }
+    }
+  }
+
+  template <class TREETYPE>
+  const IndexedMesh& SurfaceMesher<TREETYPE>::getMesh() {
+    if (mesh_valid)
+      return mesh;
+
+    // merge the block meshes, sharing vertices which lie on the same lattice edge
+    mesh.clear();
+    unordered_ns::unordered_map<uint64_t, unsigned int> vertex_index;
+    std::vector<unsigned int> remap;
+    for (typename BlockMap::const_iterator it = blocks.begin(); it != blocks.end(); ++it) {
+      const BlockMesh& block = it->second;
+      remap.resize(block.vertices.size());
+      for (size_t i = 0; i < block.vertices.size(); ++i) {
+        std::pair<typename unordered_ns::unordered_map<uint64_t, unsigned int>::iterator, bool> inserted
+          = vertex_index.insert(std::make_pair(block.vertex_ids[i], (unsigned int) mesh.vertices.size()));
+        if (inserted.second)
+          mesh.vertices.push_back(block.vertices[i]);
+        remap[i] = inserted.first->second;
+      }
+      for (size_t i = 0; i < block.indices.size(); ++i)
+        mesh.indices.push_back(remap[block.indices[i]]);
+    }
+    mesh_valid = true;
+    return mesh;
+  }
+
+  template <class TREETYPE>
+  void SurfaceMesher<TREETYPE>::collectBlocks(KeySet& block_keys) const {
+    const unsigned int tree_depth = tree.getTreeDepth();
+    // every surface cube has a corner on the minority side: occupied voxels if
+    // unknown space counts as free, free voxels otherwise
+    for (typename TREETYPE::leaf_iterator it = tree.begin_leafs(), end = tree.end_leafs(); it != end; ++it) {
+      if (tree.isNodeOccupied(*it) == unknown_status)
+        continue;
+      OcTreeKey min = it.getIndexKey();
+      key_type leaf_size = (key_type) ((1u << (tree_depth - it.getDepth())) - 1);
+      OcTreeKey max(min[0] + leaf_size, min[1] + leaf_size, min[2] + leaf_size);
+      addLeafBlocks(min, max, block_keys);
+    }
+  }
+
+  template <class TREETYPE>
+  void SurfaceMesher<TREETYPE>::addLeafBlocks(const OcTreeKey& min, const OcTreeKey& max,
+                                              KeySet& block_keys) const {
+    const int block_size = 1 << block_size_log2;
+    int lo[3], hi[3], inner_lo[3], inner_hi[3];
+    for (unsigned int i = 0; i < 3; ++i) {
+      // cubes starting at min-1 ... max touch the leaf
+      lo[i] = std::max((int) min[i] - 1, 0) >> block_size_log2;
+      hi[i] = std::min((int) max[i], 65534) >> block_size_log2;
+      // blocks with all cubes inside the leaf (all corners equal) contain no surface
+      inner_lo[i] = ((int) min[i] + block_size - 1) >> block_size_log2;
+      inner_hi[i] = ((int) max[i] >> block_size_log2) - 1;
+    }
+
+    for (int bx = lo[0]; bx <= hi[0]; ++bx) {
+      for (int by = lo[1]; by <= hi[1]; ++by) {
+        bool inner_xy = (bx >= inner_lo[0] && bx <= inner_hi[0] && by >= inner_lo[1] && by <= inner_hi[1]);
+        for (int bz = lo[2]; bz <= hi[2]; ++bz) {
+          if (inner_xy && bz >= inner_lo[2] && bz <= inner_hi[2]) {
+            bz = inner_hi[2]; // skip to the opposite face of the leaf
+            continue;
+          }
+          block_keys.insert(OcTreeKey((key_type) bx, (key_type) by, (key_type) bz));
+        }
+      }
+    }
+  }
+
+  template <class TREETYPE>
+  void SurfaceMesher<TREETYPE>::meshDirtyBlocks() {
+    std::vector<OcTreeKey> block_keys(dirty_blocks.begin(), dirty_blocks.end());
+    std::vector<BlockMesh> results(block_keys.size());
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < (int) block_keys.size(); ++i) {
+      meshBlock(block_keys[i], results[i]);
+    }
+
+    for (size_t i = 0; i < block_keys.size(); ++i) {
+      if (results[i].indices.empty()) {
+        blocks.erase(block_keys[i]);
+      } else {
+        BlockMesh& block = blocks[block_keys[i]];
+        block.vertices.swap(results[i].vertices);
+        block.vertex_ids.swap(results[i].vertex_ids);
+        block.indices.swap(results[i].indices);
+      }
+    }
+    dirty_blocks.clear();
+    mesh_valid = false;
+  }
+
+  template <class TREETYPE>
+  void SurfaceMesher<TREETYPE>::meshBlock(const OcTreeKey& block_key, BlockMesh& result) const {
+    // cube corners (voxel offsets) and edges in the order of the MCTables,
+    // matching OccupancyOcTreeBase::getNormals()
+    static const int corners[8][3] = {{1,1,0}, {1,0,0}, {0,0,0}, {0,1,0},
+                                      {1,1,1}, {1,0,1}, {0,0,1}, {0,1,1}};
+    static const int edges[12][2] = {{0,1}, {1,2}, {2,3}, {3,0}, {4,5}, {5,6},
+                                     {6,7}, {7,4}, {0,4}, {1,5}, {2,6}, {3,7}};
+
+    const unsigned int block_size = 1u << block_size_log2;
+    const unsigned int n = block_size + 1; // voxels per side, including the next block's first layer
+    const unsigned int tree_depth = tree.getTreeDepth();
+    const double resolution = tree.getResolution();
+    const float iso = (float) tree.getOccupancyThres();
+
+    OcTreeKey min_key, max_key;
+    unsigned int num_cubes[3];
+    for (unsigned int i = 0; i < 3; ++i) {
+      unsigned int min_val = (unsigned int) block_key[i] << block_size_log2;
+      unsigned int max_val = std::min(min_val + block_size, 65535u);
+      min_key[i] = (key_type) min_val;
+      max_key[i] = (key_type) max_val;
+      num_cubes[i] = max_val - min_val;
+    }
+
+    // sample the occupancy of all voxels of the block
+    std::vector<char> inside(n * n * n, (char) unknown_status);
+    std::vector<float> values;
+    if (interpolate)
+      values.assign(n * n * n, unknown_status ? 1.0f : 0.0f);
+    for (typename TREETYPE::leaf_bbx_iterator it = tree.begin_leafs_bbx(min_key, max_key),
+           end = tree.end_leafs_bbx(); it != end; ++it) {
+      OcTreeKey leaf_min = it.getIndexKey();
+      unsigned int leaf_size = 1u << (tree_depth - it.getDepth());
+      unsigned int lo[3], hi[3];
+      bool overlaps = true;
+      for (unsigned int i = 0; i < 3; ++i) {
+        unsigned int leaf_max = (unsigned int) leaf_min[i] + leaf_size - 1;
+        if (leaf_max < min_key[i] || leaf_min[i] > max_key[i])
+          overlaps = false;
+        lo[i] = std::max((unsigned int) leaf_min[i], (unsigned int) min_key[i]) - min_key[i];
+        hi[i] = std::min(leaf_max, (unsigned int) max_key[i]) - min_key[i];
+      }
+      if (!overlaps)
+        continue;
+      char occupied = (char) tree.isNodeOccupied(*it);
+      float value = (float) it->getOccupancy();
+      for (unsigned int z = lo[2]; z <= hi[2]; ++z) {
+        for (unsigned int y = lo[1]; y <= hi[1]; ++y) {
+          for (unsigned int x = lo[0]; x <= hi[0]; ++x) {
+            unsigned int idx = (z * n + y) * n + x;
+            inside[idx] = occupied;
+            if (interpolate)
+              values[idx] = value;
+          }
+        }
+      }
+    }
+
+    // vertex index per lattice edge (lower voxel, axis) of the block
+    std::vector<int> edge_vertex(3 * n * n * n, -1);
+    for (unsigned int z = 0; z < num_cubes[2]; ++z) {
+      for (unsigned int y = 0; y < num_cubes[1]; ++y) {
+        for (unsigned int x = 0; x < num_cubes[0]; ++x) {
+          unsigned int corner_idx[8];
+          int cube_index = 0;
+          for (unsigned int c = 0; c < 8; ++c) {
+            corner_idx[c] = ((z + corners[c][2]) * n + (y + corners[c][1])) * n + (x + corners[c][0]);
+            if (inside[corner_idx[c]])
+              cube_index |= (1 << c);
+          }
+          if (edgeTable[cube_index] == 0)
+            continue;
+
+          int cube_vertices[12];
+          for (unsigned int e = 0; e < 12; ++e) {
+            if (!(edgeTable[cube_index] & (1 << e)))
+              continue;
+            int a = edges[e][0];
+            int b = edges[e][1];
+            unsigned int axis = 0;
+            while (corners[a][axis] == corners[b][axis])
+              ++axis;
+            if (corners[a][axis] > corners[b][axis])
+              std::swap(a, b);
+
+            unsigned int slot = corner_idx[a] * 3 + axis;
+            if (edge_vertex[slot] < 0) {
+              OcTreeKey key((key_type) (min_key[0] + x + corners[a][0]),
+                            (key_type) (min_key[1] + y + corners[a][1]),
+                            (key_type) (min_key[2] + z + corners[a][2]));
+              float t = 0.5f;
+              if (interpolate) {
+                float va = values[corner_idx[a]];
+                float vb = values[corner_idx[b]];
+                if (vb != va)
+                  t = std::max(0.0f, std::min(1.0f, (iso - va) / (vb - va)));
+              }
+              point3d vertex = tree.keyToCoord(key);
+              vertex(axis) += (float) (t * resolution);
+
+              edge_vertex[slot] = (int) result.vertices.size();
+              result.vertices.push_back(vertex);
+              result.vertex_ids.push_back((uint64_t) key[0] | ((uint64_t) key[1] << 16)
+                                          | ((uint64_t) key[2] << 32) | ((uint64_t) axis << 48));
+            }
+            cube_vertices[e] = edge_vertex[slot];
+          }
+
+          for (int i = 0; triTable[cube_index][i] != -1; ++i)
+            result.indices.push_back((unsigned int) cube_vertices[triTable[cube_index][i]]);
+        }
+      }
+    }
+  }
+
+} // namespace
@@ -31,6 +31,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <octomap/ColorOcTree.h>
 
 namespace octomap {
@@ -96,15 +97,28 @@ namespace octomap {
   ColorOcTreeNode* ColorOcTree::setNodeColor(const OcTreeKey& key,
                                              uint8_t r,
                                              uint8_t g,
-                                             uint8_t b) {
+                                             uint8_t b,
+                                             bool lazy_eval) {
     ColorOcTreeNode* n = search (key);
     if (n != 0) {
+      if (lazy_eval)
+        dirty_keys.insert(key);
       n->setColor(r, g, b);
     }
     return n;
   }
 
   bool ColorOcTree::pruneNode(ColorOcTreeNode* node) {
+    size_t num_deleted = 0;
+    if (!pruneNode(node, num_deleted))
+      return false;
+
+    tree_size -= num_deleted;
+    size_changed = true;
+    return true;
+  }
+
+  bool ColorOcTree::pruneNode(ColorOcTreeNode* node, size_t& num_deleted) {
     if (!isNodeCollapsible(node))
       return false;
 
@@ -115,15 +129,23 @@ namespace octomap {
       node->setColor(node->getAverageChildColor());
 
     // delete children
-    for (unsigned int i=0;i<8;i++) {
-      deleteNodeChild(node, i);
-    }
-    delete[] node->children;
-    node->children = NULL;
+    deleteNodeDescendants(node, num_deleted);
 
     return true;
   }
 
+  ColorOcTreeNode* ColorOcTree::updateNode(const OcTreeKey& key, float log_odds_update, bool lazy_eval) {
+    if (lazy_eval)
+      dirty_keys.insert(key);
+    return OccupancyOcTreeBase<ColorOcTreeNode>::updateNode(key, log_odds_update, lazy_eval);
+  }
+
+  ColorOcTreeNode* ColorOcTree::setNodeValue(const OcTreeKey& key, float log_odds_value, bool lazy_eval) {
+    if (lazy_eval)
+      dirty_keys.insert(key);
+    return OccupancyOcTreeBase<ColorOcTreeNode>::setNodeValue(key, log_odds_value, lazy_eval);
+  }
+
   bool ColorOcTree::isNodeCollapsible(const ColorOcTreeNode* node) const{
     // all children must exist, must not have children of
     // their own and have the same occupancy probability
@@ -146,9 +168,12 @@ namespace octomap {
   ColorOcTreeNode* ColorOcTree::averageNodeColor(const OcTreeKey& key,
                                                  uint8_t r,
                                                  uint8_t g,
-                                                 uint8_t b) {
+                                                 uint8_t b,
+                                                 bool lazy_eval) {
     ColorOcTreeNode* n = search(key);
     if (n != 0) {
+      if (lazy_eval)
+        dirty_keys.insert(key);
       if (n->isColorSet()) {
         ColorOcTreeNode::Color prev_color = n->getColor();
         n->setColor((prev_color.r + r)/2, (prev_color.g + g)/2, (prev_color.b + b)/2);
@@ -163,30 +188,207 @@ namespace octomap {
   ColorOcTreeNode* ColorOcTree::integrateNodeColor(const OcTreeKey& key,
                                                    uint8_t r,
                                                    uint8_t g,
-                                                   uint8_t b) {
+                                                   uint8_t b,
+                                                   bool lazy_eval) {
     ColorOcTreeNode* n = search (key);
     if (n != 0) {
-      if (n->isColorSet()) {
-        ColorOcTreeNode::Color prev_color = n->getColor();
-        double node_prob = n->getOccupancy();
-        uint8_t new_r = (uint8_t) ((double) prev_color.r * node_prob
-                                               +  (double) r * (0.99-node_prob));
-        uint8_t new_g = (uint8_t) ((double) prev_color.g * node_prob
-                                               +  (double) g * (0.99-node_prob));
-        uint8_t new_b = (uint8_t) ((double) prev_color.b * node_prob
-                                               +  (double) b * (0.99-node_prob));
-        n->setColor(new_r, new_g, new_b);
+      if (lazy_eval)
+        dirty_keys.insert(key);
+      integrateColor(n, r, g, b);
+    }
+    return n;
+  }
+
+  void ColorOcTree::integrateColor(ColorOcTreeNode* n, uint8_t r, uint8_t g, uint8_t b) const {
+    if (n->isColorSet()) {
+      ColorOcTreeNode::Color prev_color = n->getColor();
+      double node_prob = n->getOccupancy();
+      uint8_t new_r = (uint8_t) ((double) prev_color.r * node_prob
+                                             +  (double) r * (0.99-node_prob));
+      uint8_t new_g = (uint8_t) ((double) prev_color.g * node_prob
+                                             +  (double) g * (0.99-node_prob));
+      uint8_t new_b = (uint8_t) ((double) prev_color.b * node_prob
+                                             +  (double) b * (0.99-node_prob));
+      n->setColor(new_r, new_g, new_b);
+    }
+    else {
+      n->setColor(r, g, b);
+    }
+  }
+
+  namespace {
+    /// summed colors of the points in a voxel
+    struct ColorSum {
+      ColorSum() : r(0), g(0), b(0), num_points(0) {}
+      unsigned int r, g, b;
+      unsigned int num_points;
+    };
+    typedef unordered_ns::unordered_map<OcTreeKey, ColorSum, OcTreeKey::KeyHash> KeyColorMap;
+
+    /// predicate for std::partition: true if the key's bit at level is not set along axis
+    struct KeyBitUnset {
+      KeyBitUnset(unsigned int axis, unsigned int level) : axis(axis), mask((key_type) (1 << level)) {}
+      bool operator()(const OcTreeKey& key) const { return (key[axis] & mask) == 0; }
+      unsigned int axis;
+      key_type mask;
+    };
+  }
+
+  void ColorOcTree::insertPointCloud(const Pointcloud& scan, const std::vector<ColorOcTreeNode::Color>& colors,
+                                     const point3d& sensor_origin, double maxrange, bool lazy_eval,
+                                     bool discretize) {
+    if (colors.size() != scan.size()) {
+      OCTOMAP_ERROR("Error in insertPointCloud: %u colors given for %u points\n",
+                    (unsigned int) colors.size(), (unsigned int) scan.size());
+      return;
+    }
+
+    KeySet free_cells, occupied_cells;
+    if (discretize)
+      computeDiscreteUpdate(scan, sensor_origin, free_cells, occupied_cells, maxrange);
+    else
+      computeUpdate(scan, sensor_origin, free_cells, occupied_cells, maxrange);
+
+    // average the colors of the endpoints in each occupied voxel
+    KeyColorMap color_sums;
+    OcTreeKey key;
+    for (size_t i = 0; i < scan.size(); ++i) {
+      const point3d& p = scan[i];
+      if (maxrange > 0.0 && (p - sensor_origin).norm() > maxrange)
+        continue;
+      if (!coordToKeyChecked(p, key) || occupied_cells.find(key) == occupied_cells.end())
+        continue;
+      ColorSum& sum = color_sums[key];
+      sum.r += colors[i].r;
+      sum.g += colors[i].g;
+      sum.b += colors[i].b;
+      ++sum.num_points;
+    }
+
+    // update the leafs (marking them dirty), inner nodes are updated afterwards
+    for (KeySet::iterator it = free_cells.begin(); it != free_cells.end(); ++it) {
+      updateNode(*it, false, true);
+    }
+    for (KeySet::iterator it = occupied_cells.begin(); it != occupied_cells.end(); ++it) {
+      ColorOcTreeNode* n = updateNode(*it, true, true);
+      KeyColorMap::const_iterator sum = color_sums.find(*it);
+      if (n != NULL && sum != color_sums.end()) {
+        const unsigned int num_points = sum->second.num_points;
+        integrateColor(n, (uint8_t) (sum->second.r / num_points), (uint8_t) (sum->second.g / num_points),
+                       (uint8_t) (sum->second.b / num_points));
       }
-      else {
-        n->setColor(r, g, b);
+    }
+
+    if (!lazy_eval)
+      updateDirtyInnerOccupancy();
+
+    if (local_map_radius > 0.0)
+      updateLocalMap(sensor_origin);
+  }
+
+  void ColorOcTree::insertPointCloud(const Pointcloud& scan, const std::vector<ColorOcTreeNode::Color>& colors,
+                                     const point3d& sensor_origin, const pose6d& frame_origin,
+                                     double maxrange, bool lazy_eval, bool discretize) {
+    // performs transformation to data and sensor origin first
+    Pointcloud transformed_scan (scan);
+    transformed_scan.transform(frame_origin);
+    point3d transformed_sensor_origin = frame_origin.transform(sensor_origin);
+    insertPointCloud(transformed_scan, colors, transformed_sensor_origin, maxrange, lazy_eval, discretize);
+  }
+
+  void ColorOcTree::updateInnerNodesRecurs(ColorOcTreeNode* node, unsigned int depth,
+                                           std::vector<OcTreeKey>::iterator begin,
+                                           std::vector<OcTreeKey>::iterator end,
+                                           unsigned int stop_depth, std::vector<InnerNodesTask>* tasks,
+                                           size_t& num_deleted) {
+    if (depth >= this->tree_depth || !nodeHasChildren(node))
+      return;
+
+    if (depth == stop_depth) {
+      if (tasks) {
+        InnerNodesTask task;
+        task.node = node;
+        task.depth = depth;
+        task.begin = begin;
+        task.end = end;
+        tasks->push_back(task);
       }
+      return;
+    }
+
+    // group the keys by child index (x: 1, y: 2, z: 4)
+    const unsigned int level = this->tree_depth - 1 - depth;
+    std::vector<OcTreeKey>::iterator bounds[9];
+    bounds[0] = begin;
+    bounds[4] = std::partition(begin, end, KeyBitUnset(2, level));
+    bounds[8] = end;
+    bounds[2] = std::partition(bounds[0], bounds[4], KeyBitUnset(1, level));
+    bounds[6] = std::partition(bounds[4], bounds[8], KeyBitUnset(1, level));
+    for (unsigned int i = 0; i < 8; i += 2)
+      bounds[i+1] = std::partition(bounds[i], bounds[i+2], KeyBitUnset(0, level));
+
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (bounds[i] != bounds[i+1] && nodeChildExists(node, i))
+        updateInnerNodesRecurs(getNodeChild(node, i), depth+1, bounds[i], bounds[i+1],
+                               stop_depth, tasks, num_deleted);
+    }
+
+    if (tasks == NULL && !pruneNode(node, num_deleted)) {
+      node->updateOccupancyChildren();
+      node->updateColorChildren();
     }
-    return n;
   }
 
+  void ColorOcTree::updateDirtyInnerOccupancy() {
+    if (this->root == NULL || dirty_keys.empty()) {
+      dirty_keys.clear();
+      return;
+    }
+
+    // the keys are reordered along the paths to them
+    std::vector<OcTreeKey> keys(dirty_keys.begin(), dirty_keys.end());
+    dirty_keys.clear();
+
+    size_t num_deleted = 0;
+#ifdef _OPENMP
+    // update the subtrees below task_depth in parallel, then the nodes above
+    const unsigned int task_depth = std::min(4u, this->tree_depth);
+    if (keys.size() > 10000) {
+      std::vector<InnerNodesTask> tasks;
+      updateInnerNodesRecurs(this->root, 0, keys.begin(), keys.end(), task_depth, &tasks, num_deleted);
+
+      #pragma omp parallel for schedule(dynamic) reduction(+:num_deleted)
+      for (int i = 0; i < (int) tasks.size(); ++i) {
+        updateInnerNodesRecurs(tasks[i].node, tasks[i].depth, tasks[i].begin, tasks[i].end,
+                               this->tree_depth + 1, NULL, num_deleted);
+      }
+
+      updateInnerNodesRecurs(this->root, 0, keys.begin(), keys.end(), task_depth, NULL, num_deleted);
+    }
+    else
+#endif
+      updateInnerNodesRecurs(this->root, 0, keys.begin(), keys.end(), this->tree_depth + 1,
+                             NULL, num_deleted);
+
+    if (num_deleted > 0) {
+      tree_size -= num_deleted;
+      size_changed = true;
+    }
+  }
 
   void ColorOcTree::updateInnerOccupancy() {
     this->updateInnerOccupancyRecurs(this->root, 0);
+    dirty_keys.clear();
+  }
+
+  void ColorOcTree::clear() {
+    OccupancyOcTreeBase<ColorOcTreeNode>::clear();
+    dirty_keys.clear();
+  }
+
+  void ColorOcTree::updateCroppedInnerNode(ColorOcTreeNode* node) {
+    node->updateOccupancyChildren();
+    node->updateColorChildren();
   }
 
   void ColorOcTree::updateInnerOccupancyRecurs(ColorOcTreeNode* node, unsigned int depth) {
@@ -32,8 +32,13 @@
  */
 
 #include <cassert>
+#include <algorithm>
 #include <octomap/CountingOcTree.h>
 
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
 namespace octomap {
 
 
@@ -91,9 +96,109 @@ namespace octomap {
   }
 
 
+  size_t CountingOcTree::updateNodes(const point3d_collection& points) {
+    if (points.empty())
+      return 0;
+    return countPoints(&points[0], points.size());
+  }
+
+  size_t CountingOcTree::updateNodes(const Pointcloud& scan) {
+    if (scan.size() == 0)
+      return 0;
+    return countPoints(&scan[0], scan.size());
+  }
+
+  size_t CountingOcTree::countPoints(const point3d* points, size_t num_points) {
+
+    typedef unordered_ns::unordered_map<OcTreeKey, unsigned int, OcTreeKey::KeyHash> KeyCountMap;
+
+    // accumulate counts per thread, merge afterwards:
+    unsigned int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+    std::vector<KeyCountMap> thread_counts(num_threads);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (long i = 0; i < (long) num_points; ++i) {
+      unsigned int thread_idx = 0;
+#ifdef _OPENMP
+      thread_idx = omp_get_thread_num();
+#endif
+      OcTreeKey key;
+      if (coordToKeyChecked(points[i], key))
+        thread_counts[thread_idx][key]++;
+    }
+
+    size_t num_keys = 0;
+    for (unsigned int t = 0; t < num_threads; ++t)
+      num_keys += thread_counts[t].size();
+    if (num_keys == 0)
+      return 0;
+
+    std::vector<MortonCount> counts;
+    counts.reserve(num_keys);
+    for (unsigned int t = 0; t < num_threads; ++t) {
+      for (KeyCountMap::const_iterator it = thread_counts[t].begin(); it != thread_counts[t].end(); ++it)
+        counts.push_back(MortonCount(computeMortonCode(it->first), it->second));
+      KeyCountMap().swap(thread_counts[t]);
+    }
+    std::sort(counts.begin(), counts.end());
+
+    // combine keys counted by several threads
+    std::vector<MortonCount>::iterator last = counts.begin();
+    for (std::vector<MortonCount>::iterator it = counts.begin() + 1; it != counts.end(); ++it) {
+      if (it->first == last->first)
+        last->second += it->second;
+      else
+        *(++last) = *it;
+    }
+    counts.erase(last + 1, counts.end());
+
+    if (root == NULL) {
+      root = new CountingOcTreeNode();
+      tree_size++;
+    }
+    return insertCountsRecurs(root, 0, counts.begin(), counts.end());
+  }
+
+  unsigned int CountingOcTree::insertCountsRecurs(CountingOcTreeNode* node, unsigned int depth,
+                                                  std::vector<MortonCount>::const_iterator begin,
+                                                  std::vector<MortonCount>::const_iterator end) {
+    unsigned int total = 0;
+
+    if (depth == tree_depth) {
+      for (std::vector<MortonCount>::const_iterator it = begin; it != end; ++it)
+        total += it->second;
+    }
+    else {
+      // the child index at this depth is stored in the three bits above the child's subtree
+      unsigned int shift = 3 * (tree_depth - 1 - depth);
+      while (begin != end) {
+        unsigned int pos = (unsigned int) ((begin->first >> shift) & 7);
+        MortonCount child_end_code (((begin->first >> shift) + 1) << shift, 0);
+        std::vector<MortonCount>::const_iterator child_end = std::lower_bound(begin, end, child_end_code);
+
+        if (!nodeChildExists(node, pos))
+          createNodeChild(node, pos);
+        total += insertCountsRecurs(getNodeChild(node, pos), depth + 1, begin, child_end);
+        begin = child_end;
+      }
+    }
+
+    node->increaseCount(total);
+    return total;
+  }
+
+
   void CountingOcTree::getCentersMinHits(point3d_list& node_centers, unsigned int min_hits) const {
 
     OcTreeKey root_key;
+    if (this->root == NULL)
+      return;
+
     root_key[0] = root_key[1] = root_key[2] = this->tree_max_val;
     getCentersMinHitsRecurs(node_centers, min_hits, this->tree_depth, this->root, 0, root_key);
   }
@@ -105,6 +210,10 @@ namespace octomap {
                                                 CountingOcTreeNode* node, unsigned int depth,
                                                 const OcTreeKey& parent_key) const {
 
+    // counts are recursive, no leaf below can reach min_hits
+    if (node->getCount() < min_hits)
+      return;
+
     if (depth < max_depth && nodeHasChildren(node)) {
 
       key_type center_offset_key = this->tree_max_val >> (depth + 1);
@@ -120,9 +229,7 @@ namespace octomap {
 
     else { // max level reached
 
-      if (node->getCount() >= min_hits) {
-        node_centers.push_back(this->keyToCoord(parent_key, depth));
-      }
+      node_centers.push_back(this->keyToCoord(parent_key, depth));
     }
   }
 
@@ -0,0 +1,183 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <cstdio>
+#include <octomap/IndexedMesh.h>
+#include <octomap/PointCloudWriter.h>
+
+namespace octomap {
+
+  namespace {
+    /// writes the three coordinates of p (formatted as by std::ostream) and suffix
+    inline void writeVertexText(BufferedWriter& out, const char* prefix, const point3d& p, const char* suffix) {
+      char buffer[128];
+      int length = snprintf(buffer, sizeof(buffer), "%s%g %g %g%s", prefix, p.x(), p.y(), p.z(), suffix);
+      out.write(buffer, length);
+    }
+
+    /// writes a triangle's vertex indices (plus offset) and suffix
+    inline void writeTriangleText(BufferedWriter& out, const char* prefix, const unsigned int* indices,
+                                  unsigned int offset, const char* suffix) {
+      char buffer[128];
+      int length = snprintf(buffer, sizeof(buffer), "%s%u %u %u%s", prefix, indices[0] + offset,
+                            indices[1] + offset, indices[2] + offset, suffix);
+      out.write(buffer, length);
+    }
+  }
+
+  void IndexedMesh::clear() {
+    vertices.clear();
+    indices.clear();
+  }
+
+  void IndexedMesh::append(const IndexedMesh& other) {
+    unsigned int offset = (unsigned int) vertices.size();
+    vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
+    indices.reserve(indices.size() + other.indices.size());
+    for (size_t i = 0; i < other.indices.size(); ++i)
+      indices.push_back(other.indices[i] + offset);
+  }
+
+  void IndexedMesh::computeVertexNormals(std::vector<point3d>& normals) const {
+    normals.assign(vertices.size(), point3d(0, 0, 0));
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      const point3d& p1 = vertices[indices[i]];
+      // unnormalized: weighted by the triangle area
+      point3d n = (vertices[indices[i+1]] - p1).cross(vertices[indices[i+2]] - p1);
+      normals[indices[i]] += n;
+      normals[indices[i+1]] += n;
+      normals[indices[i+2]] += n;
+    }
+    for (size_t i = 0; i < normals.size(); ++i) {
+      if (normals[i].norm() > 0.0)
+        normals[i].normalize();
+    }
+  }
+
+  bool IndexedMesh::writeObj(const std::string& filename) const {
+    std::ofstream outfile(filename.c_str());
+    if (!outfile.is_open()) {
+      OCTOMAP_ERROR_STR("Filestream to " << filename << " not open, nothing written.");
+      return false;
+    }
+    writeObj(outfile);
+    outfile.close();
+    return outfile.good();
+  }
+
+  std::ostream& IndexedMesh::writeObj(std::ostream& s) const {
+    s << "# " << vertices.size() << " vertices, " << getNumTriangles() << " triangles\n";
+    BufferedWriter out(s);
+    for (size_t i = 0; i < vertices.size(); ++i)
+      writeVertexText(out, "v ", vertices[i], "\n");
+    // OBJ indices start at 1
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+      writeTriangleText(out, "f ", &indices[i], 1, "\n");
+    out.flush();
+    return s;
+  }
+
+  bool IndexedMesh::writePly(const std::string& filename) const {
+    std::ofstream outfile(filename.c_str(), std::ios_base::out | std::ios_base::binary);
+    if (!outfile.is_open()) {
+      OCTOMAP_ERROR_STR("Filestream to " << filename << " not open, nothing written.");
+      return false;
+    }
+    writePly(outfile);
+    outfile.close();
+    return outfile.good();
+  }
+
+  std::ostream& IndexedMesh::writePly(std::ostream& s) const {
+    // values are written in host byte order
+    unsigned short one = 1;
+    bool little_endian = (*((unsigned char*) &one) == 1);
+    s << "ply\n"
+      << "format " << (little_endian ? "binary_little_endian" : "binary_big_endian") << " 1.0\n"
+      << "element vertex " << vertices.size() << "\n"
+      << "property float x\n"
+      << "property float y\n"
+      << "property float z\n"
+      << "element face " << getNumTriangles() << "\n"
+      << "property list uchar uint vertex_indices\n"
+      << "end_header\n";
+
+    BufferedWriter out(s);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+      float xyz[3] = {vertices[i].x(), vertices[i].y(), vertices[i].z()};
+      out.write(xyz, sizeof(xyz));
+    }
+    const unsigned char num_corners = 3;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      out.write(&num_corners, 1);
+      out.write(&indices[i], 3 * sizeof(unsigned int));
+    }
+    out.flush();
+    return s;
+  }
+
+  bool IndexedMesh::writeVrml(const std::string& filename) const {
+    std::ofstream outfile(filename.c_str());
+    if (!outfile.is_open()) {
+      OCTOMAP_ERROR_STR("Filestream to " << filename << " not open, nothing written.");
+      return false;
+    }
+    writeVrml(outfile);
+    outfile.close();
+    return outfile.good();
+  }
+
+  std::ostream& IndexedMesh::writeVrml(std::ostream& s) const {
+    s << "#VRML V2.0 utf8\n"
+      << "# " << vertices.size() << " vertices, " << getNumTriangles() << " triangles\n"
+      << "Shape {\n"
+      << "  appearance Appearance { material Material { } }\n"
+      << "  geometry IndexedFaceSet {\n"
+      << "    coord Coordinate { point [\n";
+    BufferedWriter out(s);
+    for (size_t i = 0; i < vertices.size(); ++i)
+      writeVertexText(out, "", vertices[i], ",\n");
+    out.flush();
+    s << "    ] }\n"
+      << "    coordIndex [\n";
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+      writeTriangleText(out, "", &indices[i], 0, " -1,\n");
+    out.flush();
+    s << "    ]\n"
+      << "  }\n"
+      << "}\n";
+    return s;
+  }
+
+} // namespace
@@ -0,0 +1,208 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <octomap/LikelihoodField.h>
+
+namespace octomap {
+
+  void LikelihoodField::reset(double resolution, const point3d& origin,
+                              unsigned int size_x, unsigned int size_y, unsigned int size_z) {
+    this->resolution = resolution;
+    this->origin = origin;
+    this->size_x = size_x;
+    this->size_y = size_y;
+    this->size_z = size_z;
+    distance.assign(size_t(size_x) * size_y * size_z, std::numeric_limits<float>::max());
+    log_likelihood.clear();
+  }
+
+  void LikelihoodField::computeDistances(double max_distance) {
+    // squared distances in cells, "far" stays finite to avoid inf - inf in the transform
+    const float far = 1e20f;
+    for (size_t i = 0; i < distance.size(); ++i)
+      distance[i] = (distance[i] == 0.0f) ? 0.0f : far;
+
+    // one pass per axis over all lines of cells along it
+    const unsigned int sizes[3] = {size_x, size_y, size_z};
+    const size_t strides[3] = {1, size_x, size_t(size_x) * size_y};
+    for (unsigned int axis = 0; axis < 3 && !distance.empty(); ++axis) {
+      const unsigned int n = sizes[axis];
+      const size_t stride = strides[axis];
+      const int num_lines = (int) (distance.size() / n);
+#ifdef _OPENMP
+      #pragma omp parallel
+#endif
+      {
+        std::vector<float> f(n);
+        std::vector<float> d(n);
+        std::vector<float> z(n + 1);
+        std::vector<int> v(n);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int line = 0; line < num_lines; ++line) {
+          const size_t start = (line / stride) * stride * n + (line % stride);
+          for (unsigned int i = 0; i < n; ++i)
+            f[i] = distance[start + i * stride];
+          distanceTransform1D(&f[0], n, &d[0], &v[0], &z[0]);
+          for (unsigned int i = 0; i < n; ++i)
+            distance[start + i * stride] = d[i];
+        }
+      }
+    }
+
+    const float max_dist = (float) max_distance;
+    for (size_t i = 0; i < distance.size(); ++i)
+      distance[i] = std::min((float) (sqrt(distance[i]) * resolution), max_dist);
+  }
+
+  void LikelihoodField::distanceTransform1D(const float* f, unsigned int n, float* d, int* v, float* z) {
+    // lower envelope of the parabolas rooted at (q, f[q]), see Felzenszwalb and Huttenlocher:
+    // "Distance Transforms of Sampled Functions", Theory of Computing 8, 2012
+    const float inf = std::numeric_limits<float>::infinity();
+    int k = 0;
+    v[0] = 0;
+    z[0] = -inf;
+    z[1] = inf;
+    for (int q = 1; q < (int) n; ++q) {
+      float s = ((f[q] + float(q) * q) - (f[v[k]] + float(v[k]) * v[k])) / (2.0f * (q - v[k]));
+      while (s <= z[k]) {
+        --k;
+        s = ((f[q] + float(q) * q) - (f[v[k]] + float(v[k]) * v[k])) / (2.0f * (q - v[k]));
+      }
+      ++k;
+      v[k] = q;
+      z[k] = s;
+      z[k+1] = inf;
+    }
+
+    k = 0;
+    for (int q = 0; q < (int) n; ++q) {
+      while (z[k+1] < q)
+        ++k;
+      d[q] = float(q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+  }
+
+  void LikelihoodField::setSensorModel(double sigma, double random_prob) {
+    this->sigma = sigma;
+    this->random_prob = random_prob;
+    const double inv_two_sigma_sq = 1.0 / (2.0 * sigma * sigma);
+    log_likelihood.resize(distance.size());
+    for (size_t i = 0; i < distance.size(); ++i) {
+      double d = distance[i];
+      log_likelihood[i] = (float) log((1.0 - random_prob) * exp(-d * d * inv_two_sigma_sq) + random_prob);
+    }
+    outside_log_likelihood = (float) log(random_prob);
+  }
+
+  void LikelihoodField::scorePoses(const Pointcloud& scan, const std::vector<pose6d>& poses,
+                                   std::vector<double>& log_likelihoods) const {
+    log_likelihoods.assign(poses.size(), 0.0);
+    const size_t num_points = scan.size();
+    if (num_points == 0)
+      return;
+
+    // separate coordinate arrays for the transform loop
+    std::vector<float> xs(num_points);
+    std::vector<float> ys(num_points);
+    std::vector<float> zs(num_points);
+    for (size_t j = 0; j < num_points; ++j) {
+      xs[j] = scan[j].x();
+      ys[j] = scan[j].y();
+      zs[j] = scan[j].z();
+    }
+
+    const int num_poses = (int) poses.size();
+    const double inv_resolution = (resolution > 0.0) ? 1.0 / resolution : 0.0;
+    const bool empty = log_likelihood.empty();
+    const float max_x = (float) size_x;
+    const float max_y = (float) size_y;
+    const float max_z = (float) size_z;
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+      std::vector<float> cx(num_points);
+      std::vector<float> cy(num_points);
+      std::vector<float> cz(num_points);
+      std::vector<double> rot;
+#ifdef _OPENMP
+      #pragma omp for schedule(dynamic, 16)
+#endif
+      for (int i = 0; i < num_poses; ++i) {
+        if (empty) {
+          log_likelihoods[i] = num_points * outside_log_likelihood;
+          continue;
+        }
+
+        // transform directly into (continuous) cell coordinates
+        poses[i].rot().toRotMatrix(rot);
+        const point3d& t = poses[i].trans();
+        float m[9];
+        for (unsigned int k = 0; k < 9; ++k)
+          m[k] = (float) (rot[k] * inv_resolution);
+        const float t0 = (float) ((t.x() - origin.x()) * inv_resolution);
+        const float t1 = (float) ((t.y() - origin.y()) * inv_resolution);
+        const float t2 = (float) ((t.z() - origin.z()) * inv_resolution);
+        const float* px = &xs[0];
+        const float* py = &ys[0];
+        const float* pz = &zs[0];
+        for (size_t j = 0; j < num_points; ++j) {
+          cx[j] = m[0] * px[j] + m[1] * py[j] + m[2] * pz[j] + t0;
+          cy[j] = m[3] * px[j] + m[4] * py[j] + m[5] * pz[j] + t1;
+          cz[j] = m[6] * px[j] + m[7] * py[j] + m[8] * pz[j] + t2;
+        }
+
+        double sum = 0.0;
+        for (size_t j = 0; j < num_points; ++j) {
+          // range check before the conversion, which overflows far outside of the grid
+          if (cx[j] >= 0.0f && cy[j] >= 0.0f && cz[j] >= 0.0f
+              && cx[j] < max_x && cy[j] < max_y && cz[j] < max_z) {
+            unsigned int x = std::min((unsigned int) cx[j], size_x - 1);
+            unsigned int y = std::min((unsigned int) cy[j], size_y - 1);
+            unsigned int z = std::min((unsigned int) cz[j], size_z - 1);
+            sum += log_likelihood[index(x, y, z)];
+          }
+          else
+            sum += outside_log_likelihood;
+        }
+        log_likelihoods[i] = sum;
+      }
+    }
+  }
+
+} // namespace
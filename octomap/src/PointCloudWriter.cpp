@@ -0,0 +1,120 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <octomap/PointCloudWriter.h>
+#include <algorithm>
+#include <cctype>
+
+namespace octomap {
+
+  BufferedWriter::BufferedWriter(std::ostream& s, size_t buffer_size)
+    : stream(s), buffer(std::max(buffer_size, (size_t) 1)), used(0)
+  {
+  }
+
+  BufferedWriter::~BufferedWriter() {
+    flush();
+  }
+
+  bool BufferedWriter::flush() {
+    if (used > 0) {
+      stream.write(&buffer[0], used);
+      used = 0;
+    }
+    return stream.good();
+  }
+
+
+  PointCloudWriter::PointCloudWriter(std::ostream& s, Format format)
+    : out(s), format(format), num_points(0), num_written(0)
+  {
+  }
+
+  void PointCloudWriter::writeHeader(size_t num_points) {
+    this->num_points = num_points;
+    std::ostream& s = out.getStream();
+    if (format == PCD) {
+      s << "# .PCD v0.7\n"
+        << "VERSION 0.7\n"
+        << "FIELDS x y z\n"
+        << "SIZE 4 4 4\n"
+        << "TYPE F F F\n"
+        << "COUNT 1 1 1\n"
+        << "WIDTH " << num_points << "\n"
+        << "HEIGHT 1\n"
+        << "VIEWPOINT 0 0 0 1 0 0 0\n"
+        << "POINTS " << num_points << "\n"
+        << "DATA binary\n";
+    } else {
+      // floats are written in host byte order
+      unsigned short one = 1;
+      bool little_endian = (*((unsigned char*) &one) == 1);
+      s << "ply\n"
+        << "format " << (little_endian ? "binary_little_endian" : "binary_big_endian") << " 1.0\n"
+        << "element vertex " << num_points << "\n"
+        << "property float x\n"
+        << "property float y\n"
+        << "property float z\n"
+        << "end_header\n";
+    }
+  }
+
+  void PointCloudWriter::writePoints(const point3d* points, size_t num_points) {
+    for (size_t i = 0; i < num_points; ++i)
+      writePoint(points[i]);
+  }
+
+  bool PointCloudWriter::finish() {
+    bool ok = out.flush();
+    if (num_written != num_points) {
+      OCTOMAP_ERROR_STR("PointCloudWriter: wrote " << num_written << " points, header announced " << num_points);
+      return false;
+    }
+    return ok;
+  }
+
+  bool PointCloudWriter::formatFromFilename(const std::string& filename, Format& format) {
+    if (filename.size() < 4)
+      return false;
+    std::string extension = filename.substr(filename.size() - 4);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".pcd")
+      format = PCD;
+    else if (extension == ".ply")
+      format = PLY;
+    else
+      return false;
+    return true;
+  }
+
+} // namespace
@@ -35,6 +35,7 @@
 #include <fstream>
 #include <sstream>
 #include <stdlib.h>
+#include <limits>
 
 #include <octomap/math/Pose6D.h>
 #include <octomap/ScanGraph.h>
@@ -424,7 +425,7 @@ namespace octomap {
   }
 
   void ScanGraph::readPlainASCII(const std::string& filename){
-    std::ifstream infile(filename.c_str());
+    std::ifstream infile(filename.c_str(), std::ios_base::binary);
     if (!infile.is_open()){
       OCTOMAP_ERROR_STR("Filestream to "<< filename << " not open, nothing read.");
       return;
@@ -433,58 +434,36 @@ namespace octomap {
     infile.close();
   }
 
-  std::istream& ScanGraph::readPlainASCII(std::istream& s){
-    std::string currentLine;
-    ScanNode* currentNode = NULL;
-    while (true){
-      getline(s, currentLine);
-      if (s.good() && !s.eof()){
-        std::stringstream ss;
-        ss << currentLine;
-        // skip empty and comment lines:
-        if (currentLine.size() == 0
-            || (currentLine.compare(0,1, "#") == 0)
-            || (currentLine.compare(0,1, " ") == 0)){
-
-          continue;
-        } else if(currentLine.compare(0,4,"NODE")==0){
-          if (currentNode){
-            this->nodes.push_back(currentNode);
-            this->connectPrevious();
-            OCTOMAP_DEBUG_STR("ScanNode "<< currentNode->pose << " done, size: "<< currentNode->scan->size());
-          }
-
-          currentNode = new ScanNode();
-          currentNode->scan = new Pointcloud();
-
-          float x, y, z, roll, pitch, yaw;
-          std::string tmp;
-          ss >> tmp >> x >> y >> z >> roll >> pitch >> yaw;
-          pose6d pose(x, y, z, roll, pitch, yaw);
-          //std::cout << "Pose "<< pose << " found.\n";
-          currentNode->pose = pose;
-        } else{
-          if (currentNode == NULL){
-            // TODO: allow "simple" pc files by setting initial Scan Pose to (0,0,0)
-            OCTOMAP_ERROR_STR("Error parsing log file, no Scan to add point to!");
-            break;
-          }
-          float x, y, z;
-          ss >> x >> y >> z;
-
-          //std::cout << "Point "<< x << "," <<y <<"," <<z << " found.\n";
-          currentNode->scan->push_back(x,y,z);
-        }
-      } else{
-        if (currentNode){
-          this->nodes.push_back(currentNode);
-          this->connectPrevious();
-          OCTOMAP_DEBUG_STR("Final ScanNode "<< currentNode->pose << " done, size: "<< currentNode->scan->size());
-        }
-        break;
+  namespace {
+    /// appends the scans of a log to a ScanGraph
+    class ScanGraphBuilder : public ScanLogReader::Handler {
+    public:
+      ScanGraphBuilder(ScanGraph& graph) : graph(graph), node(NULL) {}
+
+      virtual void beginNode(const pose6d& pose) {
+        node = graph.addNode(new Pointcloud(), pose);
+      }
+
+      virtual void addPoints(const point3d* points, size_t num_points) {
+        for (size_t i = 0; i < num_points; ++i)
+          node->scan->push_back(points[i]);
+      }
+
+      virtual void endNode() {
+        graph.connectPrevious();
+        OCTOMAP_DEBUG_STR("ScanNode "<< node->pose << " done, size: "<< node->scan->size());
       }
-    }
 
+    private:
+      ScanGraph& graph;
+      ScanNode* node;
+    };
+  }
+
+  std::istream& ScanGraph::readPlainASCII(std::istream& s){
+    ScanGraphBuilder builder(*this);
+    ScanLogReader reader;
+    reader.read(s, builder);
     return s;
   }
 
@@ -619,6 +598,96 @@ namespace octomap {
   }
 
 
+
+  ScanGraphWriter::ScanGraphWriter(const std::string& filename)
+    : file(filename.c_str(), std::ios_base::binary), out(file),
+      node_points(0), num_points(0), in_node(false)
+  {
+    if (!file.is_open()) {
+      OCTOMAP_ERROR_STR("Filestream to "<< filename << " not open, nothing written.");
+      return;
+    }
+    // file structure:    n | node_1 | ... | node_n | m | edge_1 | ... | edge_m
+    uint32_t graph_size = 0;
+    out.write(&graph_size, sizeof(graph_size));
+  }
+
+  ScanGraphWriter::~ScanGraphWriter() {
+    if (file.is_open())
+      close();
+  }
+
+  void ScanGraphWriter::beginNode(const pose6d& pose) {
+    if (in_node)
+      endNode();
+    // node structure:    pointcloud | pose | id, the point count is known at endNode()
+    out.flush();
+    node_size_pos = file.tellp();
+    uint32_t pc_size = 0;
+    out.write(&pc_size, sizeof(pc_size));
+    poses.push_back(pose);
+    node_points = 0;
+    in_node = true;
+  }
+
+  void ScanGraphWriter::addPoints(const point3d* points, size_t num_points) {
+    // same records as Vector3::writeBinary()
+    for (size_t i = 0; i < num_points; ++i) {
+      int temp = 3;
+      double xyz[3] = {points[i].x(), points[i].y(), points[i].z()};
+      out.write(&temp, sizeof(temp));
+      out.write(xyz, sizeof(xyz));
+    }
+    node_points += num_points;
+    this->num_points += num_points;
+  }
+
+  void ScanGraphWriter::endNode() {
+    if (!in_node)
+      return;
+    if (node_points > std::numeric_limits<uint32_t>::max())
+      OCTOMAP_ERROR("ScanGraphWriter ERROR: Point cloud too large to be written");
+    out.flush();
+    poses.back().writeBinary(file);
+    uint32_t id = static_cast<uint32_t>(poses.size() - 1);
+    file.write((char*)&id, sizeof(id));
+    writeAt(node_size_pos, static_cast<uint32_t>(node_points));
+    in_node = false;
+  }
+
+  void ScanGraphWriter::writeAt(std::streampos pos, uint32_t value) {
+    std::streampos current = file.tellp();
+    file.seekp(pos);
+    file.write((char*)&value, sizeof(value));
+    file.seekp(current);
+  }
+
+  bool ScanGraphWriter::close() {
+    if (!file.is_open())
+      return false;
+    endNode();
+    out.flush();
+
+    // edges between consecutive nodes as in ScanGraph::connectPrevious()
+    unsigned int num_edges = poses.empty() ? 0 : (unsigned int) poses.size() - 1;
+    file.write((char*)&num_edges, sizeof(num_edges));
+    for (unsigned int i = 0; i < num_edges; ++i) {
+      unsigned int first_id = i;
+      unsigned int second_id = i + 1;
+      pose6d constraint = poses[i].inv() * poses[i + 1];
+      double weight = 1.0;
+      file.write((char*)&first_id, sizeof(first_id));
+      file.write((char*)&second_id, sizeof(second_id));
+      constraint.writeBinary(file);
+      file.write((char*)&weight, sizeof(weight));
+    }
+
+    writeAt(0, static_cast<uint32_t>(poses.size()));
+    bool ok = file.good();
+    file.close();
+    return ok;
+  }
+
 } // end namespace
 
 
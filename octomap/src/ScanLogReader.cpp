@@ -0,0 +1,283 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <octomap/ScanLogReader.h>
+#include <octomap/octomap_types.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cfloat>
+#include <cmath>
+#include <string>
+#include <stdint.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace octomap {
+
+  namespace {
+    inline bool isBlank(char c) {
+      return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    inline bool isDigit(char c) {
+      return c >= '0' && c <= '9';
+    }
+
+    const float POW10_FLOAT[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    const double POW10_DOUBLE[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  }
+
+
+  ScanLogReader::ScanLogReader(size_t block_size)
+    : block_size(std::max(block_size, (size_t) 1024)), in_node(false)
+  {
+  }
+
+  bool ScanLogReader::parseFloat(const char*& p, const char* end, float& value) {
+    const char* s = p;
+    while (s < end && isBlank(*s))
+      ++s;
+    const char* start = s;
+
+    bool negative = false;
+    if (s < end && (*s == '+' || *s == '-')) {
+      negative = (*s == '-');
+      ++s;
+    }
+
+    // significant digits and decimal exponent
+    uint64_t mantissa = 0;
+    int num_digits = 0;
+    int exponent = 0;
+    bool has_digits = false;
+    for (; s < end && isDigit(*s); ++s) {
+      has_digits = true;
+      if (mantissa == 0 && *s == '0')
+        continue;
+      if (num_digits < 19) {
+        mantissa = mantissa * 10 + (*s - '0');
+        ++num_digits;
+      } else
+        ++exponent;
+    }
+    if (s < end && *s == '.') {
+      for (++s; s < end && isDigit(*s); ++s) {
+        has_digits = true;
+        if (mantissa == 0 && *s == '0') {
+          --exponent;
+          continue;
+        }
+        if (num_digits < 19) {
+          mantissa = mantissa * 10 + (*s - '0');
+          ++num_digits;
+          --exponent;
+        }
+      }
+    }
+    if (!has_digits)
+      return false;
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+      const char* e = s + 1;
+      bool negative_exp = false;
+      if (e < end && (*e == '+' || *e == '-')) {
+        negative_exp = (*e == '-');
+        ++e;
+      }
+      if (e < end && isDigit(*e)) {
+        int exp_value = 0;
+        for (; e < end && isDigit(*e); ++e) {
+          if (exp_value < 100000)
+            exp_value = exp_value * 10 + (*e - '0');
+        }
+        exponent += negative_exp ? -exp_value : exp_value;
+        s = e;
+      }
+    }
+    p = s;
+
+    if (mantissa == 0) {
+      value = negative ? -0.0f : 0.0f;
+      return true;
+    }
+
+    // exact operands: a single correctly rounded float operation
+    if (num_digits <= 7 && exponent >= -10 && exponent <= 10) {
+      float f = (float) mantissa;
+      f = (exponent < 0) ? f / POW10_FLOAT[-exponent] : f * POW10_FLOAT[exponent];
+      value = negative ? -f : f;
+      return true;
+    }
+
+    // correctly rounded double, unless it lies exactly halfway between two floats:
+    // then the decimal value may be on either side (the low 29 of the 52 mantissa
+    // bits are dropped when rounding to float)
+    if (num_digits <= 15 && exponent >= -22 && exponent <= 22) {
+      double d = (double) mantissa;
+      d = (exponent < 0) ? d / POW10_DOUBLE[-exponent] : d * POW10_DOUBLE[exponent];
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      if ((bits & 0x1FFFFFFFull) != 0x10000000ull && d >= FLT_MIN && d <= FLT_MAX) {
+        value = (float) (negative ? -d : d);
+        return true;
+      }
+    }
+
+    std::string number(start, s);
+    value = strtof(number.c_str(), NULL);
+    return true;
+  }
+
+  void ScanLogReader::parseLines(const char* begin, const char* end, Chunk& chunk) {
+    chunk.points.clear();
+    chunk.nodes.clear();
+
+    const char* line = begin;
+    while (line < end) {
+      const char* line_end = (const char*) memchr(line, '\n', end - line);
+      if (line_end == NULL)
+        line_end = end;
+
+      // skip empty and comment lines:
+      if (line < line_end && *line != '#' && *line != ' ') {
+        const char* p = line;
+        if (line_end - line >= 4 && strncmp(line, "NODE", 4) == 0) {
+          float values[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+          p += 4;
+          for (unsigned int i = 0; i < 6 && parseFloat(p, line_end, values[i]); ++i) {}
+          NodeMark mark;
+          mark.point_idx = chunk.points.size();
+          mark.pose = pose6d(values[0], values[1], values[2], values[3], values[4], values[5]);
+          chunk.nodes.push_back(mark);
+        } else {
+          float values[3] = {0.0f, 0.0f, 0.0f};
+          unsigned int num_values = 0;
+          while (num_values < 3 && parseFloat(p, line_end, values[num_values]))
+            ++num_values;
+          if (num_values > 0)
+            chunk.points.push_back(point3d(values[0], values[1], values[2]));
+        }
+      }
+      line = line_end + 1;
+    }
+  }
+
+  bool ScanLogReader::dispatch(const Chunk& chunk, Handler& handler) {
+    size_t pos = 0;
+    for (size_t i = 0; i <= chunk.nodes.size(); ++i) {
+      size_t next = (i < chunk.nodes.size()) ? chunk.nodes[i].point_idx : chunk.points.size();
+      if (next > pos) {
+        if (!in_node) {
+          OCTOMAP_ERROR_STR("Error parsing log file, no Scan to add point to!");
+          return false;
+        }
+        handler.addPoints(&chunk.points[pos], next - pos);
+      }
+      pos = next;
+
+      if (i < chunk.nodes.size()) {
+        if (in_node)
+          handler.endNode();
+        handler.beginNode(chunk.nodes[i].pose);
+        in_node = true;
+      }
+    }
+    return true;
+  }
+
+  bool ScanLogReader::read(std::istream& s, Handler& handler) {
+    unsigned int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+    std::vector<Chunk> chunks(num_threads);
+    std::vector<char> buffer(block_size);
+    size_t filled = 0;
+    bool eof = false;
+    bool ok = true;
+    in_node = false;
+
+    while (ok && !eof) {
+      // a line longer than the buffer
+      if (filled == buffer.size())
+        buffer.resize(2 * buffer.size());
+
+      s.read(&buffer[filled], buffer.size() - filled);
+      filled += (size_t) s.gcount();
+      eof = !s;
+
+      // parse complete lines only, the rest is kept for the next block
+      size_t length = filled;
+      if (!eof) {
+        while (length > 0 && buffer[length - 1] != '\n')
+          --length;
+        if (length == 0)
+          continue;
+      }
+
+      // split at line boundaries, one part per thread (about 1 MB at least)
+      const char* data = &buffer[0];
+      size_t num_parts = std::min((size_t) num_threads, length / (1 << 20) + 1);
+      std::vector<const char*> bounds(num_parts + 1, data + length);
+      bounds[0] = data;
+      for (size_t i = 1; i < num_parts; ++i) {
+        const char* b = std::max(data + i * length / num_parts, bounds[i - 1]);
+        const char* newline = (const char*) memchr(b, '\n', data + length - b);
+        bounds[i] = newline ? newline + 1 : data + length;
+      }
+
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(static, 1)
+#endif
+      for (int i = 0; i < (int) num_parts; ++i)
+        parseLines(bounds[i], bounds[i + 1], chunks[i]);
+
+      for (size_t i = 0; ok && i < num_parts; ++i)
+        ok = dispatch(chunks[i], handler);
+
+      filled -= length;
+      if (filled > 0)
+        memmove(&buffer[0], &buffer[length], filled);
+    }
+
+    if (in_node)
+      handler.endNode();
+    in_node = false;
+    return ok;
+  }
+
+} // namespace
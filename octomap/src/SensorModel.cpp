@@ -0,0 +1,70 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <octomap/SensorModel.h>
+
+namespace octomap {
+
+  FovSensorModel::FovSensorModel(double horizontal_fov, double vertical_fov,
+                                 double angular_resolution, double max_range)
+    : horizontal_fov(horizontal_fov), vertical_fov(vertical_fov),
+      angular_resolution(angular_resolution), max_range(max_range)
+  {
+    computeRayDirections();
+  }
+
+  void FovSensorModel::computeRayDirections() {
+    ray_directions.clear();
+    if (angular_resolution <= 0.0)
+      return;
+
+    // at least one ray per axis, rays spread symmetrically around the optical axis
+    unsigned int num_h = (unsigned int) floor(horizontal_fov / angular_resolution) + 1;
+    unsigned int num_v = (unsigned int) floor(vertical_fov / angular_resolution) + 1;
+    double start_h = -0.5 * (num_h-1) * angular_resolution;
+    double start_v = -0.5 * (num_v-1) * angular_resolution;
+
+    ray_directions.reserve(num_h * num_v);
+    for (unsigned int v = 0; v < num_v; ++v) {
+      double pitch = start_v + v * angular_resolution;
+      for (unsigned int h = 0; h < num_h; ++h) {
+        double yaw = start_h + h * angular_resolution;
+        ray_directions.push_back(point3d((float) (cos(pitch) * cos(yaw)),
+                                         (float) (cos(pitch) * sin(yaw)),
+                                         (float) sin(pitch)));
+      }
+    }
+  }
+
+} // namespace
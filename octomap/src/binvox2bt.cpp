@@ -52,6 +52,8 @@
 #include <octomap/octomap.h>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 using namespace octomap;
@@ -81,6 +83,7 @@ int main(int argc, char **argv)
     bool applyOffset = false;
     octomap::point3d offset(0.0, 0.0, 0.0);
     OcTree *tree = 0;
+    bool needs_pruning = false; // after integrating single voxels
 
     if(argc == 1) show_help = true;
     for(int i = 1; i < argc && !show_help; i++) {
@@ -228,13 +231,32 @@ int main(int argc, char **argv)
         cout << "Read data: ";
         cout.flush();
 
-        // read voxel data
+        // a grid aligned with the tree's voxels is decoded and integrated in bulk,
+        // otherwise the runs are streamed into the tree voxel by voxel
+        point3d grid_origin((float) (tx + 0.000001), (float) (ty + 0.000001), (float) (tz + 0.000001));
+        if (applyOffset)
+            grid_origin += offset;
+        point3d grid_max = grid_origin + point3d((float) ((depth - 1) * res), (float) ((width - 1) * res),
+                                                 (float) ((height - 1) * res));
+        OcTreeKey grid_min_key;
+        OcTreeKey grid_max_key;
+        // resolutions computed from different headers may differ by rounding, which
+        // must not shift the grid by a noticeable fraction of a voxel
+        bool same_resolution = fabs(tree->getResolution() - res) * maxSide < 1e-3 * res;
+        bool bulk = size > 0 && !rotate && !applyBBX && same_resolution
+            && tree->coordToKeyChecked(grid_origin, grid_min_key)
+            && tree->coordToKeyChecked(grid_max, grid_max_key);
+
+        // read run-length encoded voxel data
         octomap::byte value;
         octomap::byte count;
         int index = 0;
         int end_index = 0;
         unsigned nr_voxels = 0;
         unsigned nr_voxels_out = 0;
+        std::vector<unsigned char> cells;
+        if (bulk)
+            cells.resize(size, 0);
 
         input->unsetf(ios::skipws);    // need to read every byte now (!)
         *input >> value;    // read the linefeed char
@@ -245,38 +267,44 @@ int main(int argc, char **argv)
             if (input->good()) {
                 end_index = index + count;
                 if (end_index > size) return 0;
-                for(int j=index; j < end_index; j++) {
-                    // Output progress dots
-                    if(j % (size / 20) == 0) {
-                        cout << ".";
-                        cout.flush();
-                    }
-                    // voxel index --> voxel coordinates
-                    int y = j % width;
-                    int z = (j / width) % height;
-                    int x = j / (width * height);
-
-                    // voxel coordinates --> world coordinates
-                    point3d endpoint((float) ((double) x*res + tx + 0.000001),
-                                     (float) ((double) y*res + ty + 0.000001),
-                                     (float) ((double) z*res + tz + 0.000001));
-
-                    if(rotate) {
-                      endpoint.rotate_IP(M_PI_2, 0.0, 0.0);
-                    }
-                    if (applyOffset)
-                    	endpoint += offset;
-
-                    if (!applyBBX  || (endpoint(0) <= maxX && endpoint(0) >= minX
-                                   && endpoint(1) <= maxY && endpoint(1) >= minY
-                                   && endpoint(2) <= maxZ && endpoint(2) >= minZ)){
-
-                      // mark cell in octree as free or occupied
-                      if(mark_free || value == 1) {
-                          tree->updateNode(endpoint, value == 1, true);
-                      }
-                    } else{
-                      nr_voxels_out ++;
+                if (bulk) {
+                    if (value == 1)
+                        std::fill(cells.begin() + index, cells.begin() + end_index, 1);
+                }
+                else {
+                    for(int j=index; j < end_index; j++) {
+                        // Output progress dots
+                        if(j % (size / 20) == 0) {
+                            cout << ".";
+                            cout.flush();
+                        }
+                        // voxel index --> voxel coordinates
+                        int y = j % width;
+                        int z = (j / width) % height;
+                        int x = j / (width * height);
+
+                        // voxel coordinates --> world coordinates
+                        point3d endpoint((float) ((double) x*res + tx + 0.000001),
+                                         (float) ((double) y*res + ty + 0.000001),
+                                         (float) ((double) z*res + tz + 0.000001));
+
+                        if(rotate) {
+                          endpoint.rotate_IP(M_PI_2, 0.0, 0.0);
+                        }
+                        if (applyOffset)
+                        	endpoint += offset;
+
+                        if (!applyBBX  || (endpoint(0) <= maxX && endpoint(0) >= minX
+                                       && endpoint(1) <= maxY && endpoint(1) >= minY
+                                       && endpoint(2) <= maxZ && endpoint(2) >= minZ)){
+
+                          // mark cell in octree as free or occupied
+                          if(mark_free || value == 1) {
+                              tree->updateNode(endpoint, value == 1, true);
+                          }
+                        } else{
+                          nr_voxels_out ++;
+                        }
                     }
                 }
 
@@ -286,6 +314,20 @@ int main(int argc, char **argv)
 
         }    // while
 
+        // voxel index j --> voxel coordinates: y = j % width, z = (j / width) % height,
+        // x = j / (width * height)
+        if (bulk) {
+            if (!tree->insertDenseGrid(grid_min_key, depth, width, height, &cells[0],
+                                       (size_t) width * height, 1, width, mark_free)) {
+                cerr << "Error: Could not integrate the voxel grid into the octree!" << endl;
+                exit(1);
+            }
+            cout << "done";
+        }
+        else {
+            needs_pruning = true;
+        }
+
         cout << endl << endl;
 
         input->close();
@@ -293,9 +335,11 @@ int main(int argc, char **argv)
     }
 
     // prune octree
-    cout << "Pruning octree" << endl << endl;
-    tree->updateInnerOccupancy();
-    tree->prune();
+    if (needs_pruning) {
+        cout << "Pruning octree" << endl << endl;
+        tree->updateInnerOccupancy();
+        tree->prune();
+    }
 
     // write octree to file
     if(output_filename.empty()) {
@@ -36,33 +36,40 @@
 #include <iostream>
 #include <string.h>
 #include <stdlib.h>
-#include <list>
 
 using namespace std;
 using namespace octomap;
 
 void printUsage(char* self){
-  std::cerr << "\nUSAGE: " << self << " input.bt\n\n";
+  std::cerr << "\nUSAGE: " << self << " input.bt [output.wrl|output.ply|output.obj]\n\n";
 
   std::cerr << "This tool will convert the occupied voxels of a binary OctoMap \n"
-      "file input.bt to a VRML2.0 file input.bt.wrl.\n\n";
-
-  std::cerr << "WARNING: The output files will be quite large!\n\n";
+      "file input.bt to a mesh of their exposed faces, written as VRML2.0 \n"
+      "IndexedFaceSet (default: input.bt.wrl), binary PLY or OBJ file.\n\n";
 
   exit(0);
 }
 
 int main(int argc, char** argv) {
   // default values:
-  string vrmlFilename = "";
+  string meshFilename = "";
   string btFilename = "";
 
-  if (argc != 2 || (argc > 1 && strcmp(argv[1], "-h") == 0)){
+  if (argc < 2 || argc > 3 || strcmp(argv[1], "-h") == 0){
     printUsage(argv[0]);
   }
 
   btFilename = std::string(argv[1]);
-  vrmlFilename = btFilename + ".wrl";
+  if (argc == 3)
+    meshFilename = std::string(argv[2]);
+  else
+    meshFilename = btFilename + ".wrl";
+
+  string extension = meshFilename.substr(meshFilename.find_last_of('.') + 1);
+  if (extension != "wrl" && extension != "ply" && extension != "obj"){
+    OCTOMAP_ERROR("Output file has to end in .wrl, .ply or .obj, exiting.\n");
+    exit(1);
+  }
 
 
   cout << "\nReading OcTree file\n===========================\n";
@@ -70,33 +77,27 @@ int main(int argc, char** argv) {
   OcTree* tree = new OcTree(btFilename);
 
 
-  cout << "\nWriting occupied volumes to VRML\n===========================\n";
-
-  std::ofstream outfile (vrmlFilename.c_str());
-
-  outfile << "#VRML V2.0 utf8\n#\n";
-  outfile << "# created from OctoMap file "<<btFilename<< " with bt2vrml\n";
-
-
-  size_t count(0);
-  for(OcTree::leaf_iterator it = tree->begin(), end=tree->end(); it!= end; ++it) {
-    if(tree->isNodeOccupied(*it)){
-      count++;
-      double size = it.getSize();
-      outfile << "Transform { translation "
-          << it.getX() << " " << it.getY() << " " << it.getZ()
-          << " \n  children ["
-          << " Shape { geometry Box { size "
-          << size << " " << size << " " << size << "} } ]\n"
-          << "}\n";
-    }
-  }
+  cout << "\nWriting exposed faces of occupied volumes\n===========================\n";
 
+  IndexedMesh mesh;
+  tree->getVoxelSurfaceMesh(mesh);
   delete tree;
 
-  outfile.close();
+  bool ok;
+  if (extension == "ply")
+    ok = mesh.writePly(meshFilename);
+  else if (extension == "obj")
+    ok = mesh.writeObj(meshFilename);
+  else
+    ok = mesh.writeVrml(meshFilename);
+
+  if (!ok){
+    OCTOMAP_ERROR("Error writing output file.\n");
+    exit(1);
+  }
 
-  std::cout << "Finished writing "<< count << " voxels to " << vrmlFilename << std::endl;
+  std::cout << "Finished writing "<< mesh.getNumTriangles() << " triangles ("
+            << mesh.getNumVertices() << " vertices) to " << meshFilename << std::endl;
 
   return 0;
 }
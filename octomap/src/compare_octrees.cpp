@@ -36,7 +36,6 @@
 #include <iostream>
 #include <string.h>
 #include <stdlib.h>
-#include <list>
 #include <cmath>
 
 #ifdef _MSC_VER // fix missing isnan for VC++
@@ -51,7 +50,7 @@ using namespace octomap;
 void printUsage(char* self){
   std::cerr << "\nUSAGE: " << self << " tree1.ot tree2.ot\n\n";
 
-  std::cerr << "Compare two octrees for accuracy / compression.\n\n";
+  std::cerr << "Compare two octrees for accuracy / compression and report the changes.\n\n";
 
   exit(0);
 }
@@ -70,90 +69,33 @@ int main(int argc, char** argv) {
   OcTree* tree1 = dynamic_cast<OcTree*>(OcTree::read(filename1));
   OcTree* tree2 = dynamic_cast<OcTree*>(OcTree::read(filename2));
 
-  if (fabs(tree1->getResolution()-tree2->getResolution()) > 1e-6){
+  cout << "Comparing trees... \n";
+  OcTreeDiff diff;
+  if (!tree1->diff(*tree2, diff)){
     OCTOMAP_ERROR("Error: Tree resolutions don't match!");
     exit(-1);
   }
 
-
-  cout << "Expanding octrees... \n";
-  // expand both to full resolution:
-  tree1->expand();
-  tree2->expand();
-
-  if (tree1->getNumLeafNodes() != tree2->getNumLeafNodes()){
-      OCTOMAP_ERROR_STR("Octrees have different size: " << tree1->getNumLeafNodes() << "!=" <<tree2->getNumLeafNodes() << endl);
-      exit(-1);
-  }
-
-  cout << "Expanded num. leafs: " << tree1->getNumLeafNodes() << endl;
-
-  // check bbx:
-  double x1, x2, y1, y2, z1, z2;
-  tree1->getMetricSize(x1, y1, z1);
-  tree2->getMetricSize(x2, y2, z2);
-
-  if ((fabs(x1-x2) > 1e-6)
-      || (fabs(y1-y2) > 1e-6)
-      || (fabs(z1-z2) > 1e-6))
-  {
-    OCTOMAP_WARNING("Trees span over different volumes, results may be wrong\n");
-    exit(1);
-  }
-
-  double kld_sum = 0.0;
-  cout << "Comparing trees... \n";
-  for (OcTree::leaf_iterator it = tree1->begin_leafs(),
-      end = tree1->end_leafs();  it != end; ++it)
-  {
-    OcTreeNode* n = tree2->search(it.getKey());
-    if (!n){
-      OCTOMAP_ERROR("Could not find coordinate of 1st octree in 2nd octree\n");
-    } else{
-      // check occupancy prob:
-      double p1 = it->getOccupancy();
-      double p2 = n->getOccupancy();
-      if (p1 < 0.0 || p1 > 1.0)
-        OCTOMAP_ERROR("p1 wrong: %f", p1);
-      if (p2 < 0.0 || p2 > 1.0)
-        OCTOMAP_ERROR("p2 wrong: %f", p2);
-
-//      if (p1 > 0.1 || p2 > 0.1)
-      if (p1 > 0.001 && p2 < 0.001)
-        OCTOMAP_WARNING("p2 near 0, p1 > 0 => inf?");
-      if (p1 < 0.999 && p2 > 0.999)
-         OCTOMAP_WARNING("p2 near 1, p1 < 1 => inf?");
-
-      double kld = 0;
-      if (p1 < 0.0001)
-        kld =log((1-p1)/(1-p2))*(1-p1);
-      else if (p1 > 0.9999)
-        kld =log(p1/p2)*p1;
-      else
-        kld +=log(p1/p2)*p1 + log((1-p1)/(1-p2))*(1-p1);
-
 #if __cplusplus >= 201103L
-      if (std::isnan(kld)){
+  if (std::isnan(diff.kld)){
 #else
-      if (isnan(kld)){
+  if (isnan(diff.kld)){
 #endif
-        OCTOMAP_ERROR("KLD is nan! KLD(%f,%f)=%f; sum = %f", p1, p2, kld, kld_sum);
-        exit(-1);
-      }
-
-      kld_sum+=kld;
+    OCTOMAP_ERROR("KLD is nan!");
+    exit(-1);
+  }
 
-      //if (p1 <)
-//      if (fabs(p1-p2) > 1e-6)
-//        cout << "diff: " << p1-p2 << endl;
+  const char* states[3] = {"unknown", "free", "occupied"};
+  cout << "Volume (m^3) by state in tree1 -> tree2:\n";
+  for (unsigned int i = 0; i < 3; ++i){
+    for (unsigned int j = 0; j < 3; ++j){
+      if (i != 0 || j != 0)
+        cout << "  " << states[i] << " -> " << states[j] << ": " << diff.volume[i][j] << endl;
     }
-
-
   }
-
-  cout << "KLD: " << kld_sum << endl;
-
-
+  cout << "Changed volume: " << diff.getChangedVolume() << " m^3 in " << diff.regions.size() << " regions\n";
+  cout << "Volume with changed values only: " << diff.value_changed_volume << " m^3\n";
+  cout << "KLD: " << diff.kld << endl;
 
   delete tree1;
   delete tree2;
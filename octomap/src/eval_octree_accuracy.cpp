@@ -42,6 +42,45 @@
 using namespace std;
 using namespace octomap;
 
+/// Reads the scans of a binary graph file one at a time, only the current scan is kept in memory
+class ScanStream {
+public:
+  ScanStream(const std::string& filename)
+    : file(filename.c_str(), std::ios_base::binary), num_scans(0), num_read(0) {}
+
+  /// (re-)opens the stream at the first scan, returns false on errors
+  bool rewind() {
+    file.clear();
+    file.seekg(0);
+    num_scans = 0;
+    num_read = 0;
+    file.read((char*) &num_scans, sizeof(num_scans));
+    return file.good();
+  }
+
+  /// reads the next scan into node, returns false at the end of the graph or on errors
+  bool next(ScanNode& node) {
+    if (num_read >= num_scans)
+      return false;
+    delete node.scan;
+    node.scan = NULL;
+    node.readBinary(file);
+    if (file.fail()) {
+      OCTOMAP_ERROR("Error reading scan %u from graph file.\n", num_read + 1);
+      return false;
+    }
+    num_read++;
+    return true;
+  }
+
+  unsigned int size() const { return num_scans; }
+
+private:
+  std::ifstream file;
+  unsigned int num_scans;
+  unsigned int num_read;
+};
+
 void printUsage(char* self){
   std::cerr << "USAGE: " << self << " <InputFile.graph>\n";
   std::cerr << "This tool is part of OctoMap and evaluates the statistical accuracy\n"
@@ -85,32 +124,29 @@ int main(int argc, char** argv) {
     }
   }
 
+  // scans are streamed from the graph file twice (mapping, evaluation) instead of
+  // keeping the whole graph in memory
   cout << "\nReading Graph file\n===========================\n";
-  ScanGraph* graph = new ScanGraph();
-  if (!graph->readBinary(graphFilename))
+  ScanStream graph(graphFilename);
+  if (!graph.rewind()) {
+    OCTOMAP_ERROR_STR("Could not read graph file " << graphFilename);
     exit(2);
-  
-  size_t num_points_in_graph = 0;
-  if (max_scan_no > 0) {
-    num_points_in_graph = graph->getNumPoints(max_scan_no-1);
-    cout << "\n Data points in graph up to scan " << max_scan_no << ": " << num_points_in_graph << endl;
-  }
-  else {
-    num_points_in_graph = graph->getNumPoints();
-    cout << "\n Data points in graph: " << num_points_in_graph << endl;
   }
 
   cout << "\nCreating tree\n===========================\n";
   OcTree* tree = new OcTree(res);
 
-  size_t numScans = graph->size();
+  size_t numScans = graph.size();
+  size_t num_points_in_graph = 0;
   unsigned int currentScan = 1;
-  for (ScanGraph::iterator scan_it = graph->begin(); scan_it != graph->end(); scan_it++) {
+  ScanNode node;
+  while (graph.next(node)) {
+    num_points_in_graph += node.scan->size();
 
     if (currentScan % skip_scan_eval != 0){
       if (max_scan_no > 0) cout << "("<<currentScan << "/" << max_scan_no << ") " << flush;
       else cout << "("<<currentScan << "/" << numScans << ") " << flush;
-      tree->insertPointCloud(**scan_it, maxrange);
+      tree->insertPointCloud(node, maxrange);
     } else
       cout << "(SKIP) " << flush;
 
@@ -120,77 +156,43 @@ int main(int argc, char** argv) {
     currentScan++;
   }
 
-  tree->expand();
+  if (max_scan_no > 0)
+    cout << "\n Data points in graph up to scan " << max_scan_no << ": " << num_points_in_graph << endl;
+  else
+    cout << "\n Data points in graph: " << num_points_in_graph << endl;
 
-  
+  // inner nodes are up to date after insertPointCloud, so the tree is queried
+  // without expanding it
   cout << "\nEvaluating scans\n===========================\n";
+  graph.rewind();
   currentScan = 1;
-  size_t num_points = 0;
-  size_t num_voxels_correct = 0;
-  size_t num_voxels_wrong = 0;
-  size_t num_voxels_unknown = 0;
-
+  ScanEvaluation evaluation;
 
-  for (ScanGraph::iterator scan_it = graph->begin(); scan_it != graph->end(); scan_it++) {
+  while (graph.next(node)) {
 
     if (currentScan % skip_scan_eval == 0){
       if (max_scan_no > 0) cout << "("<<currentScan << "/" << max_scan_no << ") " << flush;
       else cout << "("<<currentScan << "/" << numScans << ") " << flush;
 
-
-      pose6d frame_origin = (*scan_it)->pose;
-      point3d sensor_origin = frame_origin.inv().transform((*scan_it)->pose.trans());
-
       // transform pointcloud:
-      Pointcloud scan (*(*scan_it)->scan);
-      scan.transform(frame_origin);
-      point3d origin = frame_origin.transform(sensor_origin);
-
-      KeySet free_cells, occupied_cells;
-      tree->computeUpdate(scan, origin, free_cells, occupied_cells, maxrange);
-
-      num_points += scan.size();
-
-      // count free cells
-      for (KeySet::iterator it = free_cells.begin(); it != free_cells.end(); ++it) {
-        OcTreeNode* n = tree->search(*it);
-        if (n){
-          if (tree->isNodeOccupied(n))
-            num_voxels_wrong++;
-          else
-            num_voxels_correct++;
-        } else
-          num_voxels_unknown++;
-      } // count occupied cells
-      for (KeySet::iterator it = occupied_cells.begin(); it != occupied_cells.end(); ++it) {
-        OcTreeNode* n = tree->search(*it);
-        if (n){
-          if (tree->isNodeOccupied(n))
-            num_voxels_correct++;
-          else
-            num_voxels_wrong++;
-        } else
-          num_voxels_unknown++;
-      }
-
-
+      node.scan->transform(node.pose);
+      tree->evaluateScan(*node.scan, node.pose.trans(), maxrange, evaluation);
     }
 
     if ((max_scan_no > 0) && (currentScan == (unsigned int) max_scan_no))
       break;
 
     currentScan++;
-
-
   }
 
-  cout << "\nFinished evaluating " << num_points <<"/"<< num_points_in_graph << " points.\n"
+  size_t num_voxels_correct = evaluation.getNumCorrect();
+  size_t num_voxels_wrong = evaluation.getNumWrong();
+  size_t num_voxels_unknown = evaluation.getNumUnknown();
+  cout << "\nFinished evaluating " << evaluation.num_points <<"/"<< num_points_in_graph << " points.\n"
       <<"Voxels correct: "<<num_voxels_correct<<" #wrong: " <<num_voxels_wrong << " #unknown: " <<num_voxels_unknown
       <<". % correct: "<< num_voxels_correct/double(num_voxels_correct+num_voxels_wrong)<<"\n\n";
 
-
-  delete graph;
   delete tree;
-  
+
   return 0;
 }
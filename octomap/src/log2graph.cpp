@@ -34,6 +34,7 @@
 #include <octomap/octomap.h>
 #include <string.h>
 #include <stdlib.h>
+#include <fstream>
 
 using namespace std;
 using namespace octomap;
@@ -66,13 +67,24 @@ int main(int argc, char** argv) {
     graphFilename = std::string(argv[2]);
   }
 
-  cout << "\nReading Log file\n===========================\n";
-  ScanGraph* graph = new ScanGraph();
-  graph->readPlainASCII(logFilename);
+  // the log is converted while reading, without building the graph in memory
+  cout << "\nConverting Log file\n===========================\n";
+  std::ifstream logFile(logFilename.c_str(), std::ios_base::binary);
+  if (!logFile.is_open()){
+    OCTOMAP_ERROR_STR("Filestream to "<< logFilename << " not open, nothing read.");
+    exit(1);
+  }
+
+  ScanGraphWriter writer(graphFilename);
+  if (!writer.isOpen())
+    exit(1);
+
+  ScanLogReader reader;
+  bool ok = reader.read(logFile, writer);
+  ok = writer.close() && ok;
 
-  cout << "\nWriting binary graph file\n===========================\n";
+  cout << "Wrote " << writer.getNumNodes() << " nodes with " << writer.getNumPoints()
+       << " points to " << graphFilename << endl;
 
-  graph->writeBinary(graphFilename);
-  
-  return 0;
+  return ok ? 0 : 1;
 }
@@ -109,4 +109,14 @@ int main(int argc, char** argv) {
   } else{
     cout << "query point unknown (no normals)\n";
   }
+
+  // normals of all occupied voxels at once
+  point3d_collection centers;
+  point3d_collection leaf_normals;
+  tree.getLeafNormals(centers, leaf_normals);
+  unsigned int num_surface = 0;
+  for (unsigned i = 0; i < leaf_normals.size(); ++i)
+    if (leaf_normals[i].norm() > 0.0)
+      num_surface++;
+  cout << endl << num_surface << " of " << centers.size() << " occupied leaves are at the surface" << endl;
 }
@@ -43,8 +43,8 @@ using namespace std;
 using namespace octomap;
 
 void printUsage(char* self){
-  cerr << "USAGE: " << self << " <InputFile.bt> <OutputFile.pcd>\n";
-  cerr << "This tool creates a point cloud of the occupied cells\n";
+  cerr << "USAGE: " << self << " <InputFile.bt> <OutputFile.pcd|.ply>\n";
+  cerr << "This tool creates a point cloud of the occupied cells (binary PCD or PLY)\n";
   exit(0);
 }
 
@@ -56,59 +56,38 @@ int main(int argc, char** argv) {
   string inputFilename = argv[1];
   string outputFilename = argv[2];
 
+  PointCloudWriter::Format format;
+  if (!PointCloudWriter::formatFromFilename(outputFilename, format)){
+    OCTOMAP_ERROR("Output file has to end in .pcd or .ply, exiting.\n");
+    exit(1);
+  }
+
   OcTree* tree = new OcTree(0.1);
   if (!tree->readBinary(inputFilename)){
     OCTOMAP_ERROR("Could not open file, exiting.\n");
     exit(1);
   }
 
-  unsigned int maxDepth = tree->getTreeDepth();
-  cout << "tree depth is " << maxDepth << endl;
-  
-  // expand collapsed occupied nodes until all occupied leaves are at maximum depth
-  vector<OcTreeNode*> collapsed_occ_nodes;
-  do {
-    collapsed_occ_nodes.clear();
-    for (OcTree::iterator it = tree->begin(); it != tree->end(); ++it)
-    {
-      if(tree->isNodeOccupied(*it) && it.getDepth() < maxDepth)
-      {
-        collapsed_occ_nodes.push_back(&(*it));
-      }
-    }
-    for (vector<OcTreeNode*>::iterator it = collapsed_occ_nodes.begin(); it != collapsed_occ_nodes.end(); ++it)
-    {
-      tree->expandNode(*it);
-    }
-    cout << "expanded " << collapsed_occ_nodes.size() << " nodes" << endl;
-  } while(collapsed_occ_nodes.size() > 0);
+  cout << "tree depth is " << tree->getTreeDepth() << endl;
 
-  vector<point3d> pcl;
-  for (OcTree::iterator it = tree->begin(); it != tree->end(); ++it)
-  {
-    if(tree->isNodeOccupied(*it))
-    {
-      pcl.push_back(it.getCoordinate());
-    }
+  ofstream f(outputFilename.c_str(), ofstream::out | ofstream::binary);
+  if (!f.is_open()){
+    OCTOMAP_ERROR("Could not open output file, exiting.\n");
+    exit(1);
   }
 
+  // occupied leafs are enumerated at the finest resolution without expanding the tree
+  PointCloudWriter writer(f, format);
+  size_t num_points = tree->writeOccupiedVoxelCenters(writer);
+  bool ok = writer.finish();
+  f.close();
   delete tree;
 
-  ofstream f(outputFilename.c_str(), ofstream::out);
-  f << "# .PCD v0.7" << endl
-    << "VERSION 0.7" << endl
-    << "FIELDS x y z" << endl
-    << "SIZE 4 4 4" << endl
-    << "TYPE F F F" << endl
-    << "COUNT 1 1 1" << endl
-    << "WIDTH " << pcl.size() << endl
-    << "HEIGHT 1" << endl
-    << "VIEWPOINT 0 0 0 0 0 0 1" << endl
-    << "POINTS " << pcl.size() << endl
-    << "DATA ascii" << endl;
-  for (size_t i = 0; i < pcl.size(); i++)
-      f << pcl[i].x() << " " << pcl[i].y() << " " << pcl[i].z() << endl;
-  f.close();
-  
+  if (!ok || !f.good()){
+    OCTOMAP_ERROR("Error writing output file.\n");
+    exit(1);
+  }
+  cout << "wrote " << num_points << " points to " << outputFilename << endl;
+
   return 0;
 }
@@ -190,5 +190,130 @@ int main(int argc, char** argv) {
     
   }
 
+  // colored point cloud insertion
+  {
+    std::cout << "\nColored point cloud\n===============================\n";
+    Pointcloud cloud;
+    std::vector<ColorOcTreeNode::Color> colors;
+    for (int x=-10; x<10; x++) {
+      for (int y=-10; y<10; y++) {
+        cloud.push_back((float) x*0.05f+0.01f, (float) y*0.05f+0.01f, 1.01f);
+        colors.push_back(ColorOcTreeNode::Color(x*10+100, y*10+100, 50));
+      }
+    }
+    // second point in the first voxel
+    cloud.push_back(-0.48f, -0.48f, 1.02f);
+    colors.push_back(ColorOcTreeNode::Color(200, 200, 250));
+    point3d origin (0.0f, 0.0f, 0.0f);
+
+    ColorOcTree single_pass (res);
+    single_pass.insertPointCloud(cloud, colors, origin);
+
+    // same as inserting the cloud and integrating the colors of single points
+    ColorOcTree two_pass (res);
+    two_pass.insertPointCloud(cloud, origin);
+    for (size_t i = 1; i < cloud.size() - 1; ++i)
+      two_pass.integrateNodeColor(cloud[i].x(), cloud[i].y(), cloud[i].z(), colors[i].r, colors[i].g, colors[i].b);
+    two_pass.integrateNodeColor(-0.49f, -0.49f, 1.01f, 100, 100, 150);
+    two_pass.updateInnerOccupancy();
+
+    EXPECT_EQ(single_pass.size(), single_pass.calcNumNodes());
+    EXPECT_EQ(single_pass.size(), two_pass.size());
+    EXPECT_TRUE(single_pass == two_pass);
+    size_t num_leafs = 0;
+    for (ColorOcTree::tree_iterator it = two_pass.begin_tree(); it != two_pass.end_tree(); ++it) {
+      ColorOcTreeNode* node = (it.getDepth() == 0) ? single_pass.getRoot()
+                                                   : single_pass.search(it.getKey(), it.getDepth());
+      EXPECT_TRUE(node);
+      EXPECT_EQ(node->getLogOdds(), it->getLogOdds());
+      EXPECT_EQ(node->getColor(), it->getColor());
+      ++num_leafs;
+    }
+    EXPECT_TRUE(num_leafs > cloud.size());
+    ColorOcTreeNode* averaged = single_pass.search(point3d(-0.49f, -0.49f, 1.01f));
+    EXPECT_TRUE(averaged);
+    EXPECT_EQ(averaged->getColor(), ColorOcTreeNode::Color(100, 100, 150));
+
+    // wrong number of colors
+    colors.pop_back();
+    ColorOcTree empty (res);
+    empty.insertPointCloud(cloud, colors, origin);
+    EXPECT_EQ(empty.size(), 0);
+  }
+
+  // lazy updates, inner nodes updated only on dirty paths
+  {
+    std::cout << "\nDirty inner nodes\n===============================\n";
+    Pointcloud cloud;
+    std::vector<ColorOcTreeNode::Color> colors;
+    for (int x=-20; x<20; x++) {
+      for (int y=-20; y<20; y++) {
+        cloud.push_back((float) x*0.05f+0.01f, (float) y*0.05f+0.01f, 2.01f);
+        colors.push_back(ColorOcTreeNode::Color(x*5+100, y*5+100, 50));
+      }
+    }
+    ColorOcTree lazy_tree (res);
+    ColorOcTree full_tree (res);
+    ColorOcTree* trees[2] = {&lazy_tree, &full_tree};
+    for (unsigned int i = 0; i < 2; ++i) {
+      trees[i]->insertPointCloud(cloud, colors, point3d(0.0f, 0.0f, 0.0f));
+      EXPECT_EQ(trees[i]->numDirtyKeys(), 0);
+      trees[i]->insertPointCloud(cloud, colors, point3d(0.5f, 0.0f, 0.0f), -1., true);
+      trees[i]->updateNode(point3d(-3.0f, -3.0f, -3.0f), true, true);
+      trees[i]->setNodeColor(0.01f, 0.01f, 2.01f, 255, 0, 0, true);
+    }
+    EXPECT_TRUE(lazy_tree.numDirtyKeys() > 10000);
+    // dirty keys are distinct and only recorded with lazy_eval
+    size_t num_dirty = lazy_tree.numDirtyKeys();
+    lazy_tree.setNodeColor(0.01f, 0.01f, 2.01f, 255, 0, 0, true);
+    lazy_tree.setNodeColor(0.01f, 0.01f, 2.01f, 255, 0, 0);
+    EXPECT_EQ(lazy_tree.numDirtyKeys(), num_dirty);
+
+    lazy_tree.updateDirtyInnerOccupancy();
+    EXPECT_EQ(lazy_tree.numDirtyKeys(), 0);
+    full_tree.updateInnerOccupancy();
+    full_tree.prune();
+    EXPECT_EQ(lazy_tree.size(), lazy_tree.calcNumNodes());
+    EXPECT_EQ(lazy_tree.size(), full_tree.size());
+    EXPECT_TRUE(lazy_tree == full_tree);
+    EXPECT_EQ(lazy_tree.getRoot()->getColor(), full_tree.getRoot()->getColor());
+
+    full_tree.updateNode(point3d(-3.0f, -3.0f, -3.0f), true, true);
+    EXPECT_EQ(full_tree.numDirtyKeys(), 1);
+    full_tree.clear();
+    EXPECT_EQ(full_tree.numDirtyKeys(), 0);
+  }
+
+  // colored scans crop the rolling local map, cropped inner nodes keep consistent colors
+  {
+    std::cout << "\nColored local map\n===============================\n";
+    Pointcloud cloud;
+    std::vector<ColorOcTreeNode::Color> colors;
+    for (int x=-20; x<20; x++) {
+      for (int y=-20; y<20; y++) {
+        cloud.push_back((float) x*0.05f+0.01f, (float) y*0.05f+0.01f, 2.01f);
+        colors.push_back(ColorOcTreeNode::Color(x*5+100, y*5+100, 50));
+      }
+    }
+    ColorOcTree local_tree (res);
+    ColorOcTree spill (res);
+    local_tree.setLocalMapRadius(3.0, &spill);
+    for (int i = 0; i < 3; ++i)
+      local_tree.insertPointCloud(cloud, colors, point3d(0.0f, 0.0f, 0.0f), pose6d(i * 4.0f, 0.0f, 0.0f, 0.0, 0.0, 0.0));
+    EXPECT_TRUE(spill.size() > 0);
+    for (ColorOcTree::leaf_iterator it = local_tree.begin_leafs(); it != local_tree.end_leafs(); ++it)
+      EXPECT_TRUE((it.getCoordinate() - point3d(8.0f, 0.0f, 0.0f)).norm() < 6.0);
+
+    ColorOcTree* trees[2] = {&local_tree, &spill};
+    for (unsigned int i = 0; i < 2; ++i) {
+      for (ColorOcTree::tree_iterator it = trees[i]->begin_tree(); it != trees[i]->end_tree(); ++it) {
+        if (!trees[i]->nodeHasChildren(&(*it)))
+          continue;
+        EXPECT_EQ(it->getColor(), it->getAverageChildColor());
+        EXPECT_FLOAT_EQ(it->getLogOdds(), it->getMaxChildLogOdds());
+      }
+    }
+  }
+
   return 0;
 }
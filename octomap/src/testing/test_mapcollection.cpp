@@ -1,5 +1,9 @@
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
 #include <octomap/MapCollection.h>
 #include <octomap/math/Utils.h>
 #include "testing.h"
@@ -83,6 +87,117 @@ int main(int argc, char** argv) {
     printf("in fact, it has an occupancy probability of %0.2f\n", collection.getOccupancy(q));
   }
 
+  // add some smaller node maps at other poses so that the spatial index has to split
+  for (int i = 0; i < 12; ++i) {
+    OcTree* tree = new OcTree(0.1);
+    for (float x = -0.5f; x < 0.5f; x += 0.1f)
+      for (float y = -0.5f; y < 0.5f; y += 0.1f)
+        tree->updateNode(point3d(x, y, (i % 3) * 0.1f), i % 2 == 0);
+    MapNode<OcTree>* mn = new MapNode<OcTree>(tree, pose6d(i * 1.5, -(i % 4) * 2.0, 0.5, 0.0, 0.0, i * 0.3));
+    collection.addNode(mn);
+  }
+  collection.addNode(new MapNode<OcTree>(new OcTree(0.1), pose6d(0.0,0.0,0.0,0.0,0.0,0.0)));
+
+  // indexed queries (single and batch) have to match a brute-force search over all nodes
+  point3d_collection samples;
+  for (int i = 0; i < 4000; ++i) {
+    samples.push_back(point3d(-20.f + 40.f * (float) rand() / RAND_MAX,
+                              -20.f + 40.f * (float) rand() / RAND_MAX,
+                              -5.f + 10.f * (float) rand() / RAND_MAX));
+  }
+  std::vector<bool> batch_occupied;
+  std::vector<double> batch_occupancies;
+  collection.isOccupied(samples, batch_occupied);
+  collection.getOccupancy(samples, batch_occupancies);
+  EXPECT_EQ(batch_occupied.size(), samples.size());
+  EXPECT_EQ(batch_occupancies.size(), samples.size());
+  unsigned int num_known = 0;
+  for (unsigned int i = 0; i < samples.size(); ++i) {
+    bool occupied = false;
+    bool known = false;
+    double occupancy = 0.0;
+    for (MapCollection<MapNode<OcTree> >::iterator it = collection.begin(); it != collection.end(); ++it) {
+      point3d ptrans = (*it)->getOrigin().inv().transform(samples[i]);
+      OcTreeNode* n = (*it)->getMap()->search(ptrans);
+      if (!n) continue;
+      known = true;
+      occupied = occupied || (*it)->getMap()->isNodeOccupied(n);
+      occupancy = std::max(occupancy, n->getOccupancy());
+    }
+    if (!known) occupancy = 0.5;
+    else num_known++;
+
+    bool single_occupied = collection.isOccupied(samples[i]);
+    bool batch_ok = (batch_occupied[i] == occupied);
+    EXPECT_EQ(single_occupied, occupied);
+    EXPECT_TRUE(batch_ok);
+    EXPECT_FLOAT_EQ(collection.getOccupancy(samples[i]), occupancy);
+    EXPECT_FLOAT_EQ(batch_occupancies[i], occupancy);
+  }
+  EXPECT_TRUE(num_known > 0);
+
+  // editing a node map changes its bounds, queries only see them after updateIndex()
+  MapNode<OcTree>* edited = *(collection.end() - 1);
+  point3d far_point(40.f, 40.f, 40.f);
+  edited->getMap()->updateNode(far_point, true);
+  EXPECT_FALSE(collection.isOccupied(far_point));
+  collection.updateIndex();
+  EXPECT_TRUE(collection.isOccupied(far_point));
+
+  // older readers take each non-comment line as the next of ID, FILENAME and POSE,
+  // the bounds are only written as comments
+  std::ifstream index_file("writeout.txt");
+  std::string index_line;
+  const char* index_tags[3] = {"MAPNODEID ", "MAPNODEFILENAME ", "MAPNODEPOSE "};
+  unsigned int num_tag_lines = 0;
+  unsigned int num_bbx_lines = 0;
+  while (std::getline(index_file, index_line)) {
+    if (index_line.compare(0, 12, "#MAPNODEBBX ") == 0)
+      ++num_bbx_lines;
+    if (index_line.empty() || index_line[0] == '#')
+      continue;
+    std::string expected_tag(index_tags[num_tag_lines % 3]);
+    EXPECT_TRUE(index_line.compare(0, expected_tag.size(), expected_tag) == 0);
+    ++num_tag_lines;
+  }
+  EXPECT_TRUE(num_tag_lines > 0 && num_tag_lines % 3 == 0);
+  EXPECT_TRUE(num_bbx_lines > 0);
+
+  // reading lazily only instantiates the node maps that are actually queried
+  MapCollection<MapNode<OcTree> > eager_collection("writeout.txt");
+  MapCollection<MapNode<OcTree> > lazy_collection("writeout.txt", true);
+  EXPECT_TRUE(eager_collection.size() > 0);
+  EXPECT_EQ(lazy_collection.size(), eager_collection.size());
+  for (MapCollection<MapNode<OcTree> >::iterator it = lazy_collection.begin(); it != lazy_collection.end(); ++it)
+    EXPECT_FALSE((*it)->isLoaded());
+  for (MapCollection<MapNode<OcTree> >::iterator it = eager_collection.begin(); it != eager_collection.end(); ++it)
+    EXPECT_TRUE((*it)->isLoaded());
+  EXPECT_FALSE(lazy_collection.isOccupied(point3d(1000.f, 1000.f, 1000.f)));
+  for (MapCollection<MapNode<OcTree> >::iterator it = lazy_collection.begin(); it != lazy_collection.end(); ++it)
+    EXPECT_FALSE((*it)->isLoaded());
+
+  std::vector<double> eager_occupancies;
+  std::vector<double> lazy_occupancies;
+  eager_collection.getOccupancy(samples, eager_occupancies);
+  lazy_collection.getOccupancy(samples, lazy_occupancies);
+  for (unsigned int i = 0; i < samples.size(); ++i)
+    EXPECT_FLOAT_EQ(lazy_occupancies[i], eager_occupancies[i]);
+  for (MapCollection<MapNode<OcTree> >::iterator it = lazy_collection.begin(); it != lazy_collection.end(); ++it)
+    EXPECT_TRUE((*it)->isLoaded());
+
+  // node maps that cannot be read are skipped by queries and not read again
+  MapCollection<MapNode<OcTree> > broken_collection;
+  MapNode<OcTree>* broken = new MapNode<OcTree>("does_not_exist.bt", pose6d(0.0,0.0,0.0,0.0,0.0,0.0), true);
+  broken_collection.addNode(broken);
+  EXPECT_FALSE(broken_collection.isOccupied(point3d(0.f, 0.f, 0.f)));
+  EXPECT_FLOAT_EQ(broken_collection.getOccupancy(point3d(0.f, 0.f, 0.f)), 0.5);
+  EXPECT_TRUE(broken->loadFailed());
+  EXPECT_FALSE(broken->isLoaded());
+  EXPECT_FALSE(broken->loadMap());
+  std::vector<bool> broken_occupied;
+  broken_collection.isOccupied(samples, broken_occupied);
+  EXPECT_TRUE(std::find(broken_occupied.begin(), broken_occupied.end(), true) == broken_occupied.end());
+
   point3d ray_origin (0,0,10);
   point3d ray_direction (0,0,-10);
   point3d ray_end (100,100,100);
@@ -137,5 +252,59 @@ int main(int argc, char** argv) {
   }
 
 
+  // submaps of 4 consecutive scans, anchored at their first scan
+  ScanGraph graph;
+  for (unsigned int i = 0; i < 12; ++i) {
+    Pointcloud* scan = new Pointcloud();
+    for (float x = -0.4375f; x < 0.5f; x += 0.125f)
+      for (float y = -0.4375f; y < 0.5f; y += 0.125f)
+        scan->push_back(x, y, -1.0625f);
+    graph.addNode(scan, pose6d((float) (i % 4), 0.25f * (i / 4), 0.0f, 0.0, 0.0, 0.0));
+  }
+  MapCollection<MapNode<OcTree> > submaps;
+  EXPECT_EQ(submaps.addSubmaps(graph, 4, 0.125), 3u);
+  EXPECT_EQ(submaps.size(), 3u);
+  EXPECT_EQ((*submaps.begin())->getId(), std::string("0"));
+
+  // other nodes are not moved, even if their id equals a scan node id
+  MapNode<OcTree>* other = new MapNode<OcTree>(new OcTree(0.125), pose6d(0.0f, 0.0f, 5.0f, 0.0, 0.0, 0.0));
+  other->setId("4");
+  submaps.addNode(other);
+
+  // moving submaps only changes their origins
+  for (unsigned int i = 4; i < 8; ++i)
+    graph.getNodeByID(i)->pose.trans() += point3d(2.0f, 6.0f, 0.0f);
+  EXPECT_EQ(submaps.updateSubmapOrigins(graph), 3u);
+  EXPECT_NEAR(other->getOrigin().trans().z(), 5.0f, 1e-6);
+  EXPECT_NEAR(other->getOrigin().trans().x(), 0.0f, 1e-6);
+
+  // fused with structural merging, equals the map of all scans (no clamping here)
+  OcTree fused (0.125);
+  EXPECT_TRUE(submaps.fuse(fused));
+  OcTree rebuilt (0.125);
+  for (ScanGraph::iterator it = graph.begin(); it != graph.end(); ++it)
+    rebuilt.insertPointCloud(**it);
+  EXPECT_TRUE(rebuilt.size() > 0);
+  for (OcTree::leaf_iterator it = rebuilt.begin_leafs(); it != rebuilt.end_leafs(); ++it) {
+    OcTreeNode* n = fused.search(it.getKey());
+    EXPECT_TRUE(n);
+    EXPECT_NEAR(n->getLogOdds(), it->getLogOdds(), 1e-4);
+  }
+  for (OcTree::leaf_iterator it = fused.begin_leafs(); it != fused.end_leafs(); ++it) {
+    OcTreeNode* n = rebuilt.search(it.getKey());
+    EXPECT_TRUE(n);
+    EXPECT_NEAR(n->getLogOdds(), it->getLogOdds(), 1e-4);
+  }
+
+  // rotated submaps are queried lazily in their own frame
+  pose6d correction (0.0f, 0.0f, 0.0f, 0.0, 0.0, M_PI / 2);
+  for (unsigned int i = 8; i < 12; ++i)
+    graph.getNodeByID(i)->pose = correction * graph.getNodeByID(i)->pose;
+  EXPECT_EQ(submaps.updateSubmapOrigins(graph), 3u);
+  for (ScanGraph::iterator it = graph.begin(); it != graph.end(); ++it) {
+    for (Pointcloud::iterator p = (*it)->scan->begin(); p != (*it)->scan->end(); ++p)
+      EXPECT_TRUE(submaps.isOccupied((*it)->pose.transform(*p)));
+  }
+
   return 0;
 }
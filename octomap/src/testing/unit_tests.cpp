@@ -1,5 +1,10 @@
 #include <stdio.h>
 #include <string>
+#include <map>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <cstring>
 #ifdef _WIN32
   #include <Windows.h>  // to define Sleep()
 #else
@@ -9,6 +14,10 @@
 
 #include <octomap/octomap.h>
 #include <octomap/OcTreeStamped.h>
+#include <octomap/CountingOcTree.h>
+#include <octomap/SurfaceMesher.h>
+#include <octomap/OcTreeNeighborhood.h>
+#include <octomap/ScanReintegrator.h>
 #include <octomap/math/Utils.h>
 #include "testing.h"
  
@@ -200,6 +209,1386 @@ int main(int argc, char** argv) {
     EXPECT_FLOAT_EQ (0.025, p_inv.y());
     EXPECT_FLOAT_EQ (0.025, p_inv.z());
 
+  // ------------------------------------------------------------
+  } else if (test_name == "InformationGain") {
+    OcTree tree (0.1);
+    // known free space in +x direction, closed by a wall at x = 2
+    for (float y = -2.0f; y <= 2.0f; y += 0.05f) {
+      for (float z = -2.0f; z <= 2.0f; z += 0.05f) {
+        tree.insertRay(point3d(0.0f, 0.0f, 0.0f), point3d(2.0f, y, z));
+      }
+    }
+    FovSensorModel sensor (DEG2RAD(40.0), DEG2RAD(30.0), DEG2RAD(2.0), 5.0);
+    EXPECT_TRUE (sensor.getNumRays() > 0);
+
+    std::vector<pose6d> candidates;
+    candidates.push_back(pose6d(0.0, 0.0, 0.0, 0.0, 0.0, 0.0));    // facing the wall
+    candidates.push_back(pose6d(0.0, 0.0, 0.0, 0.0, 0.0, M_PI));   // facing unknown space
+    candidates.push_back(pose6d(50.0, 0.0, 0.0, 0.0, 0.0, 0.0));   // unknown area
+    candidates.push_back(pose6d(0.0, 0.0, 0.0, 0.0, 0.0, M_PI_2)); // partly known space
+    std::vector<double> gains;
+    tree.computeInformationGain(candidates, sensor, gains);
+    EXPECT_EQ (gains.size(), candidates.size());
+    EXPECT_EQ (gains[0], 0.0);
+    EXPECT_TRUE (gains[1] > 0.0);
+    EXPECT_EQ (gains[1], gains[2]);
+    EXPECT_TRUE (gains[3] > 0.0);
+    EXPECT_TRUE (gains[3] < gains[2]);
+
+    // searchWithDepth reports the size of unknown space
+    unsigned int depth;
+    EXPECT_FALSE (tree.searchWithDepth(tree.coordToKey(point3d(-1000.0f, 0.0f, 0.0f)), depth));
+    EXPECT_EQ (depth, 1u);
+    EXPECT_TRUE (tree.searchWithDepth(tree.coordToKey(point3d(1.0f, 0.0f, 0.0f)), depth));
+    EXPECT_TRUE (depth <= tree.getTreeDepth());
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Projection2D") {
+    OcTree tree (0.1);
+    // free floor area with a box obstacle of 0.4m height
+    for (float x = -1.0f; x < 1.0f; x += 0.05f) {
+      for (float y = -1.0f; y < 1.0f; y += 0.05f) {
+        tree.updateNode(point3d(x, y, 0.05f), false);
+      }
+    }
+    for (float x = 0.3f; x < 0.6f; x += 0.05f) {
+      for (float y = 0.3f; y < 0.6f; y += 0.05f) {
+        for (float z = 0.05f; z < 0.4f; z += 0.05f) {
+          tree.updateNode(point3d(x, y, z), true);
+        }
+      }
+    }
+    tree.prune();
+
+    OccupancyGrid2D grid;
+    EXPECT_TRUE (tree.project2D(point3d(-2.0f, -2.0f, 0.0f), point3d(1.95f, 1.95f, 1.0f), grid));
+    EXPECT_EQ (grid.getSizeX(), 40u);
+    EXPECT_EQ (grid.getSizeY(), 40u);
+    unsigned int x, y;
+    EXPECT_TRUE (grid.coordToCell(0.45, 0.45, x, y));
+    EXPECT_EQ (grid.getOccupancy(x, y), (signed char) OccupancyGrid2D::OCCUPIED);
+    EXPECT_NEAR (grid.getMinHeight(x, y), 0.0, 1e-5);
+    EXPECT_NEAR (grid.getMaxHeight(x, y), 0.4, 1e-5);
+    EXPECT_TRUE (grid.coordToCell(-0.55, 0.05, x, y));
+    EXPECT_EQ (grid.getOccupancy(x, y), (signed char) OccupancyGrid2D::FREE);
+    EXPECT_TRUE (grid.coordToCell(-1.55, -1.55, x, y));
+    EXPECT_EQ (grid.getOccupancy(x, y), (signed char) OccupancyGrid2D::UNKNOWN);
+
+    // height band above the obstacle
+    OccupancyGrid2D grid_high;
+    EXPECT_TRUE (tree.project2D(point3d(-2.0f, -2.0f, 0.5f), point3d(1.95f, 1.95f, 1.0f), grid_high));
+    EXPECT_TRUE (grid_high.coordToCell(0.45, 0.45, x, y));
+    EXPECT_EQ (grid_high.getOccupancy(x, y), (signed char) OccupancyGrid2D::UNKNOWN);
+
+    // incremental update matches a full projection
+    tree.enableChangeDetection(true);
+    for (float z = 0.05f; z < 0.8f; z += 0.1f) {
+      tree.updateNode(point3d(-0.55f, 0.05f, z), true);
+    }
+    tree.updateNode(point3d(1.5f, 1.5f, 0.05f), false);
+    tree.updateProjection2D(grid);
+    tree.resetChangeDetection();
+    OccupancyGrid2D grid_full;
+    tree.project2D(point3d(-2.0f, -2.0f, 0.0f), point3d(1.95f, 1.95f, 1.0f), grid_full);
+    EXPECT_TRUE (grid.occupancy == grid_full.occupancy);
+    EXPECT_TRUE (grid.coordToCell(-0.55, 0.05, x, y));
+    EXPECT_EQ (grid.getOccupancy(x, y), (signed char) OccupancyGrid2D::OCCUPIED);
+    EXPECT_NEAR (grid.getMaxHeight(x, y), 0.8, 1e-5);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Merge") {
+    OcTree tree_a (0.1);
+    OcTree tree_b (0.1);
+    // overlapping scans, each tree also has a pruned uniform block
+    for (float y = -1.0f; y <= 1.0f; y += 0.1f) {
+      tree_a.insertRay(point3d(0.0f, 0.0f, 0.0f), point3d(1.5f, y, 0.2f));
+      tree_b.insertRay(point3d(0.5f, 0.0f, 0.0f), point3d(0.5f, y, 1.0f));
+    }
+    for (float x = 0.0f; x < 0.8f; x += 0.1f)
+      for (float y = 0.0f; y < 0.8f; y += 0.1f)
+        for (float z = -0.8f; z < 0.0f; z += 0.1f)
+          tree_b.updateNode(point3d(x + 0.05f, y + 0.05f, z + 0.05f), true);
+    tree_a.prune();
+    tree_b.prune();
+
+    // reference: leaf-by-leaf updates at the finest resolution
+    OcTree reference (tree_a);
+    for (OcTree::leaf_iterator it = tree_b.begin_leafs(); it != tree_b.end_leafs(); ++it) {
+      unsigned int width = 1 << (tree_b.getTreeDepth() - it.getDepth());
+      OcTreeKey min_key = tree_b.adjustKeyAtDepth(it.getKey(), it.getDepth());
+      for (unsigned int i = 0; i < 3; ++i)
+        min_key[i] -= width / 2;
+      OcTreeKey k;
+      for (k[0] = min_key[0]; k[0] < min_key[0] + width; ++k[0])
+        for (k[1] = min_key[1]; k[1] < min_key[1] + width; ++k[1])
+          for (k[2] = min_key[2]; k[2] < min_key[2] + width; ++k[2])
+            reference.updateNode(k, it->getLogOdds(), true);
+    }
+    reference.updateInnerOccupancy();
+
+    OcTree merged (tree_a);
+    EXPECT_TRUE (merged.merge(tree_b));
+    EXPECT_EQ (merged.size(), merged.calcNumNodes());
+    OcTreeKey min_key = merged.coordToKey(point3d(-0.5f, -1.5f, -1.0f));
+    OcTreeKey max_key = merged.coordToKey(point3d(2.0f, 1.5f, 1.5f));
+    OcTreeKey k;
+    for (k[0] = min_key[0]; k[0] <= max_key[0]; ++k[0]) {
+      for (k[1] = min_key[1]; k[1] <= max_key[1]; ++k[1]) {
+        for (k[2] = min_key[2]; k[2] <= max_key[2]; ++k[2]) {
+          OcTreeNode* n_ref = reference.search(k);
+          OcTreeNode* n_merged = merged.search(k);
+          bool ref_known = (n_ref != NULL);
+          bool merged_known = (n_merged != NULL);
+          EXPECT_EQ (ref_known, merged_known);
+          if (n_ref)
+            EXPECT_NEAR (n_ref->getLogOdds(), n_merged->getLogOdds(), 1e-4);
+        }
+      }
+    }
+    merged.prune();
+    EXPECT_EQ (merged.size(), merged.calcNumNodes());
+
+    // merging into an empty tree copies the structure
+    OcTree copy (0.1);
+    EXPECT_TRUE (copy.merge(tree_b));
+    EXPECT_TRUE (copy == tree_b);
+
+    // overwrite: values known in the other tree replace existing ones
+    OcTree overwritten (tree_a);
+    overwritten.merge(tree_b, OcTree::MERGE_OVERWRITE);
+    for (OcTree::leaf_iterator it = tree_b.begin_leafs(); it != tree_b.end_leafs(); ++it) {
+      OcTreeNode* n = overwritten.search(it.getKey());
+      EXPECT_TRUE (n);
+      EXPECT_FLOAT_EQ (n->getLogOdds(), it->getLogOdds());
+    }
+
+    // incompatible trees are rejected
+    OcTree coarse (0.2);
+    EXPECT_FALSE (merged.merge(coarse));
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Transform") {
+    OcTree tree (0.1);
+    for (float y = -1.0f; y <= 1.0f; y += 0.05f)
+      tree.insertRay(point3d(0.05f, 0.05f, 0.05f), point3d(1.55f, y, 0.55f));
+    for (float x = -0.8f; x < 0.0f; x += 0.1f)
+      for (float y = 0.0f; y < 0.8f; y += 0.1f)
+        for (float z = 0.0f; z < 0.8f; z += 0.1f)
+          tree.updateNode(point3d(x + 0.05f, y + 0.05f, z + 0.05f), true);
+    tree.prune();
+
+    OcTreeKey min_key = tree.coordToKey(point3d(-2.0f, -2.0f, -1.0f));
+    OcTreeKey max_key = tree.coordToKey(point3d(2.0f, 2.0f, 1.5f));
+    OcTreeKey k;
+
+    // translation by whole voxels: key offset
+    OcTree shifted (0.1);
+    EXPECT_TRUE (tree.transformed(pose6d(0.3, -0.2, 0.5, 0.0, 0.0, 0.0), shifted));
+    EXPECT_EQ (shifted.size(), shifted.calcNumNodes());
+    for (k[0] = min_key[0]; k[0] <= max_key[0]; ++k[0]) {
+      for (k[1] = min_key[1]; k[1] <= max_key[1]; ++k[1]) {
+        for (k[2] = min_key[2]; k[2] <= max_key[2]; ++k[2]) {
+          OcTreeNode* n = tree.search(k);
+          OcTreeNode* n_shifted = shifted.search(OcTreeKey(k[0] + 3, k[1] - 2, k[2] + 5));
+          bool known = (n != NULL);
+          bool shifted_known = (n_shifted != NULL);
+          EXPECT_EQ (known, shifted_known);
+          if (n)
+            EXPECT_FLOAT_EQ (n->getLogOdds(), n_shifted->getLogOdds());
+        }
+      }
+    }
+
+    // rotation by 90 deg around z maps voxels onto voxels
+    OcTree rotated (0.1);
+    EXPECT_TRUE (tree.transformed(pose6d(0.0, 0.0, 0.0, 0.0, 0.0, M_PI_2), rotated));
+    EXPECT_EQ (rotated.size(), rotated.calcNumNodes());
+    for (k[0] = min_key[0]; k[0] <= max_key[0]; ++k[0]) {
+      for (k[1] = min_key[1]; k[1] <= max_key[1]; ++k[1]) {
+        for (k[2] = min_key[2]; k[2] <= max_key[2]; ++k[2]) {
+          OcTreeNode* n = tree.search(k);
+          point3d p = tree.keyToCoord(k);
+          OcTreeNode* n_rotated = rotated.search(point3d(-p.y(), p.x(), p.z()));
+          bool known = (n != NULL);
+          bool rotated_known = (n_rotated != NULL);
+          EXPECT_EQ (known, rotated_known);
+          if (n)
+            EXPECT_FLOAT_EQ (n->getLogOdds(), n_rotated->getLogOdds());
+        }
+      }
+    }
+    // large uniform regions remain pruned
+    EXPECT_TRUE (rotated.getNumLeafNodes() <= tree.getNumLeafNodes());
+
+    // resampling at a coarser resolution
+    OcTree coarse (0.2);
+    EXPECT_TRUE (tree.transformed(pose6d(0.0, 0.0, 0.0, 0.0, 0.0, 0.3), coarse));
+    EXPECT_TRUE (coarse.size() > 0);
+    EXPECT_EQ (coarse.size(), coarse.calcNumNodes());
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Diff") {
+    OcTree tree_a (0.1);
+    for (float y = -1.0f; y <= 1.0f; y += 0.05f)
+      tree_a.insertRay(point3d(0.05f, 0.05f, 0.05f), point3d(1.55f, y, 0.55f));
+    for (float x = 0.0f; x < 0.8f; x += 0.1f)
+      for (float y = 0.0f; y < 0.8f; y += 0.1f)
+        for (float z = -0.8f; z < 0.0f; z += 0.1f)
+          tree_a.updateNode(point3d(x + 0.05f, y + 0.05f, z + 0.05f), true);
+    tree_a.prune();
+
+    // identical trees
+    OcTree tree_b (tree_a);
+    OcTreeDiff diff;
+    EXPECT_TRUE (tree_a.diff(tree_b, diff));
+    EXPECT_EQ (diff.regions.size(), 0u);
+    EXPECT_FLOAT_EQ (diff.getChangedVolume(), 0.0);
+    EXPECT_FLOAT_EQ (diff.kld, 0.0);
+    EXPECT_TRUE (diff.volume[OcTreeDiff::OCCUPIED][OcTreeDiff::OCCUPIED] > 0.5);
+
+    // the pruned occupied block becomes free: one coarse region
+    for (float x = 0.0f; x < 0.8f; x += 0.1f)
+      for (float y = 0.0f; y < 0.8f; y += 0.1f)
+        for (float z = -0.8f; z < 0.0f; z += 0.1f)
+          tree_b.setNodeValue(point3d(x + 0.05f, y + 0.05f, z + 0.05f), -2.0f);
+    // a single new occupied voxel in unknown space and a value-only change
+    tree_b.updateNode(point3d(-1.05f, -1.05f, -1.05f), true);
+    tree_b.updateNode(point3d(1.0f, 0.05f, 0.35f), false);
+
+    EXPECT_TRUE (tree_a.diff(tree_b, diff));
+    EXPECT_EQ (diff.regions.size(), 2u);
+    EXPECT_NEAR (diff.volume[OcTreeDiff::OCCUPIED][OcTreeDiff::FREE], 0.512, 1e-4);
+    EXPECT_NEAR (diff.volume[OcTreeDiff::UNKNOWN][OcTreeDiff::OCCUPIED], 0.001, 1e-6);
+    EXPECT_NEAR (diff.getChangedVolume(), 0.513, 1e-4);
+    EXPECT_NEAR (diff.value_changed_volume, 0.001, 1e-6);
+    EXPECT_TRUE (diff.kld > 0.0);
+    bool found_block = false;
+    for (size_t i = 0; i < diff.regions.size(); ++i) {
+      if (diff.regions[i].depth == tree_a.getTreeDepth() - 3) {
+        found_block = true;
+        EXPECT_EQ (diff.regions[i].state_a, OcTreeDiff::OCCUPIED);
+        EXPECT_EQ (diff.regions[i].state_b, OcTreeDiff::FREE);
+        point3d center = tree_a.keyToCoord(diff.regions[i].key, diff.regions[i].depth);
+        EXPECT_NEAR (center.x(), 0.4, 1e-5);
+        EXPECT_NEAR (center.z(), -0.4, 1e-5);
+      }
+    }
+    EXPECT_TRUE (found_block);
+
+    // reverse direction
+    OcTreeDiff diff_reverse;
+    tree_b.diff(tree_a, diff_reverse);
+    EXPECT_EQ (diff_reverse.regions.size(), 2u);
+    EXPECT_NEAR (diff_reverse.volume[OcTreeDiff::FREE][OcTreeDiff::OCCUPIED], 0.512, 1e-4);
+    EXPECT_NEAR (diff_reverse.volume[OcTreeDiff::OCCUPIED][OcTreeDiff::UNKNOWN], 0.001, 1e-6);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "SurfaceMesh") {
+    OcTree tree (0.1);
+    tree.enableChangeDetection(true);
+    for (float x = 0.0f; x < 0.8f; x += 0.1f)
+      for (float y = 0.0f; y < 0.8f; y += 0.1f)
+        for (float z = 0.0f; z < 0.8f; z += 0.1f)
+          tree.updateNode(point3d(x + 0.05f, y + 0.05f, z + 0.05f), true);
+    tree.updateNode(point3d(-1.05f, 0.05f, 0.05f), true);
+    tree.prune();
+
+    SurfaceMesher<OcTree> mesher (tree, 4);
+    mesher.update();
+    tree.resetChangeDetection();
+    const IndexedMesh& mesh = mesher.getMesh();
+    EXPECT_TRUE (mesh.getNumTriangles() > 0);
+    EXPECT_TRUE (mesh.getNumVertices() < 3 * mesh.getNumTriangles());
+
+    // closed and consistently oriented: each directed edge is used exactly once,
+    // its reverse by the adjacent triangle, normals point away from the voxels
+    std::map<std::pair<unsigned int, unsigned int>, int> edge_count;
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+      for (unsigned int j = 0; j < 3; ++j)
+        edge_count[std::make_pair(mesh.indices[i + j], mesh.indices[i + (j+1) % 3])]++;
+      const point3d& p1 = mesh.vertices[mesh.indices[i]];
+      point3d normal = (mesh.vertices[mesh.indices[i+1]] - p1).cross(mesh.vertices[mesh.indices[i+2]] - p1);
+      point3d center = (p1.x() < -0.5f) ? point3d(-1.05f, 0.05f, 0.05f) : point3d(0.4f, 0.4f, 0.4f);
+      EXPECT_TRUE (normal.dot(p1 - center) > 0.0);
+    }
+    for (std::map<std::pair<unsigned int, unsigned int>, int>::iterator it = edge_count.begin();
+         it != edge_count.end(); ++it) {
+      EXPECT_EQ (it->second, 1);
+      bool has_reverse = (edge_count.count(std::make_pair(it->first.second, it->first.first)) == 1);
+      EXPECT_TRUE (has_reverse);
+    }
+
+    // a different block size gives the same mesh (shared vertices across blocks)
+    SurfaceMesher<OcTree> mesher_large (tree, 16);
+    mesher_large.update();
+    EXPECT_EQ (mesher_large.getMesh().getNumVertices(), mesh.getNumVertices());
+    EXPECT_EQ (mesher_large.getMesh().getNumTriangles(), mesh.getNumTriangles());
+
+    // interpolation only moves vertices
+    SurfaceMesher<OcTree> mesher_interp (tree, 8, false, true);
+    mesher_interp.update();
+    EXPECT_EQ (mesher_interp.getMesh().getNumVertices(), mesh.getNumVertices());
+    EXPECT_EQ (mesher_interp.getMesh().getNumTriangles(), mesh.getNumTriangles());
+
+    // incremental update equals meshing from scratch
+    tree.setNodeValue(point3d(0.05f, 0.05f, 0.05f), -2.0f);
+    tree.updateNode(point3d(-1.05f, 0.05f, 0.05f), false);
+    tree.updateNode(point3d(-1.05f, 0.05f, 0.05f), false);
+    tree.updateNode(point3d(2.05f, 2.05f, 2.05f), true);
+    EXPECT_TRUE (tree.numChangesDetected() > 0);
+    size_t num_blocks_before = mesher.getNumBlocks();
+    mesher.update();
+    tree.resetChangeDetection();
+    SurfaceMesher<OcTree> mesher_fresh (tree, 4);
+    mesher_fresh.update();
+    EXPECT_TRUE (mesher.getNumBlocks() != num_blocks_before);
+    EXPECT_EQ (mesher.getNumBlocks(), mesher_fresh.getNumBlocks());
+    EXPECT_EQ (mesher.getMesh().getNumVertices(), mesher_fresh.getMesh().getNumVertices());
+    EXPECT_EQ (mesher.getMesh().getNumTriangles(), mesher_fresh.getMesh().getNumTriangles());
+
+  // ------------------------------------------------------------
+  } else if (test_name == "LeafNormals") {
+    OcTree tree (0.1);
+    // occupied 8x8x8 block in a shell of free voxels
+    for (float x = -0.2f; x < 1.0f; x += 0.1f)
+      for (float y = -0.2f; y < 1.0f; y += 0.1f)
+        for (float z = -0.2f; z < 1.0f; z += 0.1f) {
+          bool inside = (x > -0.01f && x < 0.79f && y > -0.01f && y < 0.79f && z > -0.01f && z < 0.79f);
+          tree.updateNode(point3d(x + 0.05f, y + 0.05f, z + 0.05f), inside);
+        }
+    tree.updateNode(point3d(-1.05f, -1.05f, -1.05f), true);
+    tree.expand();
+
+    point3d_collection centers, normals;
+    tree.getLeafNormals(centers, normals);
+    EXPECT_EQ (centers.size(), 513u);
+    EXPECT_EQ (normals.size(), centers.size());
+    unsigned int num_surface = 0;
+    for (size_t i = 0; i < centers.size(); ++i) {
+      // equals the sum of the single voxel normals
+      std::vector<point3d> voxel_normals;
+      EXPECT_TRUE (tree.getNormals(centers[i], voxel_normals));
+      point3d sum (0.0f, 0.0f, 0.0f);
+      for (size_t j = 0; j < voxel_normals.size(); ++j)
+        sum += voxel_normals[j];
+      if (sum.norm() > 0.0)
+        sum.normalize();
+      EXPECT_NEAR (normals[i].x(), sum.x(), 1e-5);
+      EXPECT_NEAR (normals[i].y(), sum.y(), 1e-5);
+      EXPECT_NEAR (normals[i].z(), sum.z(), 1e-5);
+      if (normals[i].norm() > 0.0)
+        num_surface++;
+    }
+    // all voxels on the faces of the block (512 - 6^3 inner ones), the isolated
+    // voxel is surrounded by unknown space (considered occupied)
+    EXPECT_EQ (num_surface, 512u - 216u);
+
+    // bbx query: voxels in the center of the +x face point along +x
+    tree.getLeafNormals(point3d(0.7f, 0.3f, 0.3f), point3d(0.8f, 0.5f, 0.5f), centers, normals);
+    EXPECT_EQ (centers.size(), 4u);
+    for (size_t i = 0; i < normals.size(); ++i)
+      EXPECT_NEAR (normals[i].x(), 1.0, 1e-5);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "ConnectedComponents") {
+    OcTree tree (0.1);
+    tree.enableChangeDetection(true);
+    // block of 4x4x4 voxels (pruned) with a voxel touching its corner
+    for (int x = 0; x < 4; ++x)
+      for (int y = 0; y < 4; ++y)
+        for (int z = 0; z < 4; ++z)
+          tree.updateNode(point3d(x * 0.1f + 0.05f, y * 0.1f + 0.05f, z * 0.1f + 0.05f), true);
+    tree.updateNode(point3d(-0.05f, -0.05f, -0.05f), true);
+    // a separate 2x2x2 block, a single voxel and some free space
+    for (int x = 0; x < 2; ++x)
+      for (int y = 0; y < 2; ++y)
+        for (int z = 0; z < 2; ++z)
+          tree.updateNode(point3d(x * 0.1f + 1.05f, y * 0.1f + 0.05f, z * 0.1f + 0.05f), true);
+    tree.updateNode(point3d(1.55f, 0.05f, 0.05f), true);
+    for (int x = 0; x < 20; ++x)
+      tree.updateNode(point3d(x * 0.1f + 0.05f, 1.05f, 0.05f), false);
+
+    OcTreeComponents components;
+    tree.getConnectedComponents(components);
+    EXPECT_EQ (components.size(), 3u);
+    int block_component = components.findComponent(tree.coordToKey(point3d(0.25f, 0.25f, 0.25f)));
+    int corner_component = components.findComponent(tree.coordToKey(point3d(-0.05f, -0.05f, -0.05f)));
+    EXPECT_TRUE (block_component >= 0);
+    EXPECT_EQ (block_component, corner_component);
+    EXPECT_EQ (components.findComponent(tree.coordToKey(point3d(0.55f, 0.05f, 0.05f))), -1);
+    const OcTreeComponents::Component& block = components.components[block_component];
+    EXPECT_EQ (block.num_voxels, 65u);
+    EXPECT_EQ (block.leafs.size(), 2u);
+    EXPECT_NEAR (block.volume, 0.065, 1e-6);
+    EXPECT_NEAR (block.bbx_min.x(), -0.1, 1e-5);
+    EXPECT_NEAR (block.bbx_max.z(), 0.4, 1e-5);
+
+    // incremental update: bridge the 2x2x2 block and the single voxel, detach
+    // the corner voxel and add a new one
+    tree.resetChangeDetection();
+    tree.updateNode(point3d(1.25f, 0.05f, 0.05f), true);
+    tree.updateNode(point3d(1.35f, 0.15f, 0.05f), true);
+    tree.updateNode(point3d(1.45f, 0.05f, 0.15f), true);
+    tree.setNodeValue(point3d(-0.05f, -0.05f, -0.05f), -2.0f);
+    tree.updateNode(point3d(-0.55f, -0.05f, -0.05f), true);
+    tree.updateConnectedComponents(components);
+    tree.resetChangeDetection();
+
+    OcTreeComponents components_full;
+    tree.getConnectedComponents(components_full);
+    EXPECT_EQ (components.size(), 3u);
+    EXPECT_EQ (components_full.size(), components.size());
+    std::vector<unsigned long long> sizes, sizes_full;
+    for (size_t i = 0; i < components.size(); ++i) {
+      sizes.push_back(components.components[i].num_voxels);
+      sizes_full.push_back(components_full.components[i].num_voxels);
+    }
+    std::sort(sizes.begin(), sizes.end());
+    std::sort(sizes_full.begin(), sizes_full.end());
+    for (size_t i = 0; i < sizes.size(); ++i)
+      EXPECT_EQ (sizes[i], sizes_full[i]);
+    EXPECT_EQ (sizes[0], 1u);
+    EXPECT_EQ (sizes[1], 12u);
+    EXPECT_EQ (sizes[2], 64u);
+    EXPECT_EQ (components.findComponent(tree.coordToKey(point3d(1.05f, 0.05f, 0.05f))),
+               components.findComponent(tree.coordToKey(point3d(1.55f, 0.05f, 0.05f))));
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Neighborhood") {
+    OcTree tree (0.1);
+    srand(42);
+    for (int i = 0; i < 2000; ++i)
+      tree.updateNode(point3d((rand() % 40) * 0.1f - 1.95f, (rand() % 40) * 0.1f - 1.95f,
+                              (rand() % 10) * 0.1f - 0.45f), (rand() % 2) == 0);
+    // pruned occupied block of 8x8x8 voxels
+    for (int x = 0; x < 8; ++x)
+      for (int y = 0; y < 8; ++y)
+        for (int z = 0; z < 8; ++z)
+          tree.updateNode(point3d(x * 0.1f + 3.25f, y * 0.1f + 3.25f, z * 0.1f + 3.25f), true);
+    OcTreeKey block_key = tree.coordToKey(point3d(3.55f, 3.55f, 3.55f));
+    unsigned int block_depth = 0;
+    EXPECT_TRUE (tree.searchWithDepth(block_key, block_depth));
+    EXPECT_EQ (block_depth, 13u);
+
+    // compare with searching each neighbor from the root, walking over the keys
+    OcTreeNeighborhood<OcTree> neighborhood(tree);
+    std::vector<OcTreeKey> query_keys;
+    for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it)
+      query_keys.push_back(it.getKey());
+    for (int x = 0; x < 12; ++x)
+      query_keys.push_back(tree.coordToKey(point3d(x * 0.1f + 3.05f, 3.55f, 3.35f)));
+    query_keys.push_back(OcTreeKey(0, 0, 0));
+    query_keys.push_back(OcTreeKey(65535, 32768, 0));
+
+    unsigned int num_checked = 0;
+    for (size_t i = 0; i < query_keys.size(); ++i) {
+      for (unsigned int depth = 14; depth <= 16; ++depth) {
+        OcTreeNode* node = neighborhood.moveTo(query_keys[i], depth);
+        unsigned int node_depth = 0;
+        bool node_ok = node == tree.searchWithDepth(query_keys[i], node_depth, depth)
+          && node_depth == neighborhood.getNodeDepth();
+        EXPECT_TRUE (node_ok);
+        EXPECT_TRUE (computeIndexKey(16 - depth, neighborhood.getKey())
+                     == computeIndexKey(16 - depth, query_keys[i]));
+
+        OcTreeNode* nodes[27];
+        unsigned int depths[27];
+        neighborhood.getNeighborhood(nodes, depths);
+        for (int dz = -1; dz <= 1; ++dz) {
+          for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+              OcTreeNode* expected = NULL;
+              unsigned int expected_depth = 0;
+              OcTreeKey neighbor_key;
+              if (neighborhood.getNeighborKey(dx, dy, dz, neighbor_key))
+                expected = tree.searchWithDepth(neighbor_key, expected_depth, depth);
+              unsigned int neighbor_depth = 0;
+              OcTreeNode* neighbor = neighborhood.getNeighbor(dx, dy, dz, neighbor_depth);
+              unsigned int idx = OcTreeNeighborhood<OcTree>::neighborIndex(dx, dy, dz);
+              bool neighbor_ok = neighbor == expected && neighbor_depth == expected_depth;
+              bool block_ok = nodes[idx] == expected && depths[idx] == expected_depth;
+              EXPECT_TRUE (neighbor_ok);
+              EXPECT_TRUE (block_ok);
+              ++num_checked;
+            }
+          }
+        }
+      }
+    }
+    EXPECT_TRUE (num_checked > 10000);
+
+    // all neighbors inside the pruned block are the block's leaf
+    neighborhood.moveTo(block_key);
+    OcTreeNode* block_nodes[27];
+    unsigned int block_depths[27];
+    neighborhood.getNeighborhood(block_nodes, block_depths);
+    for (unsigned int i = 0; i < 27; ++i) {
+      EXPECT_TRUE (block_nodes[i] == neighborhood.getNode());
+      EXPECT_EQ (block_depths[i], 13u);
+    }
+
+    // keys outside of the tree
+    neighborhood.moveTo(OcTreeKey(0, 100, 100));
+    unsigned int outside_depth = 1;
+    EXPECT_TRUE (neighborhood.getNeighbor(-1, 0, 0, outside_depth) == NULL);
+    EXPECT_EQ (outside_depth, 0u);
+
+    unsigned int num_neighbors[3] = {0, 0, 0};
+    for (unsigned int i = 0; i < 27; ++i) {
+      num_neighbors[0] += OcTreeNeighborhood<OcTree>::isNeighbor(i, 6);
+      num_neighbors[1] += OcTreeNeighborhood<OcTree>::isNeighbor(i, 18);
+      num_neighbors[2] += OcTreeNeighborhood<OcTree>::isNeighbor(i, 26);
+    }
+    EXPECT_EQ (num_neighbors[0], 6u);
+    EXPECT_EQ (num_neighbors[1], 18u);
+    EXPECT_EQ (num_neighbors[2], 26u);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Inflation") {
+    OcTree tree (0.1);
+    tree.enableChangeDetection(true);
+    srand(7);
+    // free space with scattered obstacles and a pruned occupied block of 8x8x8 voxels
+    for (int x = 0; x < 30; ++x)
+      for (int y = 0; y < 30; ++y)
+        for (int z = 0; z < 6; ++z)
+          tree.updateNode(point3d(x * 0.1f + 0.05f, y * 0.1f + 0.05f, z * 0.1f + 0.05f), false);
+    for (int i = 0; i < 40; ++i)
+      tree.updateNode(point3d((rand() % 30) * 0.1f + 0.05f, (rand() % 30) * 0.1f + 0.05f,
+                              (rand() % 6) * 0.1f + 0.05f), true);
+    for (int x = 0; x < 8; ++x)
+      for (int y = 0; y < 8; ++y)
+        for (int z = 0; z < 8; ++z)
+          tree.updateNode(point3d(x * 0.1f + 0.85f, y * 0.1f + 0.85f, z * 0.1f + 0.85f), true);
+
+    const double radius = 0.25;
+    const double key_radius_sq = 2.5 * 2.5;
+    OcTree inflated_tree (0.1);
+    EXPECT_TRUE (tree.inflated(radius, inflated_tree));
+    EXPECT_FALSE (tree.inflated(radius, tree));
+
+    // compare with the occupied voxels at the finest resolution within the radius
+    std::vector<OcTreeKey> occupied_keys;
+    for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it) {
+      if (!tree.isNodeOccupied(*it))
+        continue;
+      OcTreeKey min_key = computeIndexKey(tree.getTreeDepth() - it.getDepth(), it.getKey());
+      int size = 1 << (tree.getTreeDepth() - it.getDepth());
+      for (int x = 0; x < size; ++x)
+        for (int y = 0; y < size; ++y)
+          for (int z = 0; z < size; ++z)
+            occupied_keys.push_back(OcTreeKey(min_key[0] + x, min_key[1] + y, min_key[2] + z));
+    }
+    EXPECT_TRUE (occupied_keys.size() > 512);
+    const OcTreeKey origin_key = tree.coordToKey(point3d(0.05f, 0.05f, 0.05f));
+    unsigned int num_errors = 0;
+    unsigned int num_inflated = 0;
+    for (int x = -4; x < 34; ++x) {
+      for (int y = -4; y < 34; ++y) {
+        for (int z = -4; z < 12; ++z) {
+          OcTreeKey key (origin_key[0] + x, origin_key[1] + y, origin_key[2] + z);
+          bool expected_occupied = false;
+          for (size_t i = 0; i < occupied_keys.size() && !expected_occupied; ++i) {
+            double dx = (int) key[0] - (int) occupied_keys[i][0];
+            double dy = (int) key[1] - (int) occupied_keys[i][1];
+            double dz = (int) key[2] - (int) occupied_keys[i][2];
+            expected_occupied = dx*dx + dy*dy + dz*dz <= key_radius_sq;
+          }
+          OcTreeNode* node = inflated_tree.search(key);
+          OcTreeNode* source_node = tree.search(key);
+          if (expected_occupied) {
+            ++num_inflated;
+            if (node == NULL || node->getLogOdds() != tree.getClampingThresMaxLog())
+              ++num_errors;
+          }
+          else if ((node == NULL) != (source_node == NULL)
+                   || (node && node->getLogOdds() != source_node->getLogOdds()))
+            ++num_errors;
+        }
+      }
+    }
+    EXPECT_EQ (num_errors, 0u);
+    EXPECT_TRUE (num_inflated > occupied_keys.size());
+    // the block stays a single leaf
+    unsigned int block_depth = 0;
+    EXPECT_TRUE (inflated_tree.searchWithDepth(tree.coordToKey(point3d(1.25f, 1.25f, 1.25f)), block_depth));
+    EXPECT_TRUE (block_depth <= 13);
+
+    // incremental update matches inflating again
+    tree.resetChangeDetection();
+    for (int i = 0; i < 10; ++i)
+      tree.updateNode(point3d((rand() % 30) * 0.1f + 0.05f, (rand() % 30) * 0.1f + 0.05f,
+                              (rand() % 6) * 0.1f + 0.05f), true);
+    tree.setNodeValue(point3d(1.25f, 1.25f, 1.25f), -2.0f);
+    tree.setNodeValue(point3d(0.85f, 0.85f, 0.85f), -2.0f);
+    tree.updateNode(point3d(5.05f, 5.05f, 0.05f), true);
+    EXPECT_TRUE (tree.updateInflated(radius, inflated_tree));
+    tree.resetChangeDetection();
+    OcTree inflated_full (0.1);
+    tree.inflated(radius, inflated_full);
+    EXPECT_EQ (inflated_tree.size(), inflated_tree.calcNumNodes());
+    num_errors = 0;
+    for (int x = -4; x < 56; ++x) {
+      for (int y = -4; y < 56; ++y) {
+        for (int z = -4; z < 12; ++z) {
+          OcTreeKey key (origin_key[0] + x, origin_key[1] + y, origin_key[2] + z);
+          OcTreeNode* node = inflated_tree.search(key);
+          OcTreeNode* full_node = inflated_full.search(key);
+          if ((node == NULL) != (full_node == NULL)
+              || (node && node->getLogOdds() != full_node->getLogOdds()))
+            ++num_errors;
+        }
+      }
+    }
+    EXPECT_EQ (num_errors, 0u);
+    EXPECT_TRUE (inflated_tree.search(point3d(5.25f, 5.05f, 0.05f)) != NULL);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "CountingBatch") {
+    // Morton codes order keys like a depth-first traversal
+    OcTreeKey morton_key (12345, 54321, 777);
+    uint64_t morton_code = computeMortonCode(morton_key);
+    for (unsigned int level = 0; level < 16; ++level)
+      EXPECT_EQ ((unsigned int) ((morton_code >> (3*level)) & 7), computeChildIdx(morton_key, level));
+
+    point3d_collection points;
+    for (int i = 0; i < 20000; ++i) {
+      int r = i * 7919;
+      points.push_back(point3d(0.05f * (r % 37) - 0.9f, 0.05f * ((r / 37) % 29), 0.05f * (i % 5)));
+    }
+    points.push_back(point3d(1e6f, 0.0f, 0.0f)); // outside of the tree
+
+    CountingOcTree single_tree (0.05);
+    for (size_t i = 0; i < points.size(); ++i)
+      single_tree.updateNode(points[i]);
+    CountingOcTree batch_tree (0.05);
+    EXPECT_EQ (batch_tree.updateNodes(points), points.size() - 1);
+    EXPECT_EQ (batch_tree.size(), single_tree.size());
+    EXPECT_EQ (batch_tree.getRoot()->getCount(), single_tree.getRoot()->getCount());
+
+    // counting a second batch into a non-empty tree
+    Pointcloud scan;
+    for (size_t i = 0; i < 1000; ++i) {
+      scan.push_back(points[i]);
+      single_tree.updateNode(points[i]);
+    }
+    EXPECT_EQ (batch_tree.updateNodes(scan), 1000u);
+
+    size_t num_errors = 0;
+    for (CountingOcTree::iterator it = single_tree.begin(); it != single_tree.end(); ++it) {
+      CountingOcTreeNode* node = batch_tree.search(it.getKey(), it.getDepth());
+      if (node == NULL || node->getCount() != it->getCount())
+        ++num_errors;
+    }
+    EXPECT_EQ (num_errors, 0u);
+
+    unsigned int min_hits = 3;
+    point3d_list single_centers, batch_centers;
+    single_tree.getCentersMinHits(single_centers, min_hits);
+    batch_tree.getCentersMinHits(batch_centers, min_hits);
+    EXPECT_EQ (batch_centers.size(), single_centers.size());
+    EXPECT_TRUE (batch_centers.size() > 0);
+    size_t num_below = 0;
+    for (point3d_list::iterator it = batch_centers.begin(); it != batch_centers.end(); ++it) {
+      if (batch_tree.search(*it)->getCount() < min_hits)
+        ++num_below;
+    }
+    EXPECT_EQ (num_below, 0u);
+
+    CountingOcTree empty_tree (0.05);
+    point3d_list empty_centers;
+    empty_tree.getCentersMinHits(empty_centers, 1);
+    EXPECT_TRUE (empty_centers.empty());
+
+  // ------------------------------------------------------------
+  } else if (test_name == "DenseGrid") {
+    // grid with a solid box, a sphere and a thin wall (layout as in binvox: y fastest, then z, then x)
+    const unsigned int sx = 70, sy = 45, sz = 33;
+    std::vector<unsigned char> cells (sx * sy * sz, 0);
+    for (unsigned int x = 0; x < sx; ++x) {
+      for (unsigned int y = 0; y < sy; ++y) {
+        for (unsigned int z = 0; z < sz; ++z) {
+          bool box = (x >= 8 && x < 40 && y >= 16 && y < 32 && z < 16);
+          bool sphere = ((x-50)*(x-50) + (y-20)*(y-20) + (z-20)*(z-20) < 100);
+          bool wall = (y == 3);
+          cells[x * sy * sz + z * sy + y] = (box || sphere || wall) ? 1 : 0;
+        }
+      }
+    }
+
+    for (int variant = 0; variant < 3; ++variant) {
+      bool mark_free = (variant == 1);
+      OcTree tree (0.1);
+      OcTree expected (0.1);
+      OcTreeKey min_key = tree.coordToKey(point3d(-2.0f, -1.0f, 0.05f));
+      if (variant == 2) {
+        // integrate into existing (pruned) space
+        for (float x = -3.0f; x < 0.0f; x += 0.1f) {
+          for (float y = -2.0f; y < 2.0f; y += 0.1f) {
+            tree.updateNode(point3d(x, y, 0.5f), false);
+            expected.updateNode(point3d(x, y, 0.5f), false);
+            tree.updateNode(point3d(x, y, 1.05f), true);
+            expected.updateNode(point3d(x, y, 1.05f), true);
+          }
+        }
+        tree.prune();
+        expected.prune();
+      }
+
+      EXPECT_TRUE (tree.insertDenseGrid(min_key, sx, sy, sz, &cells[0], sy * sz, 1, sy, mark_free));
+      for (unsigned int x = 0; x < sx; ++x) {
+        for (unsigned int y = 0; y < sy; ++y) {
+          for (unsigned int z = 0; z < sz; ++z) {
+            bool occupied = (cells[x * sy * sz + z * sy + y] != 0);
+            if (occupied || mark_free)
+              expected.updateNode(OcTreeKey(min_key[0] + x, min_key[1] + y, min_key[2] + z), occupied, true);
+          }
+        }
+      }
+      expected.updateInnerOccupancy();
+      expected.prune();
+
+      EXPECT_EQ (tree.size(), tree.calcNumNodes());
+      EXPECT_EQ (tree.size(), expected.size());
+      EXPECT_EQ (tree.getNumLeafNodes(), expected.getNumLeafNodes());
+      size_t num_errors = 0;
+      for (OcTree::tree_iterator it = expected.begin_tree(); it != expected.end_tree(); ++it) {
+        OcTreeNode* node = (it.getDepth() == 0) ? tree.getRoot() : tree.search(it.getKey(), it.getDepth());
+        if (node == NULL || node->getLogOdds() != it->getLogOdds()
+            || tree.nodeHasChildren(node) != expected.nodeHasChildren(&(*it)))
+          ++num_errors;
+      }
+      EXPECT_EQ (num_errors, 0u);
+    }
+
+    OcTree empty_tree (0.1);
+    std::vector<unsigned char> empty_cells (8, 0);
+    EXPECT_TRUE (empty_tree.insertDenseGrid(OcTreeKey(100, 100, 100), 2, 2, 2, &empty_cells[0], 4, 2, 1));
+    EXPECT_TRUE (empty_tree.getRoot() == NULL);
+    EXPECT_EQ (empty_tree.size(), 0u);
+    bool out_of_range = empty_tree.insertDenseGrid(OcTreeKey(65535, 0, 0), 2, 2, 2, &empty_cells[0], 4, 2, 1);
+    EXPECT_FALSE (out_of_range);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "PointCloudExport") {
+    OcTree tree (0.1);
+    // pruned occupied block, free space and single occupied voxels
+    for (int x = 0; x < 16; ++x) {
+      for (int y = 0; y < 16; ++y) {
+        for (int z = 0; z < 8; ++z) {
+          OcTreeKey key (32768 + x, 32768 + y, 32768 + z);
+          tree.updateNode(key, z < 4 || (x == 3 && y == 5));
+        }
+      }
+    }
+    tree.updateNode(point3d(-2.05f, 1.05f, 0.35f), true);
+    tree.prune();
+
+    // reference: centers of the occupied leafs of an expanded copy
+    OcTree expanded (tree);
+    expanded.expand();
+    point3d_collection expected;
+    for (OcTree::leaf_iterator it = expanded.begin_leafs(); it != expanded.end_leafs(); ++it) {
+      if (expanded.isNodeOccupied(*it))
+        expected.push_back(it.getCoordinate());
+    }
+
+    std::stringstream pcd;
+    PointCloudWriter writer (pcd, PointCloudWriter::PCD);
+    EXPECT_EQ (tree.writeOccupiedVoxelCenters(writer), expected.size());
+    EXPECT_TRUE (writer.finish());
+    std::string line;
+    size_t num_header_points = 0;
+    while (std::getline(pcd, line) && line != "DATA binary") {
+      if (line.compare(0, 7, "POINTS ") == 0)
+        num_header_points = atoi(line.c_str() + 7);
+    }
+    EXPECT_EQ (num_header_points, expected.size());
+    size_t num_errors = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+      float xyz[3];
+      pcd.read((char*) xyz, sizeof(xyz));
+      if (xyz[0] != expected[i].x() || xyz[1] != expected[i].y() || xyz[2] != expected[i].z())
+        ++num_errors;
+    }
+    EXPECT_EQ (num_errors, 0u);
+    EXPECT_TRUE (pcd.good());
+    EXPECT_EQ (pcd.peek(), EOF);
+
+    std::stringstream ply;
+    PointCloudWriter ply_writer (ply, PointCloudWriter::PLY);
+    tree.writeOccupiedVoxelCenters(ply_writer);
+    EXPECT_TRUE (ply_writer.finish());
+    EXPECT_EQ (ply.str().compare(0, 4, "ply\n"), 0);
+    EXPECT_EQ (ply.str().size() - ply.str().find("end_header\n") - 11, 12 * expected.size());
+
+    PointCloudWriter::Format format;
+    bool is_ply = PointCloudWriter::formatFromFilename("cloud.PLY", format) && format == PointCloudWriter::PLY;
+    EXPECT_TRUE (is_ply);
+    EXPECT_FALSE (PointCloudWriter::formatFromFilename("cloud.txt", format));
+
+  // ------------------------------------------------------------
+  } else if (test_name == "VoxelSurface") {
+    OcTree tree (0.1);
+    IndexedMesh mesh;
+    tree.getVoxelSurfaceMesh(mesh);
+    EXPECT_EQ (mesh.getNumTriangles(), 0u);
+
+    tree.updateNode(point3d(0.05f, 0.05f, 0.05f), true);
+    tree.getVoxelSurfaceMesh(mesh);
+    EXPECT_EQ (mesh.getNumTriangles(), 12u);
+    EXPECT_EQ (mesh.getNumVertices(), 8u);
+
+    // pruned block with finer occupied and free voxels next to it, separate voxel
+    for (int x = 0; x < 8; ++x) {
+      for (int y = 0; y < 8; ++y) {
+        for (int z = 0; z < 8; ++z) {
+          tree.updateNode(OcTreeKey(32768 + 8 + x, 32768 + y, 32768 + z), true);
+          if (x < 3 && (y + z) % 3 == 0)
+            tree.updateNode(OcTreeKey(32768 + 16 + x, 32768 + y, 32768 + z), true);
+          if (z == 0)
+            tree.updateNode(OcTreeKey(32768 + 8 + x, 32768 + y, 32768 - 1), false);
+        }
+      }
+    }
+    tree.updateNode(point3d(-1.05f, 0.35f, 0.75f), true);
+    tree.prune();
+    tree.getVoxelSurfaceMesh(mesh);
+
+    // reference: exposed faces of the voxels of an expanded copy
+    OcTree expanded (tree);
+    expanded.expand();
+    size_t num_faces = 0;
+    size_t num_voxels = 0;
+    for (OcTree::leaf_iterator it = expanded.begin_leafs(); it != expanded.end_leafs(); ++it) {
+      if (!expanded.isNodeOccupied(*it))
+        continue;
+      ++num_voxels;
+      for (unsigned int i = 0; i < 6; ++i) {
+        OcTreeKey neighbor_key = it.getKey();
+        neighbor_key[i / 2] += (i % 2) ? 1 : -1;
+        OcTreeNode* neighbor = expanded.search(neighbor_key);
+        if (neighbor == NULL || !expanded.isNodeOccupied(neighbor))
+          ++num_faces;
+      }
+    }
+
+    // area and enclosed volume (divergence theorem, requires outward orientation)
+    double area = 0.0;
+    double volume = 0.0;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+      const point3d& p1 = mesh.vertices[mesh.indices[i]];
+      const point3d& p2 = mesh.vertices[mesh.indices[i+1]];
+      const point3d& p3 = mesh.vertices[mesh.indices[i+2]];
+      area += 0.5 * (p2 - p1).cross(p3 - p1).norm();
+      volume += p1.dot(p2.cross(p3)) / 6.0;
+    }
+    EXPECT_NEAR (area, num_faces * 0.01, 1e-4);
+    EXPECT_NEAR (volume, num_voxels * 0.001, 1e-4);
+    // the pruned block is not subdivided where it is exposed
+    EXPECT_TRUE (mesh.getNumTriangles() < 2 * num_faces);
+
+    std::stringstream ply;
+    mesh.writePly(ply);
+    size_t header_end = ply.str().find("end_header\n") + 11;
+    EXPECT_EQ (ply.str().size() - header_end, 12 * mesh.getNumVertices() + 13 * mesh.getNumTriangles());
+    std::stringstream vrml;
+    mesh.writeVrml(vrml);
+    EXPECT_TRUE (vrml.str().find("IndexedFaceSet") != std::string::npos);
+  // ------------------------------------------------------------
+  } else if (test_name == "ScanEvaluation") {
+    OcTree tree (0.1);
+    Pointcloud map_scan;
+    for (int i = -20; i <= 20; ++i) {
+      for (int j = -10; j <= 10; ++j) {
+        map_scan.push_back(point3d(3.0f, i * 0.05f, j * 0.07f));
+        map_scan.push_back(point3d(i * 0.05f, -2.0f, j * 0.07f));
+      }
+    }
+    point3d map_origin (0.0f, 0.0f, 0.0f);
+    tree.insertPointCloud(map_scan, map_origin);
+    tree.updateNode(point3d(1.05f, 0.05f, 0.05f), true);
+    tree.prune();
+
+    // batched lookup matches single searches (including unknown cells)
+    std::vector<OcTreeKey> keys;
+    for (int i = 0; i < 200; ++i)
+      keys.push_back(OcTreeKey(32768 + (i * 7) % 40 - 20, 32768 + (i * 13) % 50 - 30, 32768 + (i * 3) % 20 - 10));
+    std::vector<OcTreeNode*> nodes;
+    tree.search(keys, nodes);
+    EXPECT_EQ (nodes.size(), keys.size());
+    size_t num_found = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      bool same_node = (nodes[i] == tree.search(keys[i]));
+      EXPECT_TRUE (same_node);
+      if (nodes[i]) ++num_found;
+    }
+    EXPECT_TRUE (num_found > 0);
+
+    // evaluation matches computeUpdate() with single searches
+    Pointcloud scan;
+    for (int i = -15; i <= 15; ++i) {
+      for (int j = -8; j <= 8; ++j) {
+        scan.push_back(point3d(3.02f, i * 0.06f + 0.01f, j * 0.08f));
+        scan.push_back(point3d(4.0f, i * 0.2f, j * 0.1f));
+      }
+    }
+    point3d origin (0.1f, 0.05f, 0.02f);
+    double maxranges[] = {-1.0, 3.5};
+    for (unsigned int m = 0; m < 2; ++m) {
+      ScanEvaluation eval;
+      tree.evaluateScan(scan, origin, maxranges[m], eval);
+      EXPECT_EQ (eval.num_scans, 1u);
+      EXPECT_EQ (eval.num_points, scan.size());
+
+      KeySet free_cells, occupied_cells;
+      tree.computeUpdate(scan, origin, free_cells, occupied_cells, maxranges[m]);
+      ScanEvaluation ref;
+      for (KeySet::iterator it = free_cells.begin(); it != free_cells.end(); ++it) {
+        OcTreeNode* n = tree.search(*it);
+        if (!n) ref.free_unknown++;
+        else if (tree.isNodeOccupied(n)) ref.free_wrong++;
+        else ref.free_correct++;
+      }
+      for (KeySet::iterator it = occupied_cells.begin(); it != occupied_cells.end(); ++it) {
+        OcTreeNode* n = tree.search(*it);
+        if (!n) ref.occupied_unknown++;
+        else if (tree.isNodeOccupied(n)) ref.occupied_correct++;
+        else ref.occupied_wrong++;
+      }
+      EXPECT_EQ (eval.free_correct, ref.free_correct);
+      EXPECT_EQ (eval.free_wrong, ref.free_wrong);
+      EXPECT_EQ (eval.free_unknown, ref.free_unknown);
+      EXPECT_EQ (eval.occupied_correct, ref.occupied_correct);
+      EXPECT_EQ (eval.occupied_wrong, ref.occupied_wrong);
+      EXPECT_EQ (eval.occupied_unknown, ref.occupied_unknown);
+      EXPECT_TRUE (eval.free_correct > 0);
+      EXPECT_TRUE (eval.getAccuracy() > 0.5);
+    }
+
+    // bounding box limits the evaluated cells as in computeUpdate()
+    point3d bbx_min (-1.0f, -1.0f, -1.0f);
+    point3d bbx_max (3.5f, 1.0f, 1.0f);
+    tree.setBBXMin(bbx_min);
+    tree.setBBXMax(bbx_max);
+    tree.useBBXLimit(true);
+    ScanEvaluation bbx_eval;
+    tree.evaluateScan(scan, origin, -1.0, bbx_eval);
+    KeySet free_cells, occupied_cells;
+    tree.computeUpdate(scan, origin, free_cells, occupied_cells, -1.0);
+    EXPECT_EQ (bbx_eval.free_correct + bbx_eval.free_wrong + bbx_eval.free_unknown, free_cells.size());
+    EXPECT_EQ (bbx_eval.occupied_correct + bbx_eval.occupied_wrong + bbx_eval.occupied_unknown,
+               occupied_cells.size());
+
+  // ------------------------------------------------------------
+  } else if (test_name == "ScanLog") {
+    // number parser matches stream extraction
+    const char* numbers[] = {"0", "-0.0", "1", "+2.5", "-4.82982", "0.249591", ".5", "7.", "1e3",
+                             "-1.5E-3", "3.4028234e38", "1.17549435e-38", "0.1000000000000000055511",
+                             "123456789012345678901234", "16777217", "3.14159265358979", "2.5e-45",
+                             "0.30000001192092896", "1e-50"};
+    for (unsigned int i = 0; i < sizeof(numbers) / sizeof(numbers[0]); ++i) {
+      std::istringstream ss (numbers[i]);
+      float expected = 0.0f;
+      ss >> expected;
+      const char* p = numbers[i];
+      float value = 1.0f;
+      EXPECT_TRUE (ScanLogReader::parseFloat(p, numbers[i] + strlen(numbers[i]), value));
+      EXPECT_EQ (value, expected);
+    }
+    // long mantissas near float rounding ties match strtof (no double rounding)
+    std::vector<std::string> long_numbers;
+    long_numbers.push_back("0.85756716132164");
+    long_numbers.push_back("-0.85756716132164");
+    char buffer[32];
+    for (unsigned int i = 0; i < 10000; ++i) {
+      uint32_t bits = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+      bits = (bits % 0x7E000000u) + 0x00800000u; // normal, finite and its successor too
+      float lower, upper;
+      memcpy(&lower, &bits, sizeof(lower));
+      ++bits;
+      memcpy(&upper, &bits, sizeof(upper));
+      snprintf(buffer, sizeof(buffer), "%.*g", 8 + (int) (i % 8), 0.5 * ((double) lower + (double) upper));
+      long_numbers.push_back(buffer);
+    }
+    unsigned int num_mismatches = 0;
+    for (unsigned int i = 0; i < long_numbers.size(); ++i) {
+      const char* p = long_numbers[i].c_str();
+      float value = 0.0f;
+      EXPECT_TRUE (ScanLogReader::parseFloat(p, p + long_numbers[i].size(), value));
+      if (value != strtof(long_numbers[i].c_str(), NULL))
+        ++num_mismatches;
+    }
+    EXPECT_EQ (num_mismatches, 0);
+
+    const char* no_number = "  # 1";
+    const char* p = no_number;
+    float value = 0.0f;
+    EXPECT_FALSE (ScanLogReader::parseFloat(p, no_number + strlen(no_number), value));
+
+    // log spanning several blocks, with comments and Windows line endings
+    std::stringstream log;
+    log << "# comment\n\n";
+    std::vector<unsigned int> scan_sizes;
+    for (unsigned int n = 0; n < 5; ++n) {
+      log << "NODE " << n * 0.5 << " 0.25 -1 0 0 " << n * 0.1 << "\n";
+      scan_sizes.push_back(100 + 150 * n);
+      for (unsigned int i = 0; i < scan_sizes.back(); ++i) {
+        log << i * 0.013 << " " << -(i * 1.7e-3) << "\t" << n << ((i % 3) ? "\n" : "\r\n");
+        if (i % 50 == 0)
+          log << " ignored line\n";
+      }
+    }
+    ScanGraph graph;
+    graph.readPlainASCII(log);
+    EXPECT_EQ (graph.size(), scan_sizes.size());
+    EXPECT_EQ ((size_t) std::distance(graph.edges_begin(), graph.edges_end()), scan_sizes.size() - 1);
+    for (unsigned int n = 0; n < graph.size(); ++n) {
+      ScanNode* node = *(graph.begin() + n);
+      EXPECT_EQ (node->id, n);
+      EXPECT_EQ (node->scan->size(), scan_sizes[n]);
+      EXPECT_FLOAT_EQ (node->pose.x(), n * 0.5);
+      point3d last = node->scan->back();
+      unsigned int i = scan_sizes[n] - 1;
+      EXPECT_FLOAT_EQ (last.x(), i * 0.013);
+      EXPECT_FLOAT_EQ (last.y(), -(i * 1.7e-3));
+      EXPECT_FLOAT_EQ (last.z(), (double) n);
+    }
+
+    // streamed conversion in small blocks gives the same graph file
+    log.clear();
+    log.seekg(0);
+    ScanLogReader reader (1024);
+    {
+      ScanGraphWriter writer ("scan_log.graph");
+      EXPECT_TRUE (writer.isOpen());
+      EXPECT_TRUE (reader.read(log, writer));
+      EXPECT_TRUE (writer.close());
+      EXPECT_EQ (writer.getNumNodes(), graph.size());
+      EXPECT_EQ (writer.getNumPoints(), graph.getNumPoints());
+    }
+    std::stringstream expected;
+    graph.writeBinary(expected);
+    std::ifstream written ("scan_log.graph", std::ios_base::binary);
+    std::stringstream written_data;
+    written_data << written.rdbuf();
+    bool same_file = (written_data.str() == expected.str());
+    EXPECT_TRUE (same_file);
+
+    // points before the first node are an error
+    std::stringstream bad_log ("1 2 3\nNODE 0 0 0 0 0 0\n");
+    ScanLogReader bad_reader;
+    ScanGraphWriter bad_writer ("scan_log_bad.graph");
+    EXPECT_FALSE (bad_reader.read(bad_log, bad_writer));
+
+  // ------------------------------------------------------------
+  } else if (test_name == "LocalMap") {
+    OcTree tree (0.1);
+    for (float x = -30.0f; x < 30.0f; x += 0.35f) {
+      for (float y = -20.0f; y < 20.0f; y += 0.45f) {
+        tree.updateNode(point3d(x, y, 0.05f), (int) (x + y) % 3 == 0);
+        tree.updateNode(point3d(x, y, 1.55f + 0.01f * x), true);
+      }
+    }
+    OcTree original (tree);
+    size_t original_leafs = original.getNumLeafNodes();
+
+    // sphere with spill tree: all leafs end up in one of the trees with their values
+    OcTree spill (0.1);
+    point3d center (5.0f, -2.0f, 0.0f);
+    double radius = 12.0;
+    size_t num_removed = tree.cropToSphere(center, radius, 0, &spill);
+    EXPECT_TRUE (num_removed > 0);
+    EXPECT_EQ (tree.size(), original.size() - num_removed);
+    EXPECT_EQ (tree.size(), tree.calcNumNodes());
+    EXPECT_EQ (spill.size(), spill.calcNumNodes());
+    EXPECT_EQ (tree.getNumLeafNodes() + spill.getNumLeafNodes(), original_leafs);
+    for (OcTree::leaf_iterator it = original.begin_leafs(); it != original.end_leafs(); ++it) {
+      OcTreeNode* kept = tree.search(it.getKey());
+      OcTreeNode* spilled = spill.search(it.getKey());
+      bool in_one_tree = (kept == NULL) != (spilled == NULL);
+      EXPECT_TRUE (in_one_tree);
+      OcTreeNode* node = kept ? kept : spilled;
+      EXPECT_FLOAT_EQ (node->getLogOdds(), it->getLogOdds());
+      if ((it.getCoordinate() - center).norm() < radius - 0.2)
+        EXPECT_TRUE (kept);
+    }
+    // crossing nodes are kept down to the crop depth (at least 1/16 of the extent)
+    for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it)
+      EXPECT_TRUE ((it.getCoordinate() - center).norm() < radius + 2 * 3.2 * sqrt(3.0));
+    for (OcTree::tree_iterator it = tree.begin_tree(); it != tree.end_tree(); ++it) {
+      if (!it.isLeaf())
+        EXPECT_FLOAT_EQ (it->getLogOdds(), it->getMaxChildLogOdds());
+    }
+    for (OcTree::tree_iterator it = spill.begin_tree(); it != spill.end_tree(); ++it) {
+      if (!it.isLeaf())
+        EXPECT_FLOAT_EQ (it->getLogOdds(), it->getMaxChildLogOdds());
+    }
+
+    // box at the finest depth, without spill tree
+    OcTree box_tree (original);
+    point3d box_min (-3.0f, -4.0f, -1.0f);
+    point3d box_max (8.0f, 2.5f, 1.0f);
+    box_tree.cropToBBX(box_min, box_max, 16);
+    EXPECT_EQ (box_tree.size(), box_tree.calcNumNodes());
+    // (the voxels containing the corners belong to the box, as in inBBX())
+    OcTreeKey box_min_key = original.coordToKey(box_min);
+    OcTreeKey box_max_key = original.coordToKey(box_max);
+    size_t num_in_box = 0;
+    for (OcTree::leaf_iterator it = original.begin_leafs(); it != original.end_leafs(); ++it) {
+      OcTreeKey key = it.getKey();
+      bool in_box = true;
+      for (unsigned int i = 0; i < 3; ++i)
+        in_box = in_box && key[i] >= box_min_key[i] && key[i] <= box_max_key[i];
+      bool kept = (box_tree.search(key) != NULL);
+      EXPECT_EQ (kept, in_box);
+      if (in_box) ++num_in_box;
+    }
+    EXPECT_EQ (box_tree.getNumLeafNodes(), num_in_box);
+
+    // everything outside: the whole tree moves into the spill tree
+    OcTree all_spill (0.1);
+    OcTree moved (original);
+    moved.cropToBBX(point3d(100.0f, 100.0f, 100.0f), point3d(101.0f, 101.0f, 101.0f), 0, &all_spill);
+    EXPECT_EQ (moved.size(), 0u);
+    EXPECT_EQ (all_spill.size(), original.size());
+
+    // rolling local map along a long trajectory
+    OcTree rolling (0.1);
+    OcTree rolling_spill (0.1);
+    rolling.setLocalMapRadius(8.0, &rolling_spill);
+    size_t max_size = 0;
+    for (int step = 0; step < 120; ++step) {
+      point3d origin (step * 0.5f, 0.0f, 0.5f);
+      Pointcloud scan;
+      for (int i = -20; i <= 20; ++i) {
+        scan.push_back(origin + point3d(0.2f * i, 4.0f, 0.0f));
+        scan.push_back(origin + point3d(0.2f * i, -4.0f, 0.1f * (i % 5)));
+      }
+      rolling.insertPointCloud(scan, origin);
+      max_size = std::max(max_size, rolling.size());
+      if (step == 40) {
+        OcTreeNode* start = rolling.search(point3d(0.0f, 4.0f, 0.5f));
+        EXPECT_TRUE (start == NULL);
+      }
+    }
+    EXPECT_TRUE (rolling_spill.search(point3d(0.0f, 4.0f, 0.5f)));
+    EXPECT_TRUE (rolling.search(point3d(59.5f, 4.0f, 0.5f)));
+    EXPECT_EQ (rolling.size(), rolling.calcNumNodes());
+    EXPECT_EQ (rolling_spill.size(), rolling_spill.calcNumNodes());
+    EXPECT_TRUE (max_size < rolling_spill.size());
+
+  } else if (test_name == "Reintegration") {
+    // wide clamping thresholds: the reintegrated map equals the rebuilt one
+    OcTree tree (0.1);
+    tree.setClampingThresMin(1e-6);
+    tree.setClampingThresMax(1.0 - 1e-6);
+    ScanGraph graph;
+    for (unsigned int i = 0; i < 5; ++i) {
+      Pointcloud* scan = new Pointcloud();
+      for (float a = -1.5f; a <= 1.5f; a += 0.05f) {
+        scan->push_back(4.0f * cos(a), 4.0f * sin(a), -0.5f + 0.1f * i);
+        scan->push_back(3.0f, 3.0f * sin(a), cos(a));
+      }
+      graph.addNode(scan, pose6d(0.5f * i, 0.2f * i, 0.0f, 0.0, 0.0, 0.1 * i));
+    }
+    ScanReintegrator<OcTreeNode> reintegrator (tree, 6.0);
+    EXPECT_EQ (reintegrator.update(graph), 5u);
+    EXPECT_EQ (reintegrator.getNumScans(), 5u);
+    EXPECT_EQ (reintegrator.update(graph), 0u);
+
+    for (int stage = 0; stage < 3; ++stage) {
+      if (stage == 1) {
+        // loop closure corrects the poses of the last scans
+        graph.getNodeByID(3)->pose = pose6d(1.6f, 0.5f, 0.1f, 0.0, 0.05, 0.2);
+        graph.getNodeByID(4)->pose.trans().x() += 0.35f;
+        EXPECT_EQ (reintegrator.update(graph), 2u);
+      } else if (stage == 2) {
+        EXPECT_TRUE (reintegrator.removeScan(3));
+        EXPECT_FALSE (reintegrator.removeScan(3));
+      }
+      OcTree rebuilt (0.1);
+      rebuilt.setClampingThresMin(1e-6);
+      rebuilt.setClampingThresMax(1.0 - 1e-6);
+      for (ScanGraph::iterator it = graph.begin(); it != graph.end(); ++it) {
+        if (stage < 2 || (*it)->id != 3)
+          rebuilt.insertPointCloud(**it, 6.0);
+      }
+      EXPECT_EQ (tree.size(), tree.calcNumNodes());
+      for (OcTree::leaf_iterator it = rebuilt.begin_leafs(); it != rebuilt.end_leafs(); ++it) {
+        OcTreeNode* node = tree.search(it.getKey());
+        EXPECT_TRUE (node);
+        EXPECT_NEAR (node->getLogOdds(), it->getLogOdds(), 1e-4);
+      }
+      for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it) {
+        OcTreeNode* node = rebuilt.search(it.getKey());
+        EXPECT_TRUE (node);
+        EXPECT_NEAR (node->getLogOdds(), it->getLogOdds(), 1e-4);
+      }
+    }
+    EXPECT_EQ (reintegrator.getNumScans(), 4u);
+    EXPECT_TRUE (reintegrator.memoryUsage() > reintegrator.getNumObservedCells() * sizeof(uint64_t));
+
+  } else if (test_name == "PoseScoring") {
+    // walls of a room, one voxel thick
+    OcTree tree (0.1);
+    for (float a = -3.95f; a < 4.0f; a += 0.1f) {
+      for (float h = 0.05f; h < 2.0f; h += 0.1f) {
+        tree.updateNode(point3d(a, -2.95f, h), true);
+        tree.updateNode(point3d(a, 2.95f, h), true);
+        if (a > -3.0f && a < 3.0f) {
+          tree.updateNode(point3d(-3.95f, a, h), true);
+          tree.updateNode(point3d(3.95f, a, h), true);
+        }
+      }
+    }
+    // scan of wall voxel centers from a known pose
+    pose6d true_pose (0.5f, 0.3f, 1.0f, 0.0, 0.0, 0.3);
+    pose6d true_pose_inv = true_pose.inv();
+    Pointcloud scan;
+    point3d_collection occupied_centers;
+    for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it) {
+      if (occupied_centers.size() % 7 == 0)
+        scan.push_back(true_pose_inv.transform(it.getCoordinate()));
+      occupied_centers.push_back(it.getCoordinate());
+    }
+    std::vector<pose6d> poses (1, true_pose);
+    for (int i = 1; i < 200; ++i) {
+      poses.push_back(pose6d(0.5f + 0.03f * ((i * 7) % 11 - 5), 0.3f + 0.03f * ((i * 5) % 11 - 5),
+                             1.0f + 0.02f * ((i * 3) % 5 - 2), 0.0, 0.0, 0.3 + 0.01 * ((i * 3) % 11 - 5)));
+    }
+
+    // hit counts match single lookups, except for points within float rounding of a cell boundary
+    std::vector<unsigned int> hits;
+    tree.scorePoses(scan, poses, hits);
+    EXPECT_EQ (hits.size(), poses.size());
+    EXPECT_EQ (hits[0], scan.size());
+    for (size_t i = 0; i < poses.size(); ++i) {
+      unsigned int num_hits = 0;
+      unsigned int num_on_boundary = 0;
+      for (size_t j = 0; j < scan.size(); ++j) {
+        point3d p = poses[i].transform(scan[j]);
+        OcTreeNode* node = tree.search(p);
+        if (node && tree.isNodeOccupied(node))
+          ++num_hits;
+        for (unsigned int k = 0; k < 3; ++k) {
+          double scaled = p(k) / tree.getResolution();
+          if (fabs(scaled - floor(scaled + 0.5)) < 1e-4) {
+            ++num_on_boundary;
+            break;
+          }
+        }
+      }
+      EXPECT_TRUE (hits[i] <= hits[0]);
+      EXPECT_TRUE (abs((int) hits[i] - (int) num_hits) <= (int) num_on_boundary);
+    }
+
+    // poses far outside of the tree score no hits
+    std::vector<pose6d> far_poses;
+    far_poses.push_back(pose6d(1e12f, 0.0f, 0.0f, 0.0, 0.0, 0.0));
+    far_poses.push_back(pose6d(0.0f, -3e38f, 0.0f, 0.0, 0.0, 0.0));
+    std::vector<unsigned int> far_hits;
+    tree.scorePoses(scan, far_poses, far_hits);
+    EXPECT_EQ (far_hits[0], 0u);
+    EXPECT_EQ (far_hits[1], 0u);
+
+    // likelihood field: exact distances up to 4 sigma
+    LikelihoodField field;
+    double sigma = 0.1;
+    EXPECT_FALSE (tree.computeLikelihoodField(point3d(1.0f, 0.0f, 0.0f), point3d(0.0f, 1.0f, 1.0f), sigma, 0.01, field));
+    EXPECT_TRUE (tree.computeLikelihoodField(point3d(-4.5f, -3.5f, -0.5f), point3d(4.45f, 3.45f, 2.45f), sigma, 0.01, field));
+    EXPECT_EQ (field.getSizeX(), 90u);
+    EXPECT_EQ (field.getSizeZ(), 30u);
+    for (unsigned int z = 0; z < field.getSizeZ(); z += 3) {
+      for (unsigned int y = 0; y < field.getSizeY(); y += 5) {
+        for (unsigned int x = 0; x < field.getSizeX(); x += 7) {
+          point3d center = field.getOrigin() + point3d(x + 0.5f, y + 0.5f, z + 0.5f) * 0.1f;
+          double min_dist = 4.0 * sigma;
+          for (size_t i = 0; i < occupied_centers.size(); ++i)
+            min_dist = std::min(min_dist, (double) (occupied_centers[i] - center).norm());
+          EXPECT_NEAR (field.distance[field.index(x, y, z)], min_dist, 1e-4);
+        }
+      }
+    }
+
+    std::vector<double> log_likelihoods;
+    field.scorePoses(scan, poses, log_likelihoods);
+    EXPECT_EQ (log_likelihoods.size(), poses.size());
+    EXPECT_NEAR (log_likelihoods[0], 0.0, 1e-3);
+    size_t num_different = 0;
+    for (size_t i = 0; i < poses.size(); ++i) {
+      double log_likelihood = 0.0;
+      for (size_t j = 0; j < scan.size(); ++j)
+        log_likelihood += field.getLogLikelihood(poses[i].transform(scan[j]));
+      EXPECT_TRUE (log_likelihoods[i] <= log_likelihoods[0] + 1e-3);
+      if (fabs(log_likelihoods[i] - log_likelihood) > 1e-3) ++num_different;
+    }
+    EXPECT_TRUE (num_different <= poses.size() / 50);
+    EXPECT_FLOAT_EQ (field.getLogLikelihood(point3d(100.0f, 0.0f, 0.0f)), log(0.01));
+    field.scorePoses(scan, far_poses, log_likelihoods);
+    EXPECT_NEAR (log_likelihoods[0], scan.size() * log(0.01), 1e-3);
+    EXPECT_NEAR (log_likelihoods[1], scan.size() * log(0.01), 1e-3);
+
+  } else if (test_name == "SensorModelInsert") {
+    // slanted wall, the rays to its far end are beyond maxrange
+    point3d origin (0.05f, 0.05f, 0.05f);
+    double maxrange = 4.5;
+    Pointcloud scan;
+    for (float y = -3.0f; y <= 3.0f; y += 0.05f) {
+      for (float z = -1.0f; z <= 1.0f; z += 0.1f)
+        scan.push_back(4.0f + 0.3f * y, y, z);
+    }
+
+    // constant model, maximum of the updates: equal to insertPointCloud()
+    OcTree reference (0.1);
+    reference.insertPointCloud(scan, origin, maxrange);
+    OcTree constant (0.1);
+    ConstantSensorModel constant_model (constant.getProbHitLog(), constant.getProbMissLog());
+    constant.insertPointCloudWithModel(scan, origin, constant_model, maxrange);
+    EXPECT_EQ (constant.size(), reference.size());
+    for (OcTree::leaf_iterator it = reference.begin_leafs(); it != reference.end_leafs(); ++it) {
+      OcTreeNode* node = constant.search(it.getKey());
+      EXPECT_TRUE (node);
+      EXPECT_FLOAT_EQ (node->getLogOdds(), it->getLogOdds());
+    }
+
+    // sum of the updates: each ray counts
+    OcTree summed (0.1);
+    summed.insertPointCloudWithModel(scan, origin, constant_model, maxrange, false, AbstractOccupancyOcTree::ACCUMULATE_SUM);
+    unordered_ns::unordered_map<OcTreeKey, unsigned int, OcTreeKey::KeyHash> num_misses;
+    unordered_ns::unordered_map<OcTreeKey, unsigned int, OcTreeKey::KeyHash> num_hits;
+    KeyRay ray;
+    for (size_t i = 0; i < scan.size(); ++i) {
+      bool is_hit = (scan[i] - origin).norm() <= maxrange;
+      point3d end = is_hit ? scan[i] : origin + (scan[i] - origin).normalized() * (float) maxrange;
+      summed.computeRayKeys(origin, end, ray);
+      for (KeyRay::iterator it = ray.begin(); it != ray.end(); ++it)
+        ++num_misses[*it];
+      if (is_hit)
+        ++num_hits[summed.coordToKey(scan[i])];
+    }
+    for (unordered_ns::unordered_map<OcTreeKey, unsigned int, OcTreeKey::KeyHash>::iterator it = num_misses.begin();
+         it != num_misses.end(); ++it) {
+      if (num_hits.count(it->first))
+        continue;
+      float expected = std::max(it->second * summed.getProbMissLog(), summed.getClampingThresMinLog());
+      EXPECT_NEAR (summed.search(it->first)->getLogOdds(), expected, 1e-5);
+    }
+    for (unordered_ns::unordered_map<OcTreeKey, unsigned int, OcTreeKey::KeyHash>::iterator it = num_hits.begin();
+         it != num_hits.end(); ++it) {
+      float expected = std::min(it->second * summed.getProbHitLog(), summed.getClampingThresMaxLog());
+      EXPECT_NEAR (summed.search(it->first)->getLogOdds(), expected, 1e-5);
+    }
+
+    // range-dependent model along a single ray
+    OcTree ranged (0.1);
+    Pointcloud beam;
+    beam.push_back(8.05f, 0.05f, 0.05f);
+    ranged.insertPointCloudWithModel(beam, origin, RangeSensorModel(2.0f, 1.0f, -1.0f, -0.2f, 8.0f));
+    EXPECT_NEAR (ranged.search(point3d(1.05f, 0.05f, 0.05f))->getLogOdds(), -0.9, 1e-5);
+    EXPECT_NEAR (ranged.search(point3d(6.05f, 0.05f, 0.05f))->getLogOdds(), -0.4, 1e-5);
+    EXPECT_NEAR (ranged.search(point3d(8.05f, 0.05f, 0.05f))->getLogOdds(), 1.0, 1e-5);
+
   // ------------------------------------------------------------
   } else {
     std::cerr << "Invalid test name specified: " << test_name << std::endl;
@@ -534,11 +534,11 @@ void ViewerGui::openMapCollection() {
       it != collection.end(); ++it) {
     OCTOMAP_DEBUG("Adding hierarchy node %s\n", (*it)->getId().c_str());
     OcTree* tree = (*it)->getMap();
-    if (!tree)
+    if (!tree) {
       OCTOMAP_ERROR("Error while reading node %s\n", (*it)->getId().c_str());
-    else {
-      OCTOMAP_DEBUG("Read tree with %zu tree nodes\n", tree->size());
+      continue;
     }
+    OCTOMAP_DEBUG("Read tree with %zu tree nodes\n", tree->size());
     pose6d  origin = (*it)->getOrigin();
     this->addOctree(tree, i, origin);
     ++i;